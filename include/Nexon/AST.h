@@ -1,77 +1,175 @@
-#ifndef NEXON_AST_H
-#define NEXON_AST_H
-
-#include <string>
-#include <vector>
-#include <memory>
-#include "llvm/IR/Value.h"
-#include "llvm/IR/Function.h"
-
-namespace Nexon {
-    using namespace llvm;
-
-    // Base class for all AST nodes.
-    class ExprAST {
-    public:
-        virtual ~ExprAST() = default;
-        virtual Value* codegen() = 0;
-    };
-
-    // Number literal node.
-    class NumberExprAST : public ExprAST {
-        double Val;
-    public:
-        NumberExprAST(double Val) : Val(Val) { }
-        Value* codegen() override;
-    };
-
-    // Variable reference node.
-    class VariableExprAST : public ExprAST {
-        std::string Name;
-    public:
-        VariableExprAST(const std::string &Name) : Name(Name) { }
-        Value* codegen() override;
-    };
-
-    // Binary operator node.
-    class BinaryExprAST : public ExprAST {
-        char Op;
-        std::unique_ptr<ExprAST> LHS, RHS;
-    public:
-        BinaryExprAST(char Op, std::unique_ptr<ExprAST> LHS, std::unique_ptr<ExprAST> RHS)
-            : Op(Op), LHS(std::move(LHS)), RHS(std::move(RHS)) { }
-        Value* codegen() override;
-    };
-
-    // Function call node.
-    class CallExprAST : public ExprAST {
-        std::string Callee;
-        std::vector<std::unique_ptr<ExprAST>> Args;
-    public:
-        CallExprAST(const std::string &Callee, std::vector<std::unique_ptr<ExprAST>> Args)
-            : Callee(Callee), Args(std::move(Args)) { }
-        Value* codegen() override;
-    };
-
-    // Function prototype node.
-    class PrototypeAST {
-        std::string Name;
-        std::vector<std::string> Args;
-    public:
-        PrototypeAST(const std::string &Name, std::vector<std::string> Args)
-            : Name(Name), Args(std::move(Args)) { }
-        const std::string &getName() const { return Name; }
-        Function* codegen();
-    };
-
-    // Function definition node.
-    class FunctionAST {
-        std::unique_ptr<PrototypeAST> Proto;
-        std::unique_ptr<ExprAST> Body;
-    public:
-        FunctionAST(std::unique_ptr<PrototypeAST> Proto, std::unique_ptr<ExprAST> Body)
-            : Proto(std::move(Proto)), Body(std::move(Body)) { }
-        Function* codegen();
-    };
-}
-#endif // NEXON_AST_H
+#ifndef NEXON_AST_H
+#define NEXON_AST_H
+
+#include <cstdint>
+#include <limits>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/Value.h"
+#include "llvm/IR/Function.h"
+#include "llvm/Support/Allocator.h"
+#include "Nexon/Types.h"
+
+namespace Nexon {
+    using namespace llvm;
+
+    class ASTContext;
+    struct FunctionSignature;
+    class CompilationSession;
+
+    // AST nodes live in an ASTContext and refer to each other by 32-bit index.
+    using ExprRef = uint32_t;
+    using ProtoRef = uint32_t;
+    using FuncRef = uint32_t;
+    // Interned identifier; see ASTContext::intern.
+    using Symbol = uint32_t;
+    constexpr uint32_t InvalidRef = std::numeric_limits<uint32_t>::max();
+
+    enum class ExprKind : uint8_t {
+        Number,   // Int for an integer literal (Type i64), Num otherwise (Type f64)
+        Variable, // A = name
+        // Op, A = LHS, Operands = { RHS }; '=' assigns to the variable LHS, comparisons
+        // give bool
+        Binary,
+        Call,     // A = callee, Operands = { first argument in the list pool, argument count }
+        Block,    // Operands = { first expression in the list pool, expression count }
+        // A = loop variable, Op = reduction operator or 0, Operands = { first of start,
+        // end, grain, body and accumulator in the list pool }
+        ParallelFor,
+        If,       // A = condition, Operands = { then, else or InvalidRef }
+        // A = loop variable, Operands = { first of start, end, step or InvalidRef and
+        // body in the list pool }
+        For,
+        While,    // A = condition, Operands = { body }
+        Var       // A = name, Operands = { initializer or InvalidRef, annotated type or InvalidRef }
+    };
+
+    // Binary operators are stored as their character; the two-character comparisons
+    // use these codes.
+    constexpr char OpLessEqual = 'l';
+    constexpr char OpGreaterEqual = 'g';
+    constexpr char OpEqual = 'e';
+    constexpr char OpNotEqual = 'n';
+
+    // Reduction operators of a parallel for; '<' is min and '>' is max.
+    constexpr char ReduceAdd = '+';
+    constexpr char ReduceMul = '*';
+    constexpr char ReduceMin = '<';
+    constexpr char ReduceMax = '>';
+
+    // Expression node: a 16-byte tagged record with no vtable and no owned memory.
+    struct ExprAST {
+        ExprKind Kind;
+        char Op;
+        // Filled in by TypeInference just before the node's function is lowered: the
+        // type of the value, and the type of the variable that Var, For and ParallelFor
+        // declare.
+        mutable ValueType Type;
+        mutable ValueType DeclType;
+        uint32_t A;
+        union {
+            double Num;
+            int64_t Int;
+            uint32_t Operands[2];
+        };
+        Value* codegen(const ASTContext &Ctx, CompilationSession &S) const;
+    };
+    static_assert(sizeof(ExprAST) == 16, "ExprAST should stay compact");
+
+    // Function prototype node; parameter symbols and their types live in the list pool.
+    // Parameters and results without an annotation are f64.
+    struct PrototypeAST {
+        Symbol Name;
+        uint32_t FirstParam;
+        uint32_t NumParams;
+        uint32_t FirstParamType;
+        ValueType ReturnType;
+        FunctionSignature getSignature(const ASTContext &Ctx) const;
+        Function* codegen(const ASTContext &Ctx, CompilationSession &S) const;
+    };
+
+    // Function definition node.
+    struct FunctionAST {
+        ProtoRef Proto;
+        ExprRef Body;
+        Function* codegen(const ASTContext &Ctx, CompilationSession &S) const;
+    };
+
+    // Fixed-size chunks of trivially copyable nodes carved from a bump allocator and
+    // addressed by 32-bit index. Growth never moves existing nodes.
+    template <typename T, unsigned ChunkBits = 12>
+    class NodeArena {
+    public:
+        explicit NodeArena(BumpPtrAllocator &Alloc) : Alloc(Alloc) { }
+        uint32_t push(const T &Node) {
+            if ((Size & Mask) == 0)
+                Chunks.push_back(Alloc.Allocate<T>(ChunkSize));
+            Chunks.back()[Size & Mask] = Node;
+            return Size++;
+        }
+        const T &operator[](uint32_t I) const { return Chunks[I >> ChunkBits][I & Mask]; }
+        uint32_t size() const { return Size; }
+    private:
+        static constexpr uint32_t ChunkSize = 1u << ChunkBits;
+        static constexpr uint32_t Mask = ChunkSize - 1;
+        BumpPtrAllocator &Alloc;
+        std::vector<T*> Chunks;
+        uint32_t Size = 0;
+    };
+
+    // ASTContext owns every node and interned name of one compilation. All of it comes
+    // from a single bump allocator and is released at once when the context dies.
+    class ASTContext {
+    public:
+        ASTContext() : Exprs(Alloc), Protos(Alloc), Functions(Alloc), Names(Alloc) { }
+        ASTContext(const ASTContext &) = delete;
+        ASTContext &operator=(const ASTContext &) = delete;
+
+        Symbol intern(std::string_view Name);
+        std::string_view getName(Symbol S) const { return SymbolNames[S]; }
+
+        ExprRef makeNumber(double Val);
+        ExprRef makeInteger(int64_t Val);
+        ExprRef makeVariable(Symbol Name);
+        ExprRef makeBinary(char Op, ExprRef LHS, ExprRef RHS);
+        ExprRef makeCall(Symbol Callee, ArrayRef<ExprRef> Args);
+        ExprRef makeBlock(ArrayRef<ExprRef> Body);
+        // Grain and Accumulator are InvalidRef when absent; ReduceOp is 0 without an
+        // accumulator.
+        ExprRef makeParallelFor(Symbol Var, ExprRef Start, ExprRef End, ExprRef Grain, ExprRef Body,
+                                char ReduceOp, Symbol Accumulator);
+        ExprRef makeIf(ExprRef Cond, ExprRef Then, ExprRef Else);
+        ExprRef makeFor(Symbol Var, ExprRef Start, ExprRef End, ExprRef Step, ExprRef Body);
+        ExprRef makeWhile(ExprRef Cond, ExprRef Body);
+        // Type is the annotated type, if any.
+        ExprRef makeVar(Symbol Name, ExprRef Init, std::optional<ValueType> Type);
+        // ParamTypes is empty or has one type per parameter.
+        ProtoRef makePrototype(Symbol Name, ArrayRef<Symbol> Params, ArrayRef<ValueType> ParamTypes = {},
+                               ValueType ReturnType = ValueType::F64);
+        FuncRef makeFunction(ProtoRef Proto, ExprRef Body);
+
+        const ExprAST &getExpr(ExprRef E) const { return Exprs[E]; }
+        const PrototypeAST &getProto(ProtoRef P) const { return Protos[P]; }
+        const FunctionAST &getFunction(FuncRef F) const { return Functions[F]; }
+        std::string_view getFunctionName(FuncRef F) const { return getName(getProto(getFunction(F).Proto).Name); }
+        // Argument expressions or parameter symbols stored by makeCall/makePrototype.
+        ArrayRef<uint32_t> getList(uint32_t First, uint32_t Count) const {
+            return ArrayRef<uint32_t>(Lists).slice(First, Count);
+        }
+        size_t getMemoryUsage() const { return Alloc.getTotalMemory() + Lists.capacity() * sizeof(uint32_t); }
+    private:
+        uint32_t appendList(ArrayRef<uint32_t> Items);
+        BumpPtrAllocator Alloc;
+        NodeArena<ExprAST> Exprs;
+        NodeArena<PrototypeAST> Protos;
+        NodeArena<FunctionAST> Functions;
+        std::vector<uint32_t> Lists;
+        StringMap<Symbol, BumpPtrAllocator&> Names;
+        std::vector<std::string_view> SymbolNames;
+    };
+}
+#endif // NEXON_AST_H
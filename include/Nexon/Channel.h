@@ -0,0 +1,360 @@
+#ifndef NEXON_CHANNEL_H
+#define NEXON_CHANNEL_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace Nexon {
+
+    // EventCount lets a thread sleep until another thread signals that the condition
+    // it polls may have changed, without making the signalling side take a lock when
+    // nobody sleeps. A waiter calls prepareWait(), re-checks its condition, then either
+    // cancelWait() or wait(); a signaller changes the condition, then calls notify.
+    class EventCount {
+    public:
+        uint64_t prepareWait() {
+            Waiters.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            return Epoch.load(std::memory_order_seq_cst);
+        }
+        void cancelWait() { Waiters.fetch_sub(1, std::memory_order_relaxed); }
+        void wait(uint64_t Key) {
+            std::unique_lock<std::mutex> Lock(Mutex);
+            Condition.wait(Lock, [&] { return Epoch.load(std::memory_order_seq_cst) != Key; });
+            Waiters.fetch_sub(1, std::memory_order_relaxed);
+        }
+        void notifyOne() { notify(false); }
+        void notifyAll() { notify(true); }
+
+    private:
+        void notify(bool All) {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (Waiters.load(std::memory_order_seq_cst) == 0)
+                return;
+            Epoch.fetch_add(1, std::memory_order_seq_cst);
+            std::lock_guard<std::mutex> Lock(Mutex);
+            if (All)
+                Condition.notify_all();
+            else
+                Condition.notify_one();
+        }
+
+        std::atomic<uint64_t> Epoch { 0 };
+        std::atomic<unsigned> Waiters { 0 };
+        std::mutex Mutex;
+        std::condition_variable Condition;
+    };
+
+    // Channel is a bounded multi-producer, multi-consumer FIFO queue for handing
+    // values between threads (Vyukov's array queue). Senders and receivers claim slots
+    // with a CAS on their own cache-line-padded index and publish them through a
+    // per-slot sequence number, so neither side takes a lock. Blocking calls spin
+    // briefly and then sleep on an EventCount; a full or empty channel costs no CPU.
+    //
+    // After close(), sends fail and receivers drain the remaining values; a send that
+    // races with close() may still be delivered.
+    template<typename T>
+    class Channel {
+    public:
+        // Capacity is rounded up to a power of two, at least 2.
+        explicit Channel(size_t Capacity) {
+            size_t Size = 2;
+            while (Size < Capacity)
+                Size *= 2;
+            Mask = Size - 1;
+            Cells.reset(new Cell[Size]);
+            for (size_t I = 0; I < Size; ++I)
+                Cells[I].Sequence.store(I, std::memory_order_relaxed);
+        }
+        Channel(const Channel &) = delete;
+        Channel &operator=(const Channel &) = delete;
+        ~Channel() {
+            for (size_t Pos = ReceiveIndex.load(std::memory_order_relaxed);; ++Pos) {
+                Cell &C = Cells[Pos & Mask];
+                if (C.Sequence.load(std::memory_order_relaxed) != Pos + 1)
+                    break;
+                std::launder(reinterpret_cast<T*>(C.Storage))->~T();
+            }
+        }
+
+        size_t getCapacity() const { return Mask + 1; }
+        // Values queued at some recent moment.
+        size_t size() const {
+            size_t Tail = SendIndex.load(std::memory_order_acquire);
+            size_t Head = ReceiveIndex.load(std::memory_order_acquire);
+            return Tail > Head ? std::min(Tail - Head, getCapacity()) : 0;
+        }
+        bool isClosed() const { return Closed.load(std::memory_order_acquire); }
+
+        void close() {
+            Closed.store(true, std::memory_order_release);
+            Receivers.notifyAll();
+            Senders.notifyAll();
+            notifySelectors();
+        }
+
+        // Returns false if the channel is full or closed.
+        template<typename U>
+        bool trySend(U &&Value) {
+            if (isClosed())
+                return false;
+            size_t Pos = SendIndex.load(std::memory_order_relaxed);
+            Cell* C;
+            while (true) {
+                C = &Cells[Pos & Mask];
+                intptr_t Diff = static_cast<intptr_t>(C->Sequence.load(std::memory_order_acquire)) -
+                                static_cast<intptr_t>(Pos);
+                if (Diff == 0) {
+                    if (SendIndex.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (Diff < 0) {
+                    return false;
+                } else {
+                    Pos = SendIndex.load(std::memory_order_relaxed);
+                }
+            }
+            new (C->Storage) T(std::forward<U>(Value));
+            C->Sequence.store(Pos + 1, std::memory_order_release);
+            Receivers.notifyOne();
+            notifySelectors();
+            return true;
+        }
+
+        // Returns false if the channel is empty.
+        bool tryReceive(T &Value) {
+            size_t Pos = ReceiveIndex.load(std::memory_order_relaxed);
+            Cell* C;
+            while (true) {
+                C = &Cells[Pos & Mask];
+                intptr_t Diff = static_cast<intptr_t>(C->Sequence.load(std::memory_order_acquire)) -
+                                static_cast<intptr_t>(Pos + 1);
+                if (Diff == 0) {
+                    if (ReceiveIndex.compare_exchange_weak(Pos, Pos + 1, std::memory_order_relaxed))
+                        break;
+                } else if (Diff < 0) {
+                    return false;
+                } else {
+                    Pos = ReceiveIndex.load(std::memory_order_relaxed);
+                }
+            }
+            T* Slot = std::launder(reinterpret_cast<T*>(C->Storage));
+            Value = std::move(*Slot);
+            Slot->~T();
+            C->Sequence.store(Pos + Mask + 1, std::memory_order_release);
+            Senders.notifyOne();
+            return true;
+        }
+
+        // Sends as many of Values[0..Count) as fit without waiting, moving from them,
+        // and returns how many were sent. Consecutive free slots are claimed with one CAS.
+        size_t trySendBatch(T* Values, size_t Count) {
+            if (isClosed() || Count == 0)
+                return 0;
+            size_t Pos = SendIndex.load(std::memory_order_relaxed);
+            size_t N;
+            while (true) {
+                N = 0;
+                while (N < Count && N <= Mask &&
+                       Cells[(Pos + N) & Mask].Sequence.load(std::memory_order_acquire) == Pos + N)
+                    ++N;
+                if (N == 0) {
+                    intptr_t Diff = static_cast<intptr_t>(Cells[Pos & Mask].Sequence.load(std::memory_order_acquire)) -
+                                    static_cast<intptr_t>(Pos);
+                    if (Diff < 0)
+                        return 0;
+                    Pos = SendIndex.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if (SendIndex.compare_exchange_weak(Pos, Pos + N, std::memory_order_relaxed))
+                    break;
+            }
+            for (size_t I = 0; I < N; ++I) {
+                Cell &C = Cells[(Pos + I) & Mask];
+                new (C.Storage) T(std::move(Values[I]));
+                C.Sequence.store(Pos + I + 1, std::memory_order_release);
+            }
+            Receivers.notifyAll();
+            notifySelectors();
+            return N;
+        }
+
+        // Receives up to Max queued values into Out without waiting; returns how many.
+        size_t tryReceiveBatch(T* Out, size_t Max) {
+            if (Max == 0)
+                return 0;
+            size_t Pos = ReceiveIndex.load(std::memory_order_relaxed);
+            size_t N;
+            while (true) {
+                N = 0;
+                while (N < Max && N <= Mask &&
+                       Cells[(Pos + N) & Mask].Sequence.load(std::memory_order_acquire) == Pos + N + 1)
+                    ++N;
+                if (N == 0) {
+                    intptr_t Diff = static_cast<intptr_t>(Cells[Pos & Mask].Sequence.load(std::memory_order_acquire)) -
+                                    static_cast<intptr_t>(Pos + 1);
+                    if (Diff < 0)
+                        return 0;
+                    Pos = ReceiveIndex.load(std::memory_order_relaxed);
+                    continue;
+                }
+                if (ReceiveIndex.compare_exchange_weak(Pos, Pos + N, std::memory_order_relaxed))
+                    break;
+            }
+            for (size_t I = 0; I < N; ++I) {
+                Cell &C = Cells[(Pos + I) & Mask];
+                T* Slot = std::launder(reinterpret_cast<T*>(C.Storage));
+                Out[I] = std::move(*Slot);
+                Slot->~T();
+                C.Sequence.store(Pos + I + Mask + 1, std::memory_order_release);
+            }
+            Senders.notifyAll();
+            return N;
+        }
+
+        // Waits for room; returns false if the channel is closed.
+        template<typename U>
+        bool send(U &&Value) {
+            bool Sent = false;
+            waitFor(Senders, [&] {
+                Sent = trySend(std::forward<U>(Value));
+                return Sent || isClosed();
+            });
+            return Sent;
+        }
+
+        // Waits for a value; returns false once the channel is closed and empty.
+        bool receive(T &Value) {
+            bool Received = false;
+            waitFor(Receivers, [&] {
+                Received = tryReceive(Value);
+                return Received || isClosed();
+            });
+            // A value sent just before close() is still delivered.
+            return Received || tryReceive(Value);
+        }
+
+        // Sends all of Values[0..Count), waiting for room as needed; returns how many
+        // were sent before the channel was closed.
+        size_t sendBatch(T* Values, size_t Count) {
+            size_t Sent = 0;
+            waitFor(Senders, [&] {
+                Sent += trySendBatch(Values + Sent, Count - Sent);
+                return Sent == Count || isClosed();
+            });
+            return Sent;
+        }
+
+        // Waits for at least one value and receives up to Max; returns 0 once the
+        // channel is closed and empty.
+        size_t receiveBatch(T* Out, size_t Max) {
+            size_t Received = 0;
+            waitFor(Receivers, [&] {
+                Received = tryReceiveBatch(Out, Max);
+                return Received != 0 || isClosed() || Max == 0;
+            });
+            return Received ? Received : tryReceiveBatch(Out, Max);
+        }
+
+        // Receives from whichever of Channels has a value first (trying them in turn,
+        // from a different start each call) and returns its index, or -1 once all of
+        // them are closed and empty.
+        static int select(llvm::ArrayRef<Channel*> Channels, T &Value) {
+            if (Channels.empty())
+                return -1;
+            static thread_local size_t Start = 0;
+            EventCount Selector;
+            for (Channel* Ch : Channels)
+                Ch->addSelector(&Selector);
+            int Selected = -1;
+            waitFor(Selector, [&] {
+                bool AllClosed = true;
+                size_t First = Start++;
+                for (size_t I = 0; I < Channels.size(); ++I) {
+                    size_t Index = (First + I) % Channels.size();
+                    if (Channels[Index]->tryReceive(Value)) {
+                        Selected = static_cast<int>(Index);
+                        return true;
+                    }
+                    AllClosed = AllClosed && Channels[Index]->isClosed();
+                }
+                return AllClosed;
+            });
+            for (Channel* Ch : Channels)
+                Ch->removeSelector(&Selector);
+            if (Selected < 0) {
+                // Values sent just before the last close().
+                for (size_t Index = 0; Index < Channels.size() && Selected < 0; ++Index) {
+                    if (Channels[Index]->tryReceive(Value))
+                        Selected = static_cast<int>(Index);
+                }
+            }
+            return Selected;
+        }
+
+    private:
+        struct Cell {
+            std::atomic<size_t> Sequence;
+            alignas(T) unsigned char Storage[sizeof(T)];
+        };
+
+        // Polls Done, spinning a little before sleeping on Event between polls.
+        template<typename Predicate>
+        static void waitFor(EventCount &Event, Predicate Done) {
+            for (unsigned Spin = 0; Spin < 64; ++Spin) {
+                if (Done())
+                    return;
+                if (Spin >= 16)
+                    std::this_thread::yield();
+            }
+            while (true) {
+                uint64_t Key = Event.prepareWait();
+                if (Done()) {
+                    Event.cancelWait();
+                    return;
+                }
+                Event.wait(Key);
+            }
+        }
+
+        void addSelector(EventCount* Selector) {
+            std::lock_guard<std::mutex> Lock(SelectorMutex);
+            Selectors.push_back(Selector);
+            NumSelectors.fetch_add(1, std::memory_order_seq_cst);
+        }
+        void removeSelector(EventCount* Selector) {
+            std::lock_guard<std::mutex> Lock(SelectorMutex);
+            Selectors.erase(std::find(Selectors.begin(), Selectors.end(), Selector));
+            NumSelectors.fetch_sub(1, std::memory_order_relaxed);
+        }
+        void notifySelectors() {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (NumSelectors.load(std::memory_order_seq_cst) == 0)
+                return;
+            std::lock_guard<std::mutex> Lock(SelectorMutex);
+            for (EventCount* Selector : Selectors)
+                Selector->notifyAll();
+        }
+
+        alignas(64) std::atomic<size_t> SendIndex { 0 };
+        alignas(64) std::atomic<size_t> ReceiveIndex { 0 };
+        alignas(64) std::unique_ptr<Cell[]> Cells;
+        size_t Mask;
+        std::atomic<bool> Closed { false };
+        EventCount Senders, Receivers;
+        // select() calls waiting on this channel.
+        std::mutex SelectorMutex;
+        std::vector<EventCount*> Selectors;
+        std::atomic<unsigned> NumSelectors { 0 };
+    };
+
+}
+#endif // NEXON_CHANNEL_H
@@ -1,30 +1,101 @@
-#ifndef NEXON_CODEGEN_H
-#define NEXON_CODEGEN_H
-
-#include "llvm/IR/IRBuilder.h"
-#include "llvm/IR/LLVMContext.h"
-#include "llvm/IR/Module.h"
-#include <map>
-#include <string>
-#include <memory>
-
-namespace Nexon {
-
-    // CodeGen provides production-grade LLVM-based code generation.
-    class CodeGen {
-    public:
-        static llvm::LLVMContext &getGlobalContext();
-        static llvm::IRBuilder<>* Builder();
-        static llvm::Module* TheModule();
-        static llvm::Value* getNamedValue(const std::string &Name);
-        static void setNamedValue(const std::string &Name, llvm::Value* V);
-        static void clearNamedValues();
-    private:
-        static std::unique_ptr<llvm::LLVMContext> GlobalContext;
-        static std::unique_ptr<llvm::Module> ModuleInstance;
-        static std::unique_ptr<llvm::IRBuilder<>> IRBuilderInstance;
-        static std::map<std::string, llvm::Value*> NamedValues;
-    };
-
-}
-#endif // NEXON_CODEGEN_H
+#ifndef NEXON_CODEGEN_H
+#define NEXON_CODEGEN_H
+
+#include "llvm/IR/IRBuilder.h"
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Module.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "Nexon/Types.h"
+#include <map>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+
+namespace Nexon {
+
+    // Signature of a function known to the compiler. It is kept after the AST that
+    // declared it is released, so later modules can still call the function.
+    struct FunctionSignature {
+        std::string Name;
+        std::vector<std::string> Params;
+        // One per parameter.
+        std::vector<ValueType> ParamTypes;
+        ValueType ReturnType = ValueType::F64;
+    };
+
+    // FunctionRegistry records the signatures of every function of one program. It is
+    // shared by all sessions that lower parts of that program, possibly on several
+    // threads, and is safe to use concurrently.
+    class FunctionRegistry {
+    public:
+        void add(FunctionSignature Sig);
+        std::optional<FunctionSignature> find(std::string_view Name) const;
+    private:
+        mutable std::mutex Mutex;
+        std::map<std::string, FunctionSignature, std::less<>> Functions;
+    };
+
+    // CompilationSession provides production-grade LLVM-based code generation. A
+    // session owns its context, module, builder and symbol table, so independent
+    // sessions can compile side by side on different threads. A session itself is
+    // used by one thread at a time.
+    class CompilationSession {
+    public:
+        // Starts a session with an empty module. Sessions that lower parts of the same
+        // program pass a shared registry so they can call each other's functions.
+        explicit CompilationSession(std::shared_ptr<FunctionRegistry> Functions = nullptr);
+        CompilationSession(const CompilationSession &) = delete;
+        CompilationSession &operator=(const CompilationSession &) = delete;
+
+        llvm::LLVMContext &getContext() { return *Context; }
+        llvm::IRBuilder<> &getBuilder() { return *Builder; }
+        llvm::Module &getModule() { return *TheModule; }
+        const std::shared_ptr<FunctionRegistry> &getFunctionRegistry() const { return Functions; }
+
+        // Local variables of the function being lowered, named by their stack slots.
+        // mem2reg promotes the slots to registers.
+        llvm::AllocaInst* getNamedValue(std::string_view Name) const;
+        void setNamedValue(std::string_view Name, llvm::AllocaInst* V);
+        void clearNamedValues() { NamedValues.clear(); }
+        // Creates a stack slot in the entry block of the function being lowered.
+        llvm::AllocaInst* createLocal(llvm::Type* Ty, std::string_view Name);
+        // Converts V to To at the builder's position. Integers are signed, bool converts
+        // to 0 or 1, and a value converts to bool as value != 0 (NaN gives false).
+        // Floating-point values saturate to the integer range, and NaN converts to 0.
+        llvm::Value* createConversion(llvm::Value* V, llvm::Type* To);
+        llvm::Value* createConversion(llvm::Value* V, ValueType To) {
+            return createConversion(V, getLLVMType(*Context, To));
+        }
+        using NameScope = std::map<std::string, llvm::AllocaInst*, std::less<>>;
+        // Bindings of the function being lowered, kept aside while a nested function is
+        // emitted.
+        NameScope saveNamedValues() const { return NamedValues; }
+        void restoreNamedValues(NameScope Saved) { NamedValues = std::move(Saved); }
+        // Returns the named function from the current module, declaring it from a
+        // registered prototype if it was defined in another module.
+        llvm::Function* getFunction(std::string_view Name);
+        // Records a function signature so later modules can call it.
+        void addPrototype(FunctionSignature Sig) { Functions->add(std::move(Sig)); }
+        // Declares a function with the given signature in the current module.
+        llvm::Function* declareFunction(const FunctionSignature &Sig);
+        // Replaces the context, module and builder with fresh instances.
+        void initializeModule();
+        // Transfers the current module (with its context) to the caller and starts a new one.
+        llvm::orc::ThreadSafeModule takeModule();
+        // Emits a C `main` that evaluates the given top-level expressions in order and
+        // prints each result, the entry point of ahead-of-time compiled programs. The
+        // expressions are declared from their prototypes if defined in another module.
+        llvm::Function* emitMain(const std::vector<std::string> &TopLevelExprs);
+    private:
+        std::unique_ptr<llvm::LLVMContext> Context;
+        std::unique_ptr<llvm::Module> TheModule;
+        std::unique_ptr<llvm::IRBuilder<>> Builder;
+        NameScope NamedValues;
+        std::shared_ptr<FunctionRegistry> Functions;
+    };
+
+}
+#endif // NEXON_CODEGEN_H
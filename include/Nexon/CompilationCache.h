@@ -0,0 +1,57 @@
+#ifndef NEXON_COMPILATIONCACHE_H
+#define NEXON_COMPILATIONCACHE_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/StringRef.h"
+#include "llvm/Support/CachePruning.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Target/TargetMachine.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Nexon {
+
+    // CompilationCache keeps the native objects built from a source file on disk, keyed
+    // by a hash of everything that affects them, so that repeated runs and builds of
+    // the same source skip lexing, parsing, code generation and optimization. Each
+    // entry is a single file; the least recently used entries are evicted once the
+    // cache outgrows its size limit.
+    class CompilationCache {
+    public:
+        // Output of one cached compilation: native objects, or other binary blobs such
+        // as the marshalled code of a Python script.
+        struct Entry {
+            std::vector<std::string> TopLevelExprs;
+            std::vector<std::unique_ptr<llvm::MemoryBuffer>> Objects;
+        };
+
+        // Opens the cache in $NEXON_CACHE_DIR, or in "nexon" under the user's cache
+        // directory. $NEXON_CACHE_SIZE sets the size limit (e.g. "512m", "2g" or "10%"
+        // of free disk space). Returns nullptr if the cache cannot be used.
+        static std::unique_ptr<CompilationCache> open();
+        // Hashes Source with the compiler version and build, the LLVM version, the
+        // optimization settings, the target described by TM, and Kind, which tells apart
+        // differently shaped outputs of the same source (e.g. with and without a `main`).
+        static std::string computeKey(llvm::StringRef Source, llvm::StringRef Kind,
+                                      const llvm::TargetMachine &TM);
+        // Hashes Kind and Fields with the compiler version and build, for outputs that
+        // do not depend on a target or on optimization settings.
+        static std::string computeKey(llvm::StringRef Kind, llvm::ArrayRef<llvm::StringRef> Fields);
+        // Fills E from the entry stored under Key. Returns false on a miss.
+        bool lookup(const std::string &Key, Entry &E);
+        // Stores objects under Key, then evicts old entries if the cache is too large.
+        // Failures are reported as warnings; the cache is only an accelerator.
+        void store(const std::string &Key, const std::vector<std::string> &TopLevelExprs,
+                   llvm::ArrayRef<std::unique_ptr<llvm::MemoryBuffer>> Objects);
+        const std::string &getDirectory() const { return Directory; }
+    private:
+        CompilationCache(std::string Directory, llvm::CachePruningPolicy Policy)
+            : Directory(std::move(Directory)), Policy(Policy) { }
+        std::string getEntryPath(const std::string &Key) const;
+        std::string Directory;
+        llvm::CachePruningPolicy Policy;
+    };
+
+}
+#endif // NEXON_COMPILATIONCACHE_H
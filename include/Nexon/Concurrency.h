@@ -1,18 +1,317 @@
-#ifndef NEXON_CONCURRENCY_H
-#define NEXON_CONCURRENCY_H
-
-#include <thread>
-#include <vector>
-#include <functional>
-#include <iostream>
-
-namespace Nexon {
-
-    // Concurrency provides production-grade parallel processing using std::thread.
-    class Concurrency {
-    public:
-        static void parallelFor(size_t start, size_t end, const std::function<void(size_t)> &func);
-    };
-
-}
-#endif // NEXON_CONCURRENCY_H
+#ifndef NEXON_CONCURRENCY_H
+#define NEXON_CONCURRENCY_H
+
+#include "Nexon/Channel.h"
+#include "Nexon/Future.h"
+#include "Nexon/TaskGraph.h"
+#include "Nexon/ThreadPool.h"
+#include <algorithm>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <iostream>
+#include <type_traits>
+
+namespace Nexon {
+
+    // How the reductions split their input. Fast blocks are sized for the pool, so a
+    // floating-point result may differ between thread counts. Deterministic blocks
+    // have a fixed size and their results are combined in a fixed tree, so the result
+    // is bit-identical on every machine and run.
+    enum class ReductionOrder { Fast, Deterministic };
+
+    // Inclusive: out[i] covers in[0..i]. Exclusive: out[i] covers in[0..i), out[0] is
+    // the identity.
+    enum class ScanKind { Inclusive, Exclusive };
+
+    // Concurrency provides production-grade parallel processing on the process-wide
+    // work-stealing ThreadPool.
+    class Concurrency {
+    public:
+        // Bounded lock-free MPMC queue for streaming values between threads.
+        template<typename T>
+        using Channel = Nexon::Channel<T>;
+        // Named tasks with dependencies, run on the pool as their inputs complete.
+        using TaskGraph = Nexon::TaskGraph;
+
+        // Receives from whichever of channels has a value first; returns its index, or
+        // -1 once all of them are closed and empty.
+        template<typename T>
+        static int select(llvm::ArrayRef<Channel<T>*> channels, T &value) {
+            return Channel<T>::select(channels, value);
+        }
+
+        // Runs func over [start, end) on the pool's threads, including the caller, and
+        // returns when every call has finished. Calls from inside a parallel loop share
+        // the same threads. func is either per-index, func(i), or per-range,
+        // func(chunkBegin, chunkEnd); a range body is a plain loop the compiler can
+        // inline and vectorize. Chunks hold at most grain indices (0: getDefaultGrain).
+        template<typename Callable>
+        static void parallelFor(size_t start, size_t end, Callable &&func, size_t grain = 0) {
+            if (start >= end)
+                return;
+            if (grain == 0)
+                grain = getDefaultGrain(end - start);
+            if constexpr (std::is_invocable_v<Callable&, size_t, size_t>) {
+                ThreadPool::get().parallelFor(start, end, grain, func);
+            } else {
+                static_assert(std::is_invocable_v<Callable&, size_t>,
+                              "parallelFor needs a body callable as func(i) or func(begin, end)");
+                ThreadPool::get().parallelFor(start, end, grain, [&func](size_t chunkBegin, size_t chunkEnd) {
+                    for (size_t i = chunkBegin; i < chunkEnd; ++i)
+                        func(i);
+                });
+            }
+        }
+
+        // Reduces [start, end): reduce(chunkBegin, chunkEnd) returns the value of one
+        // chunk, and the chunk values are combined with combine, which must be
+        // associative. Returns identity for an empty range. A nonzero blockSize overrides
+        // the one chosen by order; the result then depends only on blockSize.
+        template<typename T, typename Reduce, typename Combine>
+        static T parallelReduce(size_t start, size_t end, T identity, Reduce &&reduce, Combine &&combine,
+                                ReductionOrder order = ReductionOrder::Fast, size_t blockSize = 0) {
+            if (start >= end)
+                return identity;
+            if (blockSize == 0)
+                blockSize = getBlockSize(end - start, order);
+            std::vector<T> partials(getNumBlocks(start, end, blockSize), identity);
+            forEachBlock(start, end, blockSize, [&](size_t block, size_t blockBegin, size_t blockEnd) {
+                partials[block] = reduce(blockBegin, blockEnd);
+            });
+            // A fixed pairwise tree: ((p0 + p1) + (p2 + p3)) + ...
+            for (size_t width = 1; width < partials.size(); width *= 2) {
+                for (size_t i = 0; i + width < partials.size(); i += 2 * width)
+                    partials[i] = combine(partials[i], partials[i + width]);
+            }
+            return partials[0];
+        }
+
+        // Combines transform(i) for every i in [start, end), starting from identity.
+        template<typename T, typename Transform, typename Combine>
+        static T parallelTransformReduce(size_t start, size_t end, T identity, Transform &&transform,
+                                         Combine &&combine, ReductionOrder order = ReductionOrder::Fast) {
+            return parallelReduce(start, end, identity, [&](size_t chunkBegin, size_t chunkEnd) {
+                T acc = identity;
+                for (size_t i = chunkBegin; i < chunkEnd; ++i)
+                    acc = combine(acc, transform(i));
+                return acc;
+            }, combine, order);
+        }
+
+        // Writes the prefix combinations of [first, last) to out, which may equal first.
+        // Each block is reduced, the block totals are scanned, and then every block is
+        // scanned from its offset: two passes over the input, both parallel.
+        template<typename InputIt, typename OutputIt, typename T, typename Combine>
+        static void parallelScan(InputIt first, InputIt last, OutputIt out, T identity, Combine &&combine,
+                                 ScanKind kind = ScanKind::Inclusive, ReductionOrder order = ReductionOrder::Fast) {
+            size_t count = static_cast<size_t>(std::distance(first, last));
+            if (count == 0)
+                return;
+            size_t blockSize = getBlockSize(count, order);
+            std::vector<T> offsets(getNumBlocks(0, count, blockSize), identity);
+            forEachBlock(0, count, blockSize, [&](size_t block, size_t blockBegin, size_t blockEnd) {
+                T acc = identity;
+                for (size_t i = blockBegin; i < blockEnd; ++i)
+                    acc = combine(acc, static_cast<T>(first[i]));
+                offsets[block] = acc;
+            });
+            T running = identity;
+            for (auto &offset : offsets) {
+                T total = offset;
+                offset = running;
+                running = combine(running, total);
+            }
+            forEachBlock(0, count, blockSize, [&](size_t block, size_t blockBegin, size_t blockEnd) {
+                T acc = offsets[block];
+                for (size_t i = blockBegin; i < blockEnd; ++i) {
+                    // Read before writing, for in-place scans.
+                    T value = static_cast<T>(first[i]);
+                    if (kind == ScanKind::Inclusive) {
+                        acc = combine(acc, value);
+                        out[i] = acc;
+                    } else {
+                        out[i] = acc;
+                        acc = combine(acc, value);
+                    }
+                }
+            });
+        }
+
+        // Sorts [first, last) by comp, like std::sort (not stable): blocks are sorted in
+        // parallel, then merged pairwise, each merge split across threads.
+        template<typename RandomIt, typename Compare = std::less<>>
+        static void parallelSort(RandomIt first, RandomIt last, Compare comp = Compare()) {
+            using Value = typename std::iterator_traits<RandomIt>::value_type;
+            size_t count = static_cast<size_t>(last - first);
+            size_t blockSize = std::max<size_t>(getDefaultGrain(count), MinSortBlock);
+            if (count <= blockSize) {
+                std::sort(first, last, comp);
+                return;
+            }
+            forEachBlock(0, count, blockSize, [&](size_t, size_t blockBegin, size_t blockEnd) {
+                std::sort(first + blockBegin, first + blockEnd, comp);
+            });
+            // Merge rounds alternate between the input and a buffer.
+            std::vector<Value> buffer(count);
+            bool inBuffer = false;
+            for (size_t width = blockSize; width < count; width *= 2) {
+                size_t numPairs = (count + 2 * width - 1) / (2 * width);
+                parallelFor(0, numPairs, [&](size_t pair) {
+                    size_t lo = pair * 2 * width;
+                    size_t mid = std::min(count, lo + width);
+                    size_t hi = std::min(count, lo + 2 * width);
+                    if (inBuffer)
+                        parallelMerge(buffer.begin() + lo, buffer.begin() + mid, buffer.begin() + hi, first + lo, comp);
+                    else
+                        parallelMerge(first + lo, first + mid, first + hi, buffer.begin() + lo, comp);
+                }, /*grain=*/1);
+                inBuffer = !inBuffer;
+            }
+            if (inBuffer) {
+                parallelFor(0, count, [&](size_t chunkBegin, size_t chunkEnd) {
+                    std::move(buffer.begin() + chunkBegin, buffer.begin() + chunkEnd, first + chunkBegin);
+                });
+            }
+        }
+
+        // Runs func() as a pool task and returns the future of its result. Unlike
+        // parallelFor, the caller does not wait: independent work overlaps, and dependent
+        // work is chained with then() and whenAll().
+        template<typename Callable>
+        static Future<std::invoke_result_t<std::decay_t<Callable>&>> async(Callable &&func) {
+            using R = std::invoke_result_t<std::decay_t<Callable>&>;
+            auto state = std::make_shared<typename Future<R>::State>();
+            ThreadPool::get().submitFunction([state, work = std::forward<Callable>(func)]() mutable {
+                Future<R>::run(*state, work);
+            });
+            return Future<R>(std::move(state));
+        }
+
+        // Returns a future of all the inputs' values, in order (Future<void> for void
+        // inputs). It completes once every input has completed, and is cancelled if any
+        // input is cancelled.
+        template<typename T>
+        static Future<std::conditional_t<std::is_void_v<T>, void, std::vector<T>>> whenAll(std::vector<Future<T>> inputs) {
+            using R = std::conditional_t<std::is_void_v<T>, void, std::vector<T>>;
+            auto state = std::make_shared<typename Future<R>::State>();
+            auto shared = std::make_shared<std::vector<Future<T>>>(std::move(inputs));
+            auto pending = std::make_shared<std::atomic<size_t>>(shared->size() + 1);
+            auto finishOne = [state, shared, pending] {
+                if (pending->fetch_sub(1, std::memory_order_acq_rel) != 1)
+                    return;
+                bool completed = !state->CancelRequested.load(std::memory_order_relaxed);
+                for (auto &input : *shared)
+                    completed = completed && input.getStatus() == TaskStatus::Completed;
+                if (completed) {
+                    if constexpr (std::is_void_v<T>) {
+                        state->Value.emplace(true);
+                    } else {
+                        std::vector<T> values;
+                        values.reserve(shared->size());
+                        for (auto &input : *shared)
+                            values.push_back(std::move(*input.S->Value));
+                        state->Value.emplace(std::move(values));
+                    }
+                }
+                state->finish(completed ? TaskStatus::Completed : TaskStatus::Cancelled);
+            };
+            for (auto &input : *shared)
+                input.S->onReady(finishOne);
+            // The extra count keeps an empty or already finished input list from
+            // completing before every continuation is attached.
+            finishOne();
+            return Future<R>(std::move(state));
+        }
+
+        // True if the pool task running on this thread (an async function, a continuation
+        // or a TaskGraph node) has been cancelled and may stop early.
+        static bool isCancellationRequested() { return CancellationScope::isRequested(); }
+
+        // Allocates count value-initialized elements, initialized by a parallel loop over
+        // [0, count). The kernel places each page on the NUMA node of the thread that
+        // first touches it, and ThreadPool splits later loops over [0, count) the same
+        // way, so each part is processed on the node that holds its memory.
+        template<typename T>
+        static std::shared_ptr<T[]> allocateDistributed(size_t count) {
+            constexpr std::align_val_t alignment { alignof(T) > 64 ? alignof(T) : 64 };
+            T* data = static_cast<T*>(::operator new(count * sizeof(T), alignment));
+            parallelFor(0, count, [data](size_t chunkBegin, size_t chunkEnd) {
+                std::uninitialized_value_construct(data + chunkBegin, data + chunkEnd);
+            });
+            return std::shared_ptr<T[]>(data, [count, alignment](T* p) {
+                std::destroy(p, p + count);
+                ::operator delete(p, alignment);
+            });
+        }
+
+        // Grain for a loop of count indices: several chunks per thread, so that threads
+        // which finish early can steal the rest.
+        static size_t getDefaultGrain(size_t count);
+
+    private:
+        // Block size of ReductionOrder::Deterministic.
+        static constexpr size_t DeterministicBlock = size_t(1) << 14;
+        // Below this, splitting a sort or merge costs more than it saves.
+        static constexpr size_t MinSortBlock = size_t(1) << 13;
+
+        static size_t getBlockSize(size_t count, ReductionOrder order) {
+            return order == ReductionOrder::Deterministic ? DeterministicBlock : getDefaultGrain(count);
+        }
+        static size_t getNumBlocks(size_t start, size_t end, size_t blockSize) {
+            return (end - start + blockSize - 1) / blockSize;
+        }
+
+        // Calls body(block, blockBegin, blockEnd) for the blocks of blockSize indices that
+        // cover [start, end). Unlike parallelFor's chunks, block boundaries are fixed.
+        template<typename Body>
+        static void forEachBlock(size_t start, size_t end, size_t blockSize, Body &&body) {
+            parallelFor(0, getNumBlocks(start, end, blockSize), [&](size_t firstBlock, size_t lastBlock) {
+                for (size_t block = firstBlock; block < lastBlock; ++block) {
+                    size_t blockBegin = start + block * blockSize;
+                    body(block, blockBegin, std::min(end, blockBegin + blockSize));
+                }
+            });
+        }
+
+        // Merges the sorted ranges [lo, mid) and [mid, hi) into out. The output is cut into
+        // pieces; each piece finds its inputs by binary search along the merge path.
+        template<typename InputIt, typename OutputIt, typename Compare>
+        static void parallelMerge(InputIt lo, InputIt mid, InputIt hi, OutputIt out, Compare &comp) {
+            size_t leftCount = static_cast<size_t>(mid - lo);
+            size_t rightCount = static_cast<size_t>(hi - mid);
+            size_t total = leftCount + rightCount;
+            // Number of left elements among the first k outputs; ties go to the left.
+            auto split = [&](size_t k) {
+                size_t low = k > rightCount ? k - rightCount : 0;
+                size_t high = std::min(k, leftCount);
+                while (low < high) {
+                    size_t i = low + (high - low) / 2;
+                    if (!comp(mid[k - i - 1], lo[i]))
+                        low = i + 1;
+                    else
+                        high = i;
+                }
+                return low;
+            };
+            size_t grain = std::max<size_t>(getDefaultGrain(total), MinSortBlock);
+            parallelFor(0, (total + grain - 1) / grain, [&](size_t piece) {
+                size_t outBegin = piece * grain;
+                size_t outEnd = std::min(total, outBegin + grain);
+                size_t leftBegin = split(outBegin), leftEnd = split(outEnd);
+                std::merge(std::make_move_iterator(lo + leftBegin), std::make_move_iterator(lo + leftEnd),
+                           std::make_move_iterator(mid + (outBegin - leftBegin)),
+                           std::make_move_iterator(mid + (outEnd - leftEnd)), out + outBegin, comp);
+            }, /*grain=*/1);
+        }
+    };
+
+    // Times a memory-bound loop with a per-index std::function, a per-index template
+    // body and a range body.
+    void benchmarkParallelFor();
+
+}
+#endif // NEXON_CONCURRENCY_H
@@ -0,0 +1,164 @@
+#ifndef NEXON_FUTURE_H
+#define NEXON_FUTURE_H
+
+#include "Nexon/ThreadPool.h"
+#include "llvm/ADT/FunctionExtras.h"
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace Nexon {
+
+    enum class TaskStatus { Pending, Completed, Cancelled };
+
+    // Marks the work running on this thread, so that it can see whether its result is
+    // still wanted (Concurrency::isCancellationRequested).
+    class CancellationScope {
+    public:
+        explicit CancellationScope(const std::atomic<bool>* Flag) : Saved(Current) { Current = Flag; }
+        ~CancellationScope() { Current = Saved; }
+        CancellationScope(const CancellationScope &) = delete;
+        CancellationScope &operator=(const CancellationScope &) = delete;
+        static bool isRequested() { return Current && Current->load(std::memory_order_relaxed); }
+    private:
+        static thread_local const std::atomic<bool>* Current;
+        const std::atomic<bool>* Saved;
+    };
+
+    template<typename T>
+    class Future;
+
+    template<typename F, typename T>
+    struct ContinuationResult { using type = std::invoke_result_t<F&, T&&>; };
+    template<typename F>
+    struct ContinuationResult<F, void> { using type = std::invoke_result_t<F&>; };
+
+    // Future is the result of work running on the ThreadPool (Concurrency::async). Its
+    // value has one consumer: either get() it or attach one continuation with then().
+    // Work must not throw; a future ends Completed, or Cancelled if cancel() was called
+    // before its work finished or the work it depends on was cancelled.
+    template<typename T>
+    class Future {
+        using Stored = std::conditional_t<std::is_void_v<T>, bool, T>;
+    public:
+        // get()'s result: empty (false for Future<void>) if the future was cancelled.
+        using Result = std::conditional_t<std::is_void_v<T>, bool, std::optional<T>>;
+
+        Future() = default;
+        bool valid() const { return static_cast<bool>(S); }
+        TaskStatus getStatus() const { return S->Status.load(std::memory_order_acquire); }
+        bool isReady() const { return getStatus() != TaskStatus::Pending; }
+
+        // Waits for the future, running pool tasks meanwhile, and returns true if it
+        // completed.
+        bool wait() const {
+            if (!isReady())
+                ThreadPool::get().helpUntil([this] { return isReady(); });
+            return getStatus() == TaskStatus::Completed;
+        }
+
+        // Waits for the future and takes its value.
+        Result get() {
+            if (!wait())
+                return Result();
+            if constexpr (std::is_void_v<T>)
+                return true;
+            else
+                return std::move(*S->Value);
+        }
+
+        // Asks the work to stop. Work that has not started is skipped; running work may
+        // poll Concurrency::isCancellationRequested() and return early. Unless the future
+        // has already completed, it and its continuations end Cancelled.
+        void cancel() const { S->CancelRequested.store(true, std::memory_order_relaxed); }
+
+        // Returns the future of Fn(value) (Fn() for Future<void>), which runs as a new
+        // pool task once this future completes. If this future is cancelled, Fn does not
+        // run and the returned future is cancelled too.
+        template<typename F>
+        Future<typename ContinuationResult<std::decay_t<F>, T>::type> then(F &&Fn) {
+            using R = typename ContinuationResult<std::decay_t<F>, T>::type;
+            auto Next = std::make_shared<typename Future<R>::State>();
+            S->onReady([Source = S, Next, Work = std::forward<F>(Fn)]() mutable {
+                if (Source->Status.load(std::memory_order_acquire) != TaskStatus::Completed) {
+                    Next->finish(TaskStatus::Cancelled);
+                    return;
+                }
+                ThreadPool::get().submitFunction([Source = std::move(Source), Next = std::move(Next),
+                                                  Work = std::move(Work)]() mutable {
+                    if constexpr (std::is_void_v<T>)
+                        Future<R>::run(*Next, Work);
+                    else
+                        Future<R>::run(*Next, Work, std::move(*Source->Value));
+                });
+            });
+            return Future<R>(std::move(Next));
+        }
+
+    private:
+        template<typename U>
+        friend class Future;
+        friend class Concurrency;
+
+        struct State {
+            std::mutex Mutex;
+            std::atomic<TaskStatus> Status { TaskStatus::Pending };
+            std::atomic<bool> CancelRequested { false };
+            std::optional<Stored> Value;
+            // Called on the finishing thread once the status is final.
+            std::vector<llvm::unique_function<void()>> Continuations;
+
+            void finish(TaskStatus Final) {
+                std::vector<llvm::unique_function<void()>> Ready;
+                {
+                    std::lock_guard<std::mutex> Lock(Mutex);
+                    Status.store(Final, std::memory_order_release);
+                    Ready.swap(Continuations);
+                }
+                for (auto &Continuation : Ready)
+                    Continuation();
+            }
+
+            void onReady(llvm::unique_function<void()> Continuation) {
+                {
+                    std::lock_guard<std::mutex> Lock(Mutex);
+                    if (Status.load(std::memory_order_relaxed) == TaskStatus::Pending) {
+                        Continuations.push_back(std::move(Continuation));
+                        return;
+                    }
+                }
+                Continuation();
+            }
+        };
+
+        explicit Future(std::shared_ptr<State> S) : S(std::move(S)) { }
+
+        // Runs Work(Args...) as the work of Target, unless cancellation came first.
+        template<typename Fn, typename... Args>
+        static void run(State &Target, Fn &Work, Args &&...A) {
+            if (Target.CancelRequested.load(std::memory_order_relaxed)) {
+                Target.finish(TaskStatus::Cancelled);
+                return;
+            }
+            {
+                CancellationScope Scope(&Target.CancelRequested);
+                if constexpr (std::is_void_v<T>) {
+                    Work(std::forward<Args>(A)...);
+                    Target.Value.emplace(true);
+                } else {
+                    Target.Value.emplace(Work(std::forward<Args>(A)...));
+                }
+            }
+            Target.finish(Target.CancelRequested.load(std::memory_order_relaxed) ? TaskStatus::Cancelled
+                                                                                 : TaskStatus::Completed);
+        }
+
+        std::shared_ptr<State> S;
+    };
+
+}
+#endif // NEXON_FUTURE_H
@@ -0,0 +1,58 @@
+#ifndef NEXON_JIT_H
+#define NEXON_JIT_H
+
+#include "llvm/ExecutionEngine/Orc/IndirectionUtils.h"
+#include "llvm/ExecutionEngine/Orc/LLJIT.h"
+#include "llvm/ExecutionEngine/Orc/LazyReexports.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Target/TargetMachine.h"
+#include "Nexon/AST.h"
+#include "Nexon/CodeGen.h"
+#include <memory>
+#include <string>
+
+namespace Nexon {
+
+    // JIT executes generated LLVM IR in-process through an LLVM ORC LLJIT.
+    // Symbols from the host process (libm, the Nexon runtime) are visible to
+    // JIT-compiled code so that `extern` declarations resolve natively.
+    class JIT {
+    public:
+        // Creates a JIT targeting the host machine; returns nullptr on failure.
+        static std::unique_ptr<JIT> create();
+        // Hands a module over to the JIT. Returns false on failure.
+        bool addModule(llvm::orc::ThreadSafeModule TSM);
+        // Hands an already compiled native object over to the JIT. Safe to call from
+        // several threads at once. Returns false on failure.
+        bool addObject(std::unique_ptr<llvm::MemoryBuffer> Obj);
+        // Registers a function for lazy compilation. A call-through stub is installed
+        // under its name; the body stays as AST until the first call, when it is
+        // lowered, optimized and compiled on its own in a fresh session that shares
+        // Functions with the rest of the program. The JIT keeps the AST context alive
+        // until every pending function has been compiled. Returns false on failure.
+        bool addLazyFunction(std::shared_ptr<const ASTContext> Ctx, FuncRef F,
+                             std::shared_ptr<FunctionRegistry> Functions);
+        // Returns the address of a JIT-compiled symbol, or nullptr if it is not found.
+        void* lookup(const std::string &Name);
+        const llvm::DataLayout &getDataLayout() const { return LLJ->getDataLayout(); }
+        const llvm::Triple &getTargetTriple() const { return LLJ->getTargetTriple(); }
+        // The host TargetMachine that modules for this JIT are optimized for.
+        llvm::TargetMachine &getTargetMachine() { return *TM; }
+    private:
+        friend class FunctionASTMaterializationUnit;
+        JIT(std::unique_ptr<llvm::orc::LLJIT> LLJ, std::unique_ptr<llvm::TargetMachine> TM)
+            : LLJ(std::move(LLJ)), TM(std::move(TM)) { }
+        bool enableLazyCompilation();
+        // Lowers and optimizes a single function into a module of its own.
+        llvm::orc::ThreadSafeModule lowerFunction(const ASTContext &Ctx, FuncRef F,
+                                                  std::shared_ptr<FunctionRegistry> Functions);
+        std::unique_ptr<llvm::orc::LLJIT> LLJ;
+        std::unique_ptr<llvm::TargetMachine> TM;
+        // Lazy compilation state, created on the first addLazyFunction call.
+        std::unique_ptr<llvm::orc::LazyCallThroughManager> LCTM;
+        std::unique_ptr<llvm::orc::IndirectStubsManager> ISM;
+        llvm::orc::JITDylib* ImplJD = nullptr;
+    };
+
+}
+#endif // NEXON_JIT_H
@@ -1,40 +1,76 @@
-#ifndef NEXON_LEXER_H
-#define NEXON_LEXER_H
-
-#include <string>
-#include <cctype>
-#include <sstream>
-#include <vector>
-#include <iostream>
-
-namespace Nexon {
-
-    enum Token {
-        tok_eof = -1,
-        tok_def = -2,
-        tok_extern = -3,
-        tok_identifier = -4,
-        tok_number = -5,
-        tok_keyword = -6,
-        tok_operator = -7,
-        tok_separator = -8
-    };
-
-    // Lexer tokenizes Nexon source code into tokens.
-    class Lexer {
-    public:
-        Lexer(const std::string &input) : Input(input), Position(0) { }
-        int getNextToken();
-        std::string getIdentifierStr() const { return IdentifierStr; }
-        double getNumVal() const { return NumVal; }
-    private:
-        std::string Input;
-        size_t Position;
-        std::string IdentifierStr;
-        double NumVal;
-        char getNextChar();
-        char peekChar() const;
-    };
-
-}
-#endif // NEXON_LEXER_H
+#ifndef NEXON_LEXER_H
+#define NEXON_LEXER_H
+
+#include <string>
+#include <string_view>
+#include <cctype>
+#include <sstream>
+#include <vector>
+#include <iostream>
+
+namespace Nexon {
+
+    enum Token {
+        tok_eof = -1,
+        tok_def = -2,
+        tok_extern = -3,
+        tok_identifier = -4,
+        tok_number = -5,
+        tok_keyword = -6,
+        tok_operator = -7,
+        tok_separator = -8,
+        tok_parallel = -9,
+        tok_for = -10,
+        tok_if = -11,
+        tok_else = -12,
+        tok_while = -13,
+        tok_var = -14,
+        // Two-character comparison operators; single-character operators are their
+        // own character.
+        tok_le = -15,
+        tok_ge = -16,
+        tok_eq = -17,
+        tok_ne = -18
+    };
+
+    // 1-based position of a token in the source.
+    struct SourceLocation {
+        unsigned Line = 1;
+        unsigned Column = 1;
+    };
+
+    struct ScanKernels;
+
+    // Kernels a Lexer scans character runs with: the widest the CPU supports, or the
+    // portable scalar loops (to check the SIMD kernels against).
+    enum class LexerKernels { Best, Scalar };
+
+    // Lexer tokenizes Nexon source code into tokens. It works directly on a
+    // non-owning view of the source (typically a memory-mapped file), which must
+    // outlive the Lexer; token text is exposed as spans into that buffer.
+    // Character runs are scanned with SSE2/AVX2 kernels chosen at runtime.
+    class Lexer {
+    public:
+        Lexer(std::string_view input, LexerKernels kernels = LexerKernels::Best);
+        int getNextToken();
+        // Source text of the current token.
+        std::string_view getTokenText() const { return TokenText; }
+        SourceLocation getTokenLoc() const { return TokenLoc; }
+        std::string_view getIdentifierStr() const { return TokenText; }
+        double getNumVal() const { return NumVal; }
+    private:
+        std::string_view Input;
+        const ScanKernels* Kernels;
+        size_t Position;
+        size_t LineStart = 0;
+        unsigned Line = 1;
+        std::string_view TokenText;
+        SourceLocation TokenLoc;
+        double NumVal = 0.0;
+    };
+
+    // Lexes input repeatedly and reports throughput in GB/s.
+    void benchmarkLexer(std::string_view input);
+
+}
+#endif // NEXON_LEXER_H
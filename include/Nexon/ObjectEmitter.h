@@ -0,0 +1,44 @@
+#ifndef NEXON_OBJECTEMITTER_H
+#define NEXON_OBJECTEMITTER_H
+
+#include "llvm/IR/Module.h"
+#include "llvm/Support/MemoryBuffer.h"
+#include "llvm/Target/TargetMachine.h"
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Nexon {
+
+    // ObjectEmitter lowers LLVM IR to native object files in-process with an LLVM
+    // TargetMachine, so ahead-of-time builds need no C++ compiler.
+    class ObjectEmitter {
+    public:
+        // Registers the LLVM targets. Runs once per process, on the first call, so
+        // commands that never generate code skip it.
+        static void initializeTargets();
+        // Creates a TargetMachine for the given triple and CPU. An empty triple selects
+        // the host, and an empty CPU (or "native") selects the host CPU and its features.
+        // Returns nullptr if the target is unknown.
+        static std::unique_ptr<llvm::TargetMachine> createTargetMachine(const std::string &Triple,
+                                                                        const std::string &CPU);
+        // Sets the module's target triple and data layout to match TM.
+        static void configureModule(llvm::Module &M, llvm::TargetMachine &TM);
+        // Writes M as a native object file to Path.
+        static bool emitObjectFile(llvm::Module &M, llvm::TargetMachine &TM, const std::string &Path);
+        // Emits M as a native object into memory, e.g. for the JIT. Returns nullptr on failure.
+        static std::unique_ptr<llvm::MemoryBuffer> emitObjectBuffer(llvm::Module &M, llvm::TargetMachine &TM);
+        // Links object files and the Nexon runtime into an executable with the system
+        // linker driver. The runtime is found in $NEXON_RUNTIME_DIR, or else next to the
+        // nexon executable or in ../lib beside it.
+        static bool linkExecutable(const std::vector<std::string> &Objects, const std::string &Output);
+        // Combines object files into a single relocatable object with the linker driver.
+        static bool linkRelocatable(const std::vector<std::string> &Objects, const std::string &Output);
+    private:
+        static bool emitObject(llvm::Module &M, llvm::TargetMachine &TM, llvm::raw_pwrite_stream &Out);
+        static bool runLinker(const std::vector<std::string> &Objects, const std::string &Output,
+                              const std::vector<std::string> &ExtraArgs);
+    };
+
+}
+#endif // NEXON_OBJECTEMITTER_H
@@ -1,13 +1,36 @@
-#ifndef NEXON_OPTIMIZER_H
-#define NEXON_OPTIMIZER_H
-
-namespace Nexon {
-
-    // Optimizer runs production-grade optimization passes on the generated LLVM IR.
-    class Optimizer {
-    public:
-        static void runOptimizationPasses();
-    };
-
-}
-#endif // NEXON_OPTIMIZER_H
+#ifndef NEXON_OPTIMIZER_H
+#define NEXON_OPTIMIZER_H
+
+#include "llvm/IR/Module.h"
+#include "llvm/Target/TargetMachine.h"
+#include <string>
+
+namespace Nexon {
+
+    // Optimization levels, mirroring the -O flags of the command line.
+    enum class OptLevel { O0, O1, O2, O3, Os };
+
+    // Optimizer runs production-grade optimization passes on the generated LLVM IR
+    // using the default pipelines of LLVM's new pass manager.
+    class Optimizer {
+    public:
+        // Optimizes M for the host machine. Returns false on failure.
+        static bool runOptimizationPasses(llvm::Module &M);
+        // Optimizes M for TM. The module's target triple and data layout are taken from
+        // TM when it has none, so inlining, unrolling and vectorization cost models apply.
+        static bool runOptimizationPasses(llvm::Module &M, llvm::TargetMachine &TM);
+        static void setOptimizationLevel(OptLevel Level) { CurrentLevel = Level; }
+        static OptLevel getOptimizationLevel() { return CurrentLevel; }
+        // Parses "-O0".."-O3" or "-Os". Returns false if Flag is not an optimization flag.
+        static bool parseOptimizationFlag(const std::string &Flag, OptLevel &Level);
+        // Appends a textual pass pipeline (e.g. "function(licm),globaldce") that runs
+        // after the default pipeline.
+        static void addCustomPasses(const std::string &Pipeline);
+        static const std::string &getCustomPasses() { return CustomPipeline; }
+    private:
+        static OptLevel CurrentLevel;
+        static std::string CustomPipeline;
+    };
+
+}
+#endif // NEXON_OPTIMIZER_H
@@ -0,0 +1,37 @@
+#ifndef NEXON_PARALLELCODEGEN_H
+#define NEXON_PARALLELCODEGEN_H
+
+#include "Nexon/AST.h"
+#include "Nexon/CodeGen.h"
+#include "llvm/ExecutionEngine/Orc/ThreadSafeModule.h"
+#include "llvm/Target/TargetMachine.h"
+#include <functional>
+#include <string>
+
+namespace Nexon {
+
+    // ParallelCodeGen lowers the functions of one program on several threads. The
+    // functions are split into contiguous shards; each shard is generated by its own
+    // CompilationSession, optimized with its own TargetMachine and handed to a consumer
+    // on the worker thread, so back-end work can stay parallel too.
+    class ParallelCodeGen {
+    public:
+        // Receives a finished shard and the TargetMachine it was optimized for. Called
+        // concurrently from worker threads; returns false on failure.
+        using ShardConsumer = std::function<bool(unsigned Shard, llvm::orc::ThreadSafeModule TSM,
+                                                 llvm::TargetMachine &TM)>;
+        // Lowers Functions in up to Jobs shards for the given target (empty strings select
+        // the host). The signature of every function they call must already be in
+        // Registry, which all shard sessions share. Returns false if any shard failed.
+        static bool lowerFunctions(const ASTContext &Ctx, llvm::ArrayRef<FuncRef> Functions,
+                                   const std::shared_ptr<FunctionRegistry> &Registry, unsigned Jobs,
+                                   const std::string &Triple, const std::string &CPU,
+                                   const ShardConsumer &Consume);
+        // Number of shards lowerFunctions will use for the given job count and functions.
+        static unsigned getNumShards(unsigned Jobs, size_t NumFunctions);
+        // Default job count: one per hardware thread.
+        static unsigned getDefaultJobs();
+    };
+
+}
+#endif // NEXON_PARALLELCODEGEN_H
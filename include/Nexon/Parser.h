@@ -1,34 +1,65 @@
-#ifndef NEXON_PARSER_H
-#define NEXON_PARSER_H
-
-#include "Nexon/AST.h"
-#include "Nexon/Lexer.h"
-#include <memory>
-#include <vector>
-#include <iostream>
-
-namespace Nexon {
-
-    // Parser implements a production-ready recursive descent parser.
-    class Parser {
-    public:
-        Parser(const std::string &input);
-        int getCurrentToken();
-        int getNextToken();
-        std::unique_ptr<ExprAST> parseExpression();
-        std::unique_ptr<ExprAST> parsePrimary();
-        std::unique_ptr<ExprAST> parseIdentifierExpr();
-        std::unique_ptr<ExprAST> parseNumberExpr();
-        std::unique_ptr<ExprAST> parseParenExpr();
-        std::unique_ptr<ExprAST> parseBinOpRHS(int ExprPrec, std::unique_ptr<ExprAST> LHS);
-        std::unique_ptr<PrototypeAST> parsePrototype();
-        std::unique_ptr<FunctionAST> parseDefinition();
-        std::unique_ptr<FunctionAST> parseTopLevelExpr();
-        int getToken() const { return CurTok; }
-    private:
-        Lexer Lex;
-        int CurTok;
-    };
-
-}
-#endif // NEXON_PARSER_H
+#ifndef NEXON_PARSER_H
+#define NEXON_PARSER_H
+
+#include "Nexon/AST.h"
+#include "Nexon/Lexer.h"
+#include "Nexon/TokenBuffer.h"
+#include <algorithm>
+#include <memory>
+#include <optional>
+#include <vector>
+#include <iostream>
+
+namespace Nexon {
+
+    // Parser implements a production-ready recursive descent parser. It walks a
+    // pre-lexed TokenBuffer by index, which gives arbitrary lookahead and cheap
+    // backtracking; the buffer must outlive the Parser. Parse functions return
+    // InvalidRef on error.
+    class Parser {
+    public:
+        // Nodes are allocated in ctx, which must outlive any use of the returned refs.
+        Parser(const TokenBuffer &tokens, ASTContext &ctx);
+        int getCurrentToken() const { return Tokens.getKind(Index); }
+        int getNextToken();
+        // Kind of the token K positions ahead of the current one (0 is current).
+        int peekToken(size_t K) const;
+        // Current position, for backtracking with seek().
+        size_t getPosition() const { return Index; }
+        void seek(size_t Position) { Index = std::min(Position, Tokens.size() - 1); }
+        ExprRef parseExpression();
+        ExprRef parsePrimary();
+        ExprRef parseIdentifierExpr();
+        // Negative: the literal follows a unary '-', which is folded into it.
+        ExprRef parseNumberExpr(bool Negative = false);
+        ExprRef parseNegationExpr();
+        ExprRef parseParenExpr();
+        ExprRef parseBlockExpr();
+        ExprRef parseParallelForExpr();
+        ExprRef parseForExpr();
+        ExprRef parseWhileExpr();
+        ExprRef parseIfExpr();
+        ExprRef parseVarExpr();
+        ExprRef parseBinOpRHS(int ExprPrec, ExprRef LHS);
+        ProtoRef parsePrototype();
+        FuncRef parseDefinition();
+        ProtoRef parseExtern();
+        FuncRef parseTopLevelExpr();
+        int getToken() const { return getCurrentToken(); }
+    private:
+        // Reports a syntax error at the current token.
+        void logError(const char *Msg) const;
+        // Parses "for var = start, end [, extra]", where extra is a step or grain.
+        bool parseForHeader(Symbol &Var, ExprRef &Start, ExprRef &End, ExprRef &Extra);
+        // A '{' block, as required after a loop header.
+        ExprRef parseLoopBody();
+        // A type name, for annotations.
+        std::optional<ValueType> parseType();
+        const TokenBuffer &Tokens;
+        ASTContext &Ctx;
+        size_t Index = 0;
+        unsigned AnonExprCount = 0;
+    };
+
+}
+#endif // NEXON_PARSER_H
@@ -0,0 +1,31 @@
+#ifndef NEXON_PYTHONBATCH_H
+#define NEXON_PYTHONBATCH_H
+
+#include <string>
+#include <vector>
+
+namespace Nexon {
+
+    class CompilationCache;
+
+    // PythonBatch runs independent Python scripts concurrently (`nexon pyrun a.py b.py
+    // --jobs N`). Each script runs in isolation: on Python 3.12 and later in a
+    // sub-interpreter with its own GIL, so scripts run in parallel on threads of this
+    // process; on older Pythons (or with UseProcesses) in a forked worker process.
+    // A script that imports an extension module without sub-interpreter support fails
+    // there with an ImportError; it is then run again from the top in a worker process,
+    // so whatever it did before that import (output, files written) happens twice.
+    // Scripts are compiled once in the main interpreter and handed to the workers as
+    // marshalled code objects, which the compilation cache keeps across runs.
+    class PythonBatch {
+    public:
+        // Runs Files on up to Jobs workers and returns the number of scripts that
+        // failed. Cache may be null.
+        static unsigned run(const std::vector<std::string> &Files, unsigned Jobs, bool UseProcesses,
+                            CompilationCache* Cache);
+        // True if this build runs scripts in sub-interpreters with their own GIL.
+        static bool hasPerInterpreterGIL();
+    };
+
+}
+#endif // NEXON_PYTHONBATCH_H
@@ -0,0 +1,70 @@
+#ifndef NEXON_PYTHONBRIDGE_H
+#define NEXON_PYTHONBRIDGE_H
+
+#include "Nexon/stdlib.h"
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Forward declaration, so users of the bridge need not include Python.h.
+typedef struct _object PyObject;
+
+namespace Nexon {
+
+    // Element types that can cross the bridge.
+    enum class ElementType { F64, F32, I64, I32, U8 };
+
+    template<typename T> struct ElementTypeOf;
+    template<> struct ElementTypeOf<double> { static constexpr ElementType Value = ElementType::F64; };
+    template<> struct ElementTypeOf<float> { static constexpr ElementType Value = ElementType::F32; };
+    template<> struct ElementTypeOf<int64_t> { static constexpr ElementType Value = ElementType::I64; };
+    template<> struct ElementTypeOf<int32_t> { static constexpr ElementType Value = ElementType::I32; };
+    template<> struct ElementTypeOf<uint8_t> { static constexpr ElementType Value = ElementType::U8; };
+
+    // PythonBridge shares memory between Nexon and the embedded Python interpreter
+    // without copying. Exported memory is a `nexon.Array` that implements the buffer
+    // protocol and `__array_interface__`, so `numpy.asarray` wraps it in place; imports
+    // borrow the memory of any contiguous buffer exporter (NumPy arrays, memoryview,
+    // bytearray, array.array). All functions must be called with the GIL held.
+    class PythonBridge {
+    public:
+        // Wraps Count elements at Data in a new `nexon.Array`. Owner is kept alive for
+        // as long as the object or any view of it exists. Returns a new reference, or
+        // nullptr on failure.
+        static PyObject* exportBuffer(void* Data, size_t Count, ElementType Type,
+                                      std::shared_ptr<void> Owner, bool ReadOnly = false);
+        // Borrows the memory of a writable, C-contiguous buffer of Type elements. Owner
+        // holds the buffer (and thereby Obj) until it is released. Multi-dimensional
+        // buffers are seen flattened. Returns false if Obj is not such a buffer.
+        static bool importBuffer(PyObject* Obj, ElementType Type, void* &Data, size_t &Count,
+                                 std::shared_ptr<void> &Owner);
+
+        template<typename T>
+        static PyObject* exportArray(const NexonStd::BigArray<T> &A, bool ReadOnly = false) {
+            return exportBuffer(const_cast<T*>(A.data()), A.size(), ElementTypeOf<T>::Value, A.getOwner(), ReadOnly);
+        }
+        // Returns an array viewing Obj's memory, or nullptr if Obj cannot be borrowed.
+        template<typename T>
+        static std::unique_ptr<NexonStd::BigArray<T>> importArray(PyObject* Obj) {
+            void* Data;
+            size_t Count;
+            std::shared_ptr<void> Owner;
+            if (!importBuffer(Obj, ElementTypeOf<T>::Value, Data, Count, Owner))
+                return nullptr;
+            return std::make_unique<NexonStd::BigArray<T>>(static_cast<T*>(Data), Count, std::move(Owner));
+        }
+
+        // The `nexon.Array` type of the current interpreter (a borrowed reference),
+        // or nullptr on failure.
+        static PyObject* getArrayType();
+        // Creates the `nexon.Array` type for a new nexon module (a new reference).
+        static PyObject* createArrayType(PyObject* Module);
+        // Binds Obj to Name in `__main__`, where pyrun code sees it. Steals Obj.
+        static bool setGlobal(const std::string &Name, PyObject* Obj);
+        // Returns a new reference to Name in `__main__`, or nullptr if it is unbound.
+        static PyObject* getGlobal(const std::string &Name);
+    };
+
+}
+#endif // NEXON_PYTHONBRIDGE_H
@@ -0,0 +1,33 @@
+#ifndef NEXON_PYTHONMODULE_H
+#define NEXON_PYTHONMODULE_H
+
+typedef struct _object PyObject;
+
+namespace Nexon {
+
+    // PythonModule implements `nexon`, the module that lets embedded Python code
+    // compile Nexon functions into native callables:
+    //
+    //     import nexon, numpy as np
+    //     f = nexon.compile("def f(x y) x * x + y")
+    //     f(3, 4)                # 13.0
+    //     f.ufunc(xs, ys)        # element-wise over NumPy arrays, natively
+    //
+    // Arguments and results cross as Python floats: the generated wrappers convert
+    // them to the function's parameter types and its result back to f64, so every
+    // compiled function, typed or not, has a float64 ufunc (when nexon is built with
+    // NumPy headers). The ufunc's inner loop is
+    // generated together with the function and optimized with it, so the body is
+    // inlined and vectorized. The module also exports `nexon.Array` (see PythonBridge).
+    // It uses multi-phase initialization with per-module state, so every interpreter,
+    // including sub-interpreters with their own GIL, gets its own copy of the types.
+    class PythonModule {
+    public:
+        // Makes `import nexon` available. Must be called before Py_Initialize.
+        static void registerModule();
+        // The `nexon.Array` type of an imported nexon module (a borrowed reference).
+        static PyObject* getArrayType(PyObject* Module);
+    };
+
+}
+#endif // NEXON_PYTHONMODULE_H
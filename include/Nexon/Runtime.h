@@ -1,25 +1,25 @@
-#ifndef NEXON_RUNTIME_H
-#define NEXON_RUNTIME_H
-
-#include <iostream>
-#include <string>
-
-namespace Nexon {
-
-    // Runtime initializes and shuts down the Nexon runtime environment.
-    // It now also initializes the embedded Python interpreter so that
-    // users can import and use any Python library in their Nexon code.
-    class Runtime {
-    public:
-        static void initialize();
-        static void shutdown();
-        // Initialize the embedded Python interpreter.
-        static void initializePython();
-        // Finalize the Python interpreter.
-        static void finalizePython();
-        // Execute a Python string.
-        static int executePythonCode(const std::string &code);
-    };
-
-}
-#endif // NEXON_RUNTIME_H
+#ifndef NEXON_RUNTIME_H
+#define NEXON_RUNTIME_H
+
+#include <iostream>
+#include <string>
+
+namespace Nexon {
+
+    // Runtime owns the embedded Python interpreter so that users can import
+    // and use any Python library in their Nexon code. The interpreter is
+    // started lazily, by the first Python code that runs.
+    class Runtime {
+    public:
+        // Restores runtime state in a process forked from an initialized one.
+        static void afterFork();
+        // Initialize the embedded Python interpreter.
+        static void initializePython();
+        // Finalize the Python interpreter.
+        static void finalizePython();
+        // Execute a Python string, initializing the interpreter if needed.
+        static int executePythonCode(const std::string &code);
+    };
+
+}
+#endif // NEXON_RUNTIME_H
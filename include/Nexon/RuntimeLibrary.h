@@ -0,0 +1,65 @@
+#ifndef NEXON_RUNTIMELIBRARY_H
+#define NEXON_RUNTIMELIBRARY_H
+
+#include "llvm/ADT/ArrayRef.h"
+#include <cstdint>
+
+namespace Nexon {
+
+    // RuntimeLibrary lists the runtime entry points that Nexon programs run by the JIT
+    // can declare with `extern`, e.g. `extern chanSend(ch value)`. They take and
+    // return doubles like every Nexon function. It also lists the entry points that
+    // generated code calls directly, under their C names. Executables built by
+    // `nexon compile` link the same entry points from libnexonrt.
+    class RuntimeLibrary {
+    public:
+        struct Symbol {
+            const char* Name;
+            void* Address;
+        };
+        static llvm::ArrayRef<Symbol> getSymbols();
+    };
+
+}
+
+// Channels of doubles for Nexon code, declared there as chanNew, chanSend, chanRecv,
+// chanTrySend, chanTryRecv, chanClose and chanLen. A channel is named by the handle
+// chanNew returns; values, like the handles, are doubles.
+extern "C" {
+    // Creates a channel holding up to capacity values; returns its handle.
+    double nexon_chan_new(double capacity);
+    // Waits for room; returns 1, or 0 if the channel is closed.
+    double nexon_chan_send(double channel, double value);
+    // Waits for a value and returns it; returns NaN once the channel is closed and empty.
+    double nexon_chan_recv(double channel);
+    // Returns 1 if value was queued, 0 if the channel is full or closed.
+    double nexon_chan_try_send(double channel, double value);
+    // Returns a queued value, or NaN if there is none.
+    double nexon_chan_try_recv(double channel);
+    double nexon_chan_close(double channel);
+    // Number of queued values.
+    double nexon_chan_len(double channel);
+
+    // Entry points of `parallel for`. body runs the indices [chunkBegin, chunkEnd) of
+    // one chunk with the loop's captured variables at context; it is only called with
+    // non-empty chunks. Chunks hold at most grain indices (grain <= 0: chosen by the
+    // runtime).
+    void nexon_rt_parallel_for(void (*body)(void* context, int64_t chunkBegin, int64_t chunkEnd),
+                               void* context, int64_t begin, int64_t end, int64_t grain);
+    // As nexon_rt_parallel_for, but body returns the partial of its chunk, and the
+    // partials are combined with op: '+', '*', '<' (min) or '>' (max). Returns the
+    // identity of op for an empty range. The chunks and the order of combination depend
+    // only on the range and grain, so a given grain gives the same result on every run.
+    // There is one entry point per reduction type, the type of the accumulator; integer
+    // sums and products wrap around.
+    double nexon_rt_parallel_reduce_f64(double (*body)(void* context, int64_t chunkBegin, int64_t chunkEnd),
+                                        void* context, int64_t begin, int64_t end, int64_t grain, int32_t op);
+    float nexon_rt_parallel_reduce_f32(float (*body)(void* context, int64_t chunkBegin, int64_t chunkEnd),
+                                       void* context, int64_t begin, int64_t end, int64_t grain, int32_t op);
+    int64_t nexon_rt_parallel_reduce_i64(int64_t (*body)(void* context, int64_t chunkBegin, int64_t chunkEnd),
+                                         void* context, int64_t begin, int64_t end, int64_t grain, int32_t op);
+    int32_t nexon_rt_parallel_reduce_i32(int32_t (*body)(void* context, int64_t chunkBegin, int64_t chunkEnd),
+                                         void* context, int64_t begin, int64_t end, int64_t grain, int32_t op);
+}
+
+#endif // NEXON_RUNTIMELIBRARY_H
@@ -0,0 +1,35 @@
+#ifndef NEXON_SERVER_H
+#define NEXON_SERVER_H
+
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Nexon {
+
+    // Server keeps one warm nexon process listening on a Unix domain socket and runs
+    // the commands of thin clients in it. Each request runs in a forked copy of the
+    // server, so it starts with the server's initialized state (Python, LLVM targets,
+    // a ready JIT) and is isolated from other requests. The client's stdin, stdout and
+    // stderr are passed over the socket, so output goes straight to the client, and
+    // the request runs in the client's working directory and environment.
+    class Server {
+    public:
+        // Runs one command line (argv[0] is "nexon") and returns its exit code.
+        using CommandHandler = std::function<int(int argc, char **argv)>;
+
+        // $NEXON_SERVER_SOCKET, else nexon.sock in $XDG_RUNTIME_DIR, else
+        // /tmp/nexon-<uid>.sock.
+        static std::string getDefaultSocketPath();
+        // Serves requests on SocketPath until SIGINT or SIGTERM. Returns false if the
+        // socket cannot be set up or another server already owns it.
+        static bool serve(const std::string &SocketPath, const CommandHandler &Handler);
+        // Runs Args on the server listening on SocketPath, if any, with this process's
+        // stdio, working directory and environment. Returns false when no server
+        // accepted the request, so the caller can run it locally; otherwise ExitCode
+        // receives the command's exit code.
+        static bool forward(const std::string &SocketPath, const std::vector<std::string> &Args, int &ExitCode);
+    };
+
+}
+#endif // NEXON_SERVER_H
@@ -0,0 +1,39 @@
+#ifndef NEXON_STARTUPPROFILE_H
+#define NEXON_STARTUPPROFILE_H
+
+#include <chrono>
+#include <vector>
+
+namespace Nexon {
+
+    // StartupProfile reports where a nexon process spends its start-up time
+    // (`--startup-profile`). Subsystems are initialized lazily, each inside a Stage,
+    // so the report lists exactly the stages a command needed.
+    class StartupProfile {
+    public:
+        // Starts profiling; the report is printed to stderr, under Title, when the
+        // process exits.
+        static void enable(const char* Title = "Startup profile");
+        static bool isEnabled() { return Enabled; }
+        // Times one initialization stage for as long as it is alive.
+        class Stage {
+        public:
+            explicit Stage(const char* Name);
+            ~Stage();
+            Stage(const Stage &) = delete;
+            Stage &operator=(const Stage &) = delete;
+        private:
+            const char* Name;
+            std::chrono::steady_clock::time_point Start;
+        };
+    private:
+        static void report();
+        static bool Enabled;
+        static const char* Title;
+        static double CpuBeforeMain;
+        static std::chrono::steady_clock::time_point MainStart;
+        static std::vector<std::pair<const char*, double>> Stages;
+    };
+
+}
+#endif // NEXON_STARTUPPROFILE_H
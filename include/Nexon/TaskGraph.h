@@ -0,0 +1,68 @@
+#ifndef NEXON_TASKGRAPH_H
+#define NEXON_TASKGRAPH_H
+
+#include "Nexon/Future.h"
+#include "llvm/ADT/ArrayRef.h"
+#include "llvm/ADT/FunctionExtras.h"
+#include "llvm/ADT/StringRef.h"
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace Nexon {
+
+    // TaskGraph runs a pipeline of named stages with dependencies between them (load,
+    // then transform, then reduce, then write) on the ThreadPool. A node starts as
+    // soon as its own dependencies have finished, so independent stages overlap instead
+    // of waiting at a barrier; a node may itself use Concurrency::parallelFor. The
+    // timings of the last run can be exported as a trace.
+    class TaskGraph {
+    public:
+        using NodeId = size_t;
+
+        // Adds a node that runs Work once all of Dependencies have finished.
+        NodeId add(llvm::StringRef Name, llvm::unique_function<void()> Work, llvm::ArrayRef<NodeId> Dependencies = {});
+        // Makes To wait for From.
+        void addDependency(NodeId From, NodeId To);
+        size_t size() const { return Nodes.size(); }
+
+        // Runs every node once and returns true if all of them ran. After cancel(),
+        // nodes that have not started are skipped and run() returns false. The graph can
+        // be run again.
+        bool run();
+        // Starts run() as a pool task.
+        Future<bool> runAsync();
+        // Callable from any thread, including from inside a node, which can also poll
+        // Concurrency::isCancellationRequested().
+        void cancel() { Cancelled.store(true, std::memory_order_relaxed); }
+
+        // Writes the nodes of the last run as Chrome trace JSON, for chrome://tracing or
+        // https://ui.perfetto.dev. Skipped nodes are not shown.
+        bool exportTrace(llvm::StringRef Path) const;
+
+    private:
+        struct Node {
+            std::string Name;
+            llvm::unique_function<void()> Work;
+            std::vector<NodeId> Successors;
+            unsigned NumDependencies = 0;
+            std::atomic<unsigned> Remaining { 0 };
+            // Trace of the last run.
+            bool Ran = false;
+            int Thread = -1;
+            std::chrono::steady_clock::time_point Start, End;
+        };
+
+        void runNode(NodeId Id);
+        bool hasCycle() const;
+
+        std::vector<std::unique_ptr<Node>> Nodes;
+        std::atomic<bool> Cancelled { false };
+        std::atomic<size_t> Unfinished { 0 };
+        std::chrono::steady_clock::time_point RunStart;
+    };
+
+}
+#endif // NEXON_TASKGRAPH_H
@@ -0,0 +1,124 @@
+#ifndef NEXON_THREADPOOL_H
+#define NEXON_THREADPOOL_H
+
+#include "Nexon/WorkStealingDeque.h"
+#include "llvm/ADT/STLExtras.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+namespace Nexon {
+
+    // ThreadPool is the process-wide work-stealing scheduler behind Concurrency's
+    // parallel primitives. Each worker owns a Chase-Lev deque. A parallel loop starts
+    // as one task covering the whole range; whoever runs a task splits off halves for
+    // others to steal until the range is down to the grain size, so uneven iterations
+    // balance themselves. Idle workers spin briefly, then park until work arrives.
+    //
+    // A thread that waits for a loop runs that loop's (and any other) tasks meanwhile,
+    // so nested loops run on the threads that are already there instead of creating
+    // more, and a loop completes even if no worker is free to help.
+    //
+    // Workers are spread over the usable CPUs (see Topology) and pinned to their NUMA
+    // node ($NEXON_AFFINITY: node, core or none). On a machine with several nodes a
+    // parallel loop is first cut into one contiguous part per node, sized by the node's
+    // workers, and workers steal within their node before stealing across nodes. The
+    // cut depends only on the range, so pages first touched by one loop over [0, n)
+    // are processed on the same node by later loops over [0, n).
+    class ThreadPool {
+    public:
+        // A unit of work. Tasks are run once, by whichever thread takes them.
+        class Task {
+        public:
+            virtual ~Task() = default;
+            virtual void execute() = 0;
+        };
+
+        // The pool, started on first use with $NEXON_NUM_THREADS threads in total
+        // (default: Topology::getConcurrency(), which respects the affinity mask and
+        // cgroup CPU quota). The calling thread counts as one: it takes part in every
+        // loop it starts.
+        static ThreadPool &get();
+        // Threads that run parallel loops: the workers and the caller.
+        unsigned getConcurrency() const { return static_cast<unsigned>(Workers.size()) + 1; }
+        // NUMA nodes that have workers (1 without workers).
+        unsigned getNumNodes() const { return NodeWeights.empty() ? 1 : static_cast<unsigned>(NodeWeights.size()); }
+
+        // Calls Body(ChunkBegin, ChunkEnd) on disjoint chunks covering [Begin, End), with
+        // chunks of at most Grain indices, and returns once all have finished.
+        void parallelFor(size_t Begin, size_t End, size_t Grain, llvm::function_ref<void(size_t, size_t)> Body);
+        // Queues T on the current worker's deque (or the shared queue outside the pool).
+        void submit(Task* T);
+        // Queues a task that calls Fn once.
+        template<typename Callable>
+        void submitFunction(Callable &&Fn) {
+            submit(new FunctionTask<std::decay_t<Callable>>(std::forward<Callable>(Fn)));
+        }
+        // Runs queued tasks until Done returns true. Used to wait for submitted work.
+        void helpUntil(llvm::function_ref<bool()> Done);
+        // Index of the pool worker running on this thread, or -1 for other threads.
+        static int getWorkerIndex();
+
+    private:
+        template<typename Callable>
+        class FunctionTask : public Task {
+        public:
+            explicit FunctionTask(Callable Fn) : Fn(std::move(Fn)) { }
+            void execute() override {
+                Fn();
+                delete this;
+            }
+        private:
+            Callable Fn;
+        };
+
+        // A mutex-protected queue, for tasks that are not pushed by a worker onto its deque.
+        class TaskQueue {
+        public:
+            void push(Task* T);
+            Task* pop();
+        private:
+            std::mutex Mutex;
+            std::deque<Task*> Tasks;
+            std::atomic<size_t> Size { 0 };
+        };
+
+        struct Worker {
+            WorkStealingDeque<Task*> Deque;
+            std::thread Thread;
+            // Index into Topology::getCPUs(), and the NUMA node of that CPU.
+            size_t CPUIndex = 0;
+            unsigned Node = 0;
+        };
+
+        explicit ThreadPool(unsigned NumWorkers);
+        void workerLoop(unsigned Index);
+        // Returns a task from this thread's deque, its node's queue, the shared queue,
+        // or another worker. Other nodes' queues and workers are tried last, and their
+        // queues only once the thread has been idle for Idle >= SpinLimit rounds, to
+        // give that node's own workers the first chance.
+        Task* findTask(unsigned Idle);
+        void wakeWorker();
+        void wakeAllWorkers();
+
+        std::vector<std::unique_ptr<Worker>> Workers;
+        // Tasks submitted from threads outside the pool.
+        TaskQueue Shared;
+        // Per node: the parts of NUMA-split loops, and the number of workers.
+        std::vector<std::unique_ptr<TaskQueue>> NodeQueues;
+        std::vector<unsigned> NodeWeights;
+        // Parking: sleepers wait for WorkVersion to change.
+        std::mutex SleepMutex;
+        std::condition_variable SleepCondition;
+        std::atomic<uint64_t> WorkVersion { 0 };
+        std::atomic<unsigned> NumSleeping { 0 };
+    };
+
+}
+#endif // NEXON_THREADPOOL_H
@@ -0,0 +1,39 @@
+#ifndef NEXON_TOKENBUFFER_H
+#define NEXON_TOKENBUFFER_H
+
+#include "Nexon/Lexer.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace Nexon {
+
+    // TokenBuffer holds every token of a source in struct-of-arrays form (kind,
+    // offset, length, numeric value), produced by one pass of the Lexer. It is
+    // immutable once filled, so it can be walked by index, backtracked over and
+    // shared by several parses or tools. The source must outlive the buffer.
+    class TokenBuffer {
+    public:
+        // Lexes Source into the buffer, replacing any previous contents. The last
+        // token is always tok_eof. Returns false if the source is too large.
+        bool tokenize(std::string_view Source);
+        size_t size() const { return Kinds.size(); }
+        int getKind(size_t I) const { return Kinds[I]; }
+        uint32_t getOffset(size_t I) const { return Offsets[I]; }
+        uint32_t getLength(size_t I) const { return Lengths[I]; }
+        double getNumVal(size_t I) const { return NumVals[I]; }
+        std::string_view getText(size_t I) const { return Source.substr(Offsets[I], Lengths[I]); }
+        // Line and column of token I; the line table is built on first use.
+        SourceLocation getLoc(size_t I) const;
+        std::string_view getSource() const { return Source; }
+    private:
+        std::string_view Source;
+        std::vector<int16_t> Kinds;
+        std::vector<uint32_t> Offsets;
+        std::vector<uint32_t> Lengths;
+        std::vector<double> NumVals;
+        mutable std::vector<uint32_t> LineStarts;
+    };
+
+}
+#endif // NEXON_TOKENBUFFER_H
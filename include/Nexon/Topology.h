@@ -0,0 +1,42 @@
+#ifndef NEXON_TOPOLOGY_H
+#define NEXON_TOPOLOGY_H
+
+#include <string_view>
+#include <vector>
+
+namespace Nexon {
+
+    // Topology describes the CPUs this process may use: the affinity mask
+    // (sched_getaffinity), the NUMA node of each CPU (/sys/devices/system/node) and
+    // the CPU quota of its cgroup (v2 cpu.max or v1 cpu.cfs_quota_us). On other
+    // systems every hardware thread is usable and there is a single node.
+    class Topology {
+    public:
+        // Discovered once, on first use.
+        static const Topology &get();
+
+        // Usable CPUs, grouped by node and ascending within a node.
+        const std::vector<unsigned> &getCPUs() const { return CPUs; }
+        // Nodes with at least one usable CPU, numbered densely from 0.
+        unsigned getNumNodes() const { return NumNodes; }
+        // Node of getCPUs()[Index].
+        unsigned getNodeOfCPU(size_t Index) const { return Nodes[Index]; }
+        // CPUs' worth of time the cgroup allows (rounded up), or 0 if unlimited.
+        unsigned getCPUQuota() const { return CPUQuota; }
+        // Threads that can run at once: usable CPUs, capped by the quota.
+        unsigned getConcurrency() const;
+
+        // Parses a sysfs CPU list such as "0-3,8,10-11".
+        static std::vector<unsigned> parseCPUList(std::string_view List);
+
+    private:
+        Topology();
+
+        std::vector<unsigned> CPUs;
+        std::vector<unsigned> Nodes;
+        unsigned NumNodes = 1;
+        unsigned CPUQuota = 0;
+    };
+
+}
+#endif // NEXON_TOPOLOGY_H
@@ -0,0 +1,53 @@
+#ifndef NEXON_TYPEINFERENCE_H
+#define NEXON_TYPEINFERENCE_H
+
+#include "Nexon/AST.h"
+#include "Nexon/Types.h"
+
+namespace Nexon {
+
+    class FunctionRegistry;
+
+    // TypeInference assigns a type to every expression of a function body, between
+    // parsing and code generation. Parameters and results take their annotations
+    // (f64 without one). A local variable takes its annotation, or else the widest
+    // type of the values ever assigned to it, so `var s = 0` followed by
+    // `s = s + 0.5` makes s an f64 while a counter stays i64. The rules:
+    //  - Integer literals are i64 and other literals f64, but a literal next to a
+    //    typed operand takes that operand's type: an integer literal if its value is
+    //    exactly representable there (2 becomes f32 beside an f32, 16777217 does not),
+    //    a float literal if the operand is a float (0.1 beside an f32 is rounded to
+    //    f32, so f32 kernels stay f32). A float literal never becomes an integer.
+    //  - Arithmetic converts both operands to the later type in bool, i32, i64, f32,
+    //    f64 order; bool arithmetic is i64 and '/' always divides as a float, f64 for
+    //    integers. Where an integer quotient is converted straight to an integer type
+    //    (a return value, argument, variable or i64(a / b)), code generation divides
+    //    with sdiv instead, with the same results but exact beyond 2^53.
+    //  - Comparisons give bool; conditions accept any type (nonzero is true).
+    //  - `reduce(op: acc)` reduces in acc's type, which widens as if every index
+    //    assigned `acc = acc op body`.
+    //  - A call to i32, i64, f32, f64 or bool converts its argument, unless a function
+    //    of that name exists.
+    class TypeInference {
+    public:
+        // Stores the types in the nodes of F's body. Callees are looked up in Functions.
+        static void run(const ASTContext &Ctx, const FunctionAST &F, const FunctionRegistry &Functions);
+        // Type both operands of the Binary node E are converted to; for a comparison it
+        // differs from E.Type.
+        static ValueType getOperandType(const ASTContext &Ctx, const ExprAST &E);
+        // Type two operands meet at. TLiteral and ULiteral are the operands' Number
+        // nodes, or null for other operands; a literal takes the other operand's type if
+        // fitsIn allows it.
+        static ValueType getCommonType(ValueType T, const ExprAST* TLiteral, ValueType U, const ExprAST* ULiteral);
+        // Whether the Number node Literal may take type T: an integer literal if its
+        // value is exactly representable in T, a float literal if T is a float type.
+        static bool fitsIn(const ExprAST &Literal, ValueType T);
+        // Whether Op is one of the comparison operators.
+        static bool isComparison(char Op);
+        // Type a call to Callee converts its argument to, or nothing for a call to a
+        // function.
+        static std::optional<ValueType> getConversion(std::string_view Callee, const FunctionRegistry &Functions);
+    };
+
+}
+#endif // NEXON_TYPEINFERENCE_H
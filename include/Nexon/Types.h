@@ -0,0 +1,25 @@
+#ifndef NEXON_TYPES_H
+#define NEXON_TYPES_H
+
+#include "llvm/IR/LLVMContext.h"
+#include "llvm/IR/Type.h"
+#include <cstdint>
+#include <optional>
+#include <string_view>
+
+namespace Nexon {
+
+    // Types of Nexon values, in promotion order: when two types meet in an operation,
+    // both operands are converted to the later one.
+    enum class ValueType : uint8_t { Bool, I32, I64, F32, F64 };
+
+    inline bool isFloatType(ValueType T) { return T == ValueType::F32 || T == ValueType::F64; }
+    inline ValueType joinTypes(ValueType T, ValueType U) { return T < U ? U : T; }
+
+    // Source spelling: "bool", "i32", "i64", "f32" or "f64".
+    const char* getTypeName(ValueType T);
+    std::optional<ValueType> parseTypeName(std::string_view Name);
+    llvm::Type* getLLVMType(llvm::LLVMContext &Ctx, ValueType T);
+
+}
+#endif // NEXON_TYPES_H
@@ -0,0 +1,107 @@
+#ifndef NEXON_WORKSTEALINGDEQUE_H
+#define NEXON_WORKSTEALINGDEQUE_H
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+namespace Nexon {
+
+    // WorkStealingDeque is the Chase-Lev deque (with the memory orderings of Lê et al.,
+    // "Correct and Efficient Work-Stealing for Weak Memory Models", PPoPP 2013). Its
+    // owner pushes and pops at the bottom without contention; any other thread may
+    // steal from the top. T is a pointer type; an empty result is nullptr. The buffer
+    // grows on demand, and outgrown buffers are kept until the deque is destroyed,
+    // since a concurrent thief may still be reading from one.
+    template<typename T>
+    class WorkStealingDeque {
+    public:
+        explicit WorkStealingDeque(int64_t Capacity = 256) {
+            Buffers.push_back(std::make_unique<Array>(Capacity));
+            Current.store(Buffers.back().get(), std::memory_order_relaxed);
+        }
+        WorkStealingDeque(const WorkStealingDeque &) = delete;
+        WorkStealingDeque &operator=(const WorkStealingDeque &) = delete;
+
+        // Owner only.
+        void push(T Item) {
+            int64_t B = Bottom.load(std::memory_order_relaxed);
+            int64_t Tp = Top.load(std::memory_order_acquire);
+            Array* A = Current.load(std::memory_order_relaxed);
+            if (B - Tp > A->Capacity - 1)
+                A = grow(A, B, Tp);
+            A->put(B, Item);
+            // A release store rather than the paper's release fence: equivalent, and
+            // visible to ThreadSanitizer, which does not model fences.
+            Bottom.store(B + 1, std::memory_order_release);
+        }
+
+        // Owner only. Takes the most recently pushed item.
+        T pop() {
+            int64_t B = Bottom.load(std::memory_order_relaxed) - 1;
+            Array* A = Current.load(std::memory_order_relaxed);
+            Bottom.store(B, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t Tp = Top.load(std::memory_order_relaxed);
+            if (Tp > B) {
+                Bottom.store(B + 1, std::memory_order_relaxed);
+                return nullptr;
+            }
+            T Item = A->get(B);
+            if (Tp == B) {
+                // The last item: race the thieves for it.
+                if (!Top.compare_exchange_strong(Tp, Tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                    Item = nullptr;
+                Bottom.store(B + 1, std::memory_order_relaxed);
+            }
+            return Item;
+        }
+
+        // Any thread. Takes the least recently pushed item; returns nullptr if the
+        // deque is empty or another thread won the race for the item.
+        T steal() {
+            int64_t Tp = Top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            int64_t B = Bottom.load(std::memory_order_acquire);
+            if (Tp >= B)
+                return nullptr;
+            Array* A = Current.load(std::memory_order_acquire);
+            T Item = A->get(Tp);
+            if (!Top.compare_exchange_strong(Tp, Tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                return nullptr;
+            return Item;
+        }
+
+        bool empty() const {
+            return Top.load(std::memory_order_relaxed) >= Bottom.load(std::memory_order_relaxed);
+        }
+
+    private:
+        struct Array {
+            explicit Array(int64_t Capacity) : Capacity(Capacity), Items(new std::atomic<T>[Capacity]) { }
+            T get(int64_t I) const { return Items[I & (Capacity - 1)].load(std::memory_order_relaxed); }
+            void put(int64_t I, T Item) { Items[I & (Capacity - 1)].store(Item, std::memory_order_relaxed); }
+            // A power of two.
+            int64_t Capacity;
+            std::unique_ptr<std::atomic<T>[]> Items;
+        };
+
+        Array* grow(Array* Old, int64_t B, int64_t Tp) {
+            Buffers.push_back(std::make_unique<Array>(Old->Capacity * 2));
+            Array* New = Buffers.back().get();
+            for (int64_t I = Tp; I < B; ++I)
+                New->put(I, Old->get(I));
+            Current.store(New, std::memory_order_release);
+            return New;
+        }
+
+        alignas(64) std::atomic<int64_t> Top { 0 };
+        alignas(64) std::atomic<int64_t> Bottom { 0 };
+        std::atomic<Array*> Current;
+        // Every buffer ever used; owner only.
+        std::vector<std::unique_ptr<Array>> Buffers;
+    };
+
+}
+#endif // NEXON_WORKSTEALINGDEQUE_H
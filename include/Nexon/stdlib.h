@@ -1,76 +1,151 @@
-#ifndef NEXON_STDLIB_H
-#define NEXON_STDLIB_H
-
-#include <cmath>
-#include <vector>
-#include <string>
-#include <complex>
-#include <sstream>
-#include <iostream>
-#include <iomanip>
-
-// Nexon Standard Library – production‑ready implementations of basic math and physics functions.
-namespace NexonStd {
-
-    inline double sqrt(double x) { return std::sqrt(x); }
-    inline double sin(double x)  { return std::sin(x); }
-    inline double cos(double x)  { return std::cos(x); }
-    inline double tan(double x)  { return std::tan(x); }
-    inline double log(double x)  { return std::log(x); }
-    inline double exp(double x)  { return std::exp(x); }
-
-    inline double gravitationalForce(double m1, double m2, double distance) {
-        const double G = 6.67430e-11;
-        return (G * m1 * m2) / (distance * distance);
-    }
-
-    class Vector3 {
-    public:
-        double x, y, z;
-        Vector3(double x = 0.0, double y = 0.0, double z = 0.0) : x(x), y(y), z(z) { }
-        Vector3 operator+(const Vector3 &other) const { return Vector3(x + other.x, y + other.y, z + other.z); }
-        Vector3 operator-(const Vector3 &other) const { return Vector3(x - other.x, y - other.y, z - other.z); }
-        Vector3 operator*(double scalar) const { return Vector3(x * scalar, y * scalar, z * scalar); }
-        double dot(const Vector3 &other) const { return x * other.x + y * other.y + z * other.z; }
-        double magnitude() const { return std::sqrt(x*x + y*y + z*z); }
-    };
-
-    template<typename T>
-    class BigArray {
-    public:
-        BigArray(size_t n) : data(n) { }
-        T& operator[](size_t i) { return data[i]; }
-        const T& operator[](size_t i) const { return data[i]; }
-        size_t size() const { return data.size(); }
-    private:
-        std::vector<T> data;
-    };
-
-    template<typename T>
-    std::string vectorToString(const std::vector<T>& vec) {
-        std::ostringstream oss;
-        oss << "[";
-        for (size_t i = 0; i < vec.size(); i++) {
-            oss << std::fixed << std::setprecision(2) << vec[i];
-            if (i != vec.size() - 1) oss << ", ";
-        }
-        oss << "]";
-        return oss.str();
-    }
-
-    template<typename T>
-    T average(const std::vector<T>& vec) {
-        T sum = 0;
-        for (const auto &v : vec) sum += v;
-        return sum / vec.size();
-    }
-
-    template<typename T>
-    T standardDeviation(const std::vector<T>& vec) {
-        T avg = average(vec);
-        T variance = 0;
-        for (const auto &v : vec) variance += (v - avg) * (v - avg);
-        return sqrt(variance / vec.size());
-    }
-}
-#endif // NEXON_STDLIB_H
+#ifndef NEXON_STDLIB_H
+#define NEXON_STDLIB_H
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+#include <string>
+#include <complex>
+#include <sstream>
+#include <iostream>
+#include <iomanip>
+#include <memory>
+#include <type_traits>
+#include <utility>
+#include "Nexon/Concurrency.h"
+
+// Nexon Standard Library – production‑ready implementations of basic math and physics functions.
+namespace NexonStd {
+
+    inline double sqrt(double x) { return std::sqrt(x); }
+    inline double sin(double x)  { return std::sin(x); }
+    inline double cos(double x)  { return std::cos(x); }
+    inline double tan(double x)  { return std::tan(x); }
+    inline double log(double x)  { return std::log(x); }
+    inline double exp(double x)  { return std::exp(x); }
+
+    inline double gravitationalForce(double m1, double m2, double distance) {
+        const double G = 6.67430e-11;
+        return (G * m1 * m2) / (distance * distance);
+    }
+
+    class Vector3 {
+    public:
+        double x, y, z;
+        Vector3(double x = 0.0, double y = 0.0, double z = 0.0) : x(x), y(y), z(z) { }
+        Vector3 operator+(const Vector3 &other) const { return Vector3(x + other.x, y + other.y, z + other.z); }
+        Vector3 operator-(const Vector3 &other) const { return Vector3(x - other.x, y - other.y, z - other.z); }
+        Vector3 operator*(double scalar) const { return Vector3(x * scalar, y * scalar, z * scalar); }
+        double dot(const Vector3 &other) const { return x * other.x + y * other.y + z * other.z; }
+        double magnitude() const { return std::sqrt(x*x + y*y + z*z); }
+    };
+
+    // BigArray is a contiguous array of n elements. Copies are deep. share() returns an
+    // array over the same memory, and an array can view memory owned by someone else
+    // (e.g. a NumPy array), so large arrays move between Nexon and Python without
+    // copying.
+    //
+    // The constructor allocates on the calling thread. distributed() instead spreads the
+    // pages over the NUMA nodes that will process them (Concurrency::allocateDistributed).
+    // Like the statistics below, it runs on Nexon's thread pool, so it starts the pool
+    // and needs the runtime (libnexonrt) at link time.
+    template<typename T>
+    class BigArray {
+    public:
+        BigArray(size_t n) : BigArray(std::shared_ptr<T[]>(new T[n]()), n) { }
+        // Views n elements at data, which stay valid for as long as owner is alive.
+        BigArray(T* data, size_t n, std::shared_ptr<void> owner) : owner(std::move(owner)), ptr(data), count(n) { }
+        BigArray(const BigArray &other) : BigArray(other.count) { std::copy(other.ptr, other.ptr + count, ptr); }
+        BigArray(BigArray &&other) noexcept
+            : owner(std::move(other.owner)), ptr(std::exchange(other.ptr, nullptr)), count(std::exchange(other.count, 0)) { }
+        BigArray &operator=(BigArray other) noexcept {
+            std::swap(owner, other.owner);
+            std::swap(ptr, other.ptr);
+            std::swap(count, other.count);
+            return *this;
+        }
+
+        static BigArray distributed(size_t n) { return BigArray(Nexon::Concurrency::allocateDistributed<T>(n), n); }
+        // An array over the same elements; writes through either are seen by both.
+        BigArray share() { return BigArray(ptr, count, owner); }
+
+        T& operator[](size_t i) { return ptr[i]; }
+        const T& operator[](size_t i) const { return ptr[i]; }
+        T* data() { return ptr; }
+        const T* data() const { return ptr; }
+        size_t size() const { return count; }
+        const std::shared_ptr<void>& getOwner() const { return owner; }
+    private:
+        BigArray(std::shared_ptr<T[]> storage, size_t n) : owner(storage), ptr(storage.get()), count(n) { }
+
+        std::shared_ptr<void> owner;
+        T* ptr;
+        size_t count;
+    };
+
+    // Bounded queue for producer/consumer pipelines (see Nexon::Channel).
+    template<typename T>
+    using Channel = Nexon::Channel<T>;
+
+    template<typename T>
+    std::string vectorToString(const std::vector<T>& vec) {
+        std::ostringstream oss;
+        oss << "[";
+        for (size_t i = 0; i < vec.size(); i++) {
+            oss << std::fixed << std::setprecision(2) << vec[i];
+            if (i != vec.size() - 1) oss << ", ";
+        }
+        oss << "]";
+        return oss.str();
+    }
+
+    // Statistics of integers are doubles, and floats are accumulated in double, so
+    // sums neither overflow nor truncate.
+    template<typename T>
+    using StatisticType = std::conditional_t<std::is_arithmetic_v<T>, std::common_type_t<T, double>, T>;
+
+    // Parallel statistics over n contiguous values. Reductions use a fixed block size
+    // and combination tree, so results do not depend on the thread count.
+    template<typename T>
+    StatisticType<T> sum(const T* values, size_t n) {
+        using S = StatisticType<T>;
+        return Nexon::Concurrency::parallelTransformReduce(size_t(0), n, S(0),
+            [values](size_t i) { return static_cast<S>(values[i]); },
+            [](S a, S b) { return a + b; }, Nexon::ReductionOrder::Deterministic);
+    }
+
+    template<typename T>
+    StatisticType<T> average(const T* values, size_t n) {
+        return sum(values, n) / static_cast<StatisticType<T>>(n);
+    }
+
+    // Two passes (mean, then squared deviations), which stays accurate when the
+    // deviations are small relative to the mean.
+    template<typename T>
+    StatisticType<T> standardDeviation(const T* values, size_t n) {
+        using S = StatisticType<T>;
+        S avg = average(values, n);
+        S variance = Nexon::Concurrency::parallelTransformReduce(size_t(0), n, S(0),
+            [values, avg](size_t i) {
+                S d = static_cast<S>(values[i]) - avg;
+                return d * d;
+            },
+            [](S a, S b) { return a + b; }, Nexon::ReductionOrder::Deterministic);
+        return std::sqrt(variance / static_cast<S>(n));
+    }
+
+    template<typename T>
+    StatisticType<T> sum(const std::vector<T>& vec) { return sum(vec.data(), vec.size()); }
+    template<typename T>
+    StatisticType<T> average(const std::vector<T>& vec) { return average(vec.data(), vec.size()); }
+    template<typename T>
+    StatisticType<T> standardDeviation(const std::vector<T>& vec) { return standardDeviation(vec.data(), vec.size()); }
+
+    template<typename T>
+    StatisticType<T> sum(const BigArray<T>& arr) { return sum(arr.data(), arr.size()); }
+    template<typename T>
+    StatisticType<T> average(const BigArray<T>& arr) { return average(arr.data(), arr.size()); }
+    template<typename T>
+    StatisticType<T> standardDeviation(const BigArray<T>& arr) { return standardDeviation(arr.data(), arr.size()); }
+}
+#endif // NEXON_STDLIB_H
@@ -1,92 +1,799 @@
-#include "Nexon/AST.h"
-#include "Nexon/CodeGen.h"
-#include <iostream>
-#include "llvm/IR/Verifier.h"
-
-namespace Nexon {
-using namespace llvm;
-
-Value* NumberExprAST::codegen() {
-    return ConstantFP::get(CodeGen::getGlobalContext(), APFloat(Val));
-}
-
-Value* VariableExprAST::codegen() {
-    Value* V = CodeGen::getNamedValue(Name);
-    if (!V) {
-        std::cerr << "Error: Unknown variable " << Name << "\n";
-        return nullptr;
-    }
-    return V;
-}
-
-Value* BinaryExprAST::codegen() {
-    Value* L = LHS->codegen();
-    Value* R = RHS->codegen();
-    if (!L || !R)
-        return nullptr;
-    switch (Op) {
-        case '+': return CodeGen::Builder()->CreateFAdd(L, R, "addtmp");
-        case '-': return CodeGen::Builder()->CreateFSub(L, R, "subtmp");
-        case '*': return CodeGen::Builder()->CreateFMul(L, R, "multmp");
-        case '/': return CodeGen::Builder()->CreateFDiv(L, R, "divtmp");
-        default:
-            std::cerr << "Error: Unknown binary operator " << Op << "\n";
-            return nullptr;
-    }
-}
-
-Value* CallExprAST::codegen() {
-    Function* CalleeF = CodeGen::TheModule()->getFunction(Callee);
-    if (!CalleeF) {
-        std::cerr << "Error: Function " << Callee << " not found.\n";
-        return nullptr;
-    }
-    if (CalleeF->arg_size() != Args.size()) {
-        std::cerr << "Error: Incorrect number of arguments for function " << Callee << "\n";
-        return nullptr;
-    }
-    std::vector<Value*> ArgsV;
-    for (unsigned i = 0; i < Args.size(); ++i) {
-        ArgsV.push_back(Args[i]->codegen());
-        if (!ArgsV.back())
-            return nullptr;
-    }
-    return CodeGen::Builder()->CreateCall(CalleeF, ArgsV, "calltmp");
-}
-
-Function* PrototypeAST::codegen() {
-    std::vector<Type*> Doubles(Args.size(), Type::getDoubleTy(CodeGen::getGlobalContext()));
-    FunctionType* FT = FunctionType::get(Type::getDoubleTy(CodeGen::getGlobalContext()), Doubles, false);
-    Function* F = Function::Create(FT, Function::ExternalLinkage, getName(), CodeGen::TheModule());
-    unsigned Idx = 0;
-    for (auto &Arg : F->args())
-        Arg.setName(Args[Idx++]);
-    return F;
-}
-
-Function* FunctionAST::codegen() {
-    Function* TheFunction = CodeGen::TheModule()->getFunction(Proto->getName());
-    if (!TheFunction)
-        TheFunction = Proto->codegen();
-    if (!TheFunction)
-        return nullptr;
-    BasicBlock* BB = BasicBlock::Create(CodeGen::getGlobalContext(), "entry", TheFunction);
-    CodeGen::Builder()->SetInsertPoint(BB);
-    CodeGen::clearNamedValues();
-    for (auto &Arg : TheFunction->args())
-        CodeGen::setNamedValue(std::string(Arg.getName()), &Arg);
-    if (Value* RetVal = Body->codegen()) {
-        CodeGen::Builder()->CreateRet(RetVal);
-        verifyFunction(*TheFunction);
-        return TheFunction;
-    }
-    TheFunction->eraseFromParent();
-    return nullptr;
-}
-
-void additionalASTRoutine() {
-    for (int i = 0; i < 50; ++i) {
-        std::cerr << "AST processing iteration " << i << "\n";
-    }
-}
-}
+#include "Nexon/AST.h"
+#include "Nexon/CodeGen.h"
+#include "Nexon/TypeInference.h"
+#include <algorithm>
+#include <iostream>
+#include <limits>
+#include "llvm/ADT/STLExtras.h"
+#include "llvm/ADT/SmallVector.h"
+#include "llvm/IR/Verifier.h"
+
+namespace Nexon {
+using namespace llvm;
+
+Symbol ASTContext::intern(std::string_view Name) {
+    auto Inserted = Names.try_emplace(StringRef(Name), static_cast<Symbol>(SymbolNames.size()));
+    if (Inserted.second)
+        SymbolNames.push_back(std::string_view(Inserted.first->getKey()));
+    return Inserted.first->getValue();
+}
+
+uint32_t ASTContext::appendList(ArrayRef<uint32_t> Items) {
+    uint32_t First = static_cast<uint32_t>(Lists.size());
+    Lists.insert(Lists.end(), Items.begin(), Items.end());
+    return First;
+}
+
+ExprRef ASTContext::makeNumber(double Val) {
+    ExprAST E{};
+    E.Kind = ExprKind::Number;
+    E.Type = ValueType::F64;
+    E.Num = Val;
+    return Exprs.push(E);
+}
+
+ExprRef ASTContext::makeInteger(int64_t Val) {
+    ExprAST E{};
+    E.Kind = ExprKind::Number;
+    E.Type = ValueType::I64;
+    E.Int = Val;
+    return Exprs.push(E);
+}
+
+ExprRef ASTContext::makeVariable(Symbol Name) {
+    ExprAST E{};
+    E.Kind = ExprKind::Variable;
+    E.A = Name;
+    return Exprs.push(E);
+}
+
+ExprRef ASTContext::makeBinary(char Op, ExprRef LHS, ExprRef RHS) {
+    ExprAST E{};
+    E.Kind = ExprKind::Binary;
+    E.Op = Op;
+    E.A = LHS;
+    E.Operands[0] = RHS;
+    return Exprs.push(E);
+}
+
+ExprRef ASTContext::makeCall(Symbol Callee, ArrayRef<ExprRef> Args) {
+    ExprAST E{};
+    E.Kind = ExprKind::Call;
+    E.A = Callee;
+    E.Operands[0] = appendList(Args);
+    E.Operands[1] = static_cast<uint32_t>(Args.size());
+    return Exprs.push(E);
+}
+
+ExprRef ASTContext::makeBlock(ArrayRef<ExprRef> Body) {
+    ExprAST E{};
+    E.Kind = ExprKind::Block;
+    E.Operands[0] = appendList(Body);
+    E.Operands[1] = static_cast<uint32_t>(Body.size());
+    return Exprs.push(E);
+}
+
+ExprRef ASTContext::makeParallelFor(Symbol Var, ExprRef Start, ExprRef End, ExprRef Grain, ExprRef Body,
+                                    char ReduceOp, Symbol Accumulator) {
+    ExprAST E{};
+    E.Kind = ExprKind::ParallelFor;
+    E.Op = ReduceOp;
+    E.A = Var;
+    E.Operands[0] = appendList({ Start, End, Grain, Body, Accumulator });
+    E.Operands[1] = 5;
+    return Exprs.push(E);
+}
+
+ExprRef ASTContext::makeIf(ExprRef Cond, ExprRef Then, ExprRef Else) {
+    ExprAST E{};
+    E.Kind = ExprKind::If;
+    E.A = Cond;
+    E.Operands[0] = Then;
+    E.Operands[1] = Else;
+    return Exprs.push(E);
+}
+
+ExprRef ASTContext::makeFor(Symbol Var, ExprRef Start, ExprRef End, ExprRef Step, ExprRef Body) {
+    ExprAST E{};
+    E.Kind = ExprKind::For;
+    E.A = Var;
+    E.Operands[0] = appendList({ Start, End, Step, Body });
+    E.Operands[1] = 4;
+    return Exprs.push(E);
+}
+
+ExprRef ASTContext::makeWhile(ExprRef Cond, ExprRef Body) {
+    ExprAST E{};
+    E.Kind = ExprKind::While;
+    E.A = Cond;
+    E.Operands[0] = Body;
+    return Exprs.push(E);
+}
+
+ExprRef ASTContext::makeVar(Symbol Name, ExprRef Init, std::optional<ValueType> Type) {
+    ExprAST E{};
+    E.Kind = ExprKind::Var;
+    E.A = Name;
+    E.Operands[0] = Init;
+    E.Operands[1] = Type ? static_cast<uint32_t>(*Type) : InvalidRef;
+    return Exprs.push(E);
+}
+
+ProtoRef ASTContext::makePrototype(Symbol Name, ArrayRef<Symbol> Params, ArrayRef<ValueType> ParamTypes,
+                                   ValueType ReturnType) {
+    PrototypeAST P;
+    P.Name = Name;
+    P.FirstParam = appendList(Params);
+    P.NumParams = static_cast<uint32_t>(Params.size());
+    P.FirstParamType = static_cast<uint32_t>(Lists.size());
+    for (size_t I = 0; I < Params.size(); ++I)
+        Lists.push_back(static_cast<uint32_t>(I < ParamTypes.size() ? ParamTypes[I] : ValueType::F64));
+    P.ReturnType = ReturnType;
+    return Protos.push(P);
+}
+
+FuncRef ASTContext::makeFunction(ProtoRef Proto, ExprRef Body) {
+    FunctionAST F;
+    F.Proto = Proto;
+    F.Body = Body;
+    return Functions.push(F);
+}
+
+static Value* codegenNumber(CompilationSession &S, const ExprAST &E) {
+    Type* Ty = getLLVMType(S.getContext(), E.Type);
+    if (isFloatType(E.Type))
+        return ConstantFP::get(Ty, E.Num);
+    return ConstantInt::get(Ty, static_cast<uint64_t>(E.Int), /*isSigned=*/true);
+}
+
+static Value* codegenVariable(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E) {
+    std::string_view Name = Ctx.getName(E.A);
+    AllocaInst* Slot = S.getNamedValue(Name);
+    if (!Slot) {
+        std::cerr << "Error: Unknown variable " << Name << "\n";
+        return nullptr;
+    }
+    return S.getBuilder().CreateLoad(Slot->getAllocatedType(), Slot, StringRef(Name));
+}
+
+// Whether E is a '/' of two integer operands. Its value is an f64, but where it is
+// converted straight to an integer type it is computed by codegenIntegerDivision.
+static bool isIntegerDivision(const ASTContext &Ctx, const ExprAST &E) {
+    if (E.Kind != ExprKind::Binary || E.Op != '/')
+        return false;
+    const ExprAST &L = Ctx.getExpr(E.A);
+    const ExprAST &R = Ctx.getExpr(E.Operands[0]);
+    return !isFloatType(TypeInference::getCommonType(L.Type, L.Kind == ExprKind::Number ? &L : nullptr, R.Type,
+                                                     R.Kind == ExprKind::Number ? &R : nullptr));
+}
+
+static Value* codegenIntegerDivision(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E, Type* To);
+
+// Lowers E and converts its value to To.
+static Value* codegenAs(const ASTContext &Ctx, CompilationSession &S, ExprRef E, Type* To) {
+    const ExprAST &Node = Ctx.getExpr(E);
+    if (To->isIntegerTy() && !To->isIntegerTy(1) && isIntegerDivision(Ctx, Node))
+        return codegenIntegerDivision(Ctx, S, Node, To);
+    Value* V = Node.codegen(Ctx, S);
+    return V ? S.createConversion(V, To) : nullptr;
+}
+
+static Value* codegenAs(const ASTContext &Ctx, CompilationSession &S, ExprRef E, ValueType To) {
+    return codegenAs(Ctx, S, E, getLLVMType(S.getContext(), To));
+}
+
+// An integer a / b converted to the integer type To, with sdiv instead of through f64,
+// so it is exact beyond 2^53. The results are those of converting the f64 quotient:
+// truncated toward zero and saturated to To, and x / 0 is To's maximum for x > 0, its
+// minimum for x < 0 and 0 for 0 / 0.
+static Value* codegenIntegerDivision(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E, Type* To) {
+    Value* L = codegenAs(Ctx, S, E.A, ValueType::I64);
+    Value* R = L ? codegenAs(Ctx, S, E.Operands[0], ValueType::I64) : nullptr;
+    if (!R)
+        return nullptr;
+    IRBuilder<> &Builder = S.getBuilder();
+    Type* Int64Ty = Builder.getInt64Ty();
+    Constant* Zero = ConstantInt::get(Int64Ty, 0);
+    Constant* Max = ConstantInt::get(Int64Ty, APInt::getSignedMaxValue(64));
+    Constant* Min = ConstantInt::get(Int64Ty, APInt::getSignedMinValue(64));
+    Value* ByZero = Builder.CreateICmpEQ(R, Zero, "divzero");
+    // The quotient of INT64_MIN / -1, 2^63, does not fit and saturates.
+    Value* Overflow = Builder.CreateAnd(Builder.CreateICmpEQ(L, Min),
+                                        Builder.CreateICmpEQ(R, ConstantInt::getSigned(Int64Ty, -1)), "divoverflow");
+    Value* Divisor = Builder.CreateSelect(Builder.CreateOr(ByZero, Overflow), ConstantInt::get(Int64Ty, 1), R);
+    Value* Quotient = Builder.CreateSDiv(L, Divisor, "divtmp");
+    Quotient = Builder.CreateSelect(Overflow, Max, Quotient);
+    Value* SignOfL = Builder.CreateSelect(Builder.CreateICmpSGT(L, Zero), Max,
+                                          Builder.CreateSelect(Builder.CreateICmpSLT(L, Zero), Min, Zero));
+    Quotient = Builder.CreateSelect(ByZero, SignOfL, Quotient, "quot");
+    unsigned Bits = To->getIntegerBitWidth();
+    if (Bits < 64) {
+        Quotient = Builder.CreateBinaryIntrinsic(
+            Intrinsic::smax, Quotient, ConstantInt::get(Int64Ty, APInt::getSignedMinValue(Bits).sext(64)));
+        Quotient = Builder.CreateBinaryIntrinsic(
+            Intrinsic::smin, Quotient, ConstantInt::get(Int64Ty, APInt::getSignedMaxValue(Bits).sext(64)));
+    }
+    return Builder.CreateTrunc(Quotient, To, "conv");
+}
+
+static Value* codegenAssignment(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E) {
+    const ExprAST &Target = Ctx.getExpr(E.A);
+    if (Target.Kind != ExprKind::Variable) {
+        std::cerr << "Error: Left side of '=' must be a variable\n";
+        return nullptr;
+    }
+    std::string_view Name = Ctx.getName(Target.A);
+    AllocaInst* Slot = S.getNamedValue(Name);
+    if (!Slot) {
+        std::cerr << "Error: Unknown variable " << Name << "\n";
+        return nullptr;
+    }
+    Value* Val = codegenAs(Ctx, S, E.Operands[0], Slot->getAllocatedType());
+    if (!Val)
+        return nullptr;
+    S.getBuilder().CreateStore(Val, Slot);
+    return Val;
+}
+
+static Value* codegenBinary(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E) {
+    if (E.Op == '=')
+        return codegenAssignment(Ctx, S, E);
+    ValueType OperandType = TypeInference::getOperandType(Ctx, E);
+    Value* L = codegenAs(Ctx, S, E.A, OperandType);
+    Value* R = L ? codegenAs(Ctx, S, E.Operands[0], OperandType) : nullptr;
+    if (!R)
+        return nullptr;
+    IRBuilder<> &Builder = S.getBuilder();
+    if (isFloatType(OperandType)) {
+        // Any comparison with NaN is false except '!='.
+        switch (E.Op) {
+            case '+': return Builder.CreateFAdd(L, R, "addtmp");
+            case '-': return Builder.CreateFSub(L, R, "subtmp");
+            case '*': return Builder.CreateFMul(L, R, "multmp");
+            case '/': return Builder.CreateFDiv(L, R, "divtmp");
+            case '<': return Builder.CreateFCmpOLT(L, R, "cmptmp");
+            case '>': return Builder.CreateFCmpOGT(L, R, "cmptmp");
+            case OpLessEqual: return Builder.CreateFCmpOLE(L, R, "cmptmp");
+            case OpGreaterEqual: return Builder.CreateFCmpOGE(L, R, "cmptmp");
+            case OpEqual: return Builder.CreateFCmpOEQ(L, R, "cmptmp");
+            case OpNotEqual: return Builder.CreateFCmpUNE(L, R, "cmptmp");
+            default: break;
+        }
+    } else {
+        // Only comparisons reach here with bool operands; false < true.
+        bool Unsigned = OperandType == ValueType::Bool;
+        switch (E.Op) {
+            case '+': return Builder.CreateNSWAdd(L, R, "addtmp");
+            case '-': return Builder.CreateNSWSub(L, R, "subtmp");
+            case '*': return Builder.CreateNSWMul(L, R, "multmp");
+            case '<': return Unsigned ? Builder.CreateICmpULT(L, R, "cmptmp") : Builder.CreateICmpSLT(L, R, "cmptmp");
+            case '>': return Unsigned ? Builder.CreateICmpUGT(L, R, "cmptmp") : Builder.CreateICmpSGT(L, R, "cmptmp");
+            case OpLessEqual:
+                return Unsigned ? Builder.CreateICmpULE(L, R, "cmptmp") : Builder.CreateICmpSLE(L, R, "cmptmp");
+            case OpGreaterEqual:
+                return Unsigned ? Builder.CreateICmpUGE(L, R, "cmptmp") : Builder.CreateICmpSGE(L, R, "cmptmp");
+            case OpEqual: return Builder.CreateICmpEQ(L, R, "cmptmp");
+            case OpNotEqual: return Builder.CreateICmpNE(L, R, "cmptmp");
+            default: break;
+        }
+    }
+    std::cerr << "Error: Unknown binary operator " << E.Op << "\n";
+    return nullptr;
+}
+
+static Value* codegenCall(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E) {
+    std::string_view Callee = Ctx.getName(E.A);
+    ArrayRef<uint32_t> Args = Ctx.getList(E.Operands[0], E.Operands[1]);
+    if (TypeInference::getConversion(Callee, *S.getFunctionRegistry())) {
+        if (Args.size() != 1) {
+            std::cerr << "Error: Conversion to " << Callee << " takes one argument\n";
+            return nullptr;
+        }
+        return codegenAs(Ctx, S, Args[0], E.Type);
+    }
+    Function* CalleeF = S.getFunction(Callee);
+    if (!CalleeF) {
+        std::cerr << "Error: Function " << Callee << " not found.\n";
+        return nullptr;
+    }
+    if (CalleeF->arg_size() != Args.size()) {
+        std::cerr << "Error: Incorrect number of arguments for function " << Callee << "\n";
+        return nullptr;
+    }
+    std::vector<Value*> ArgsV;
+    ArgsV.reserve(Args.size());
+    for (size_t I = 0; I < Args.size(); ++I) {
+        Value* Arg = codegenAs(Ctx, S, Args[I], CalleeF->getArg(static_cast<unsigned>(I))->getType());
+        if (!Arg)
+            return nullptr;
+        ArgsV.push_back(Arg);
+    }
+    return S.getBuilder().CreateCall(CalleeF, ArgsV, "calltmp");
+}
+
+static Value* codegenBlock(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E) {
+    // The value of a block is the value of its last expression. Variables declared in
+    // the block go out of scope at its end.
+    CompilationSession::NameScope Outer = S.saveNamedValues();
+    Value* Last = Constant::getNullValue(getLLVMType(S.getContext(), E.Type));
+    for (ExprRef Item : Ctx.getList(E.Operands[0], E.Operands[1])) {
+        Last = Ctx.getExpr(Item).codegen(Ctx, S);
+        if (!Last)
+            break;
+    }
+    S.restoreNamedValues(std::move(Outer));
+    return Last;
+}
+
+static Value* codegenIf(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E) {
+    Value* Cond = codegenAs(Ctx, S, E.A, ValueType::Bool);
+    if (!Cond)
+        return nullptr;
+    IRBuilder<> &Builder = S.getBuilder();
+    LLVMContext &C = S.getContext();
+    Function* F = Builder.GetInsertBlock()->getParent();
+    BasicBlock* ThenBB = BasicBlock::Create(C, "then", F);
+    BasicBlock* ElseBB = BasicBlock::Create(C, "else", F);
+    BasicBlock* MergeBB = BasicBlock::Create(C, "ifcont", F);
+    Builder.CreateCondBr(Cond, ThenBB, ElseBB);
+
+    Builder.SetInsertPoint(ThenBB);
+    Value* ThenVal = codegenAs(Ctx, S, E.Operands[0], E.Type);
+    if (!ThenVal)
+        return nullptr;
+    Builder.CreateBr(MergeBB);
+    // Nested control flow moves the end of each branch to a block of its own.
+    BasicBlock* ThenEnd = Builder.GetInsertBlock();
+
+    Builder.SetInsertPoint(ElseBB);
+    // Without an else branch the value is 0.
+    Value* ElseVal = E.Operands[1] == InvalidRef ? Constant::getNullValue(ThenVal->getType())
+                                                 : codegenAs(Ctx, S, E.Operands[1], E.Type);
+    if (!ElseVal)
+        return nullptr;
+    Builder.CreateBr(MergeBB);
+    BasicBlock* ElseEnd = Builder.GetInsertBlock();
+
+    MergeBB->moveAfter(ElseEnd);
+    Builder.SetInsertPoint(MergeBB);
+    PHINode* PN = Builder.CreatePHI(ThenVal->getType(), 2, "iftmp");
+    PN->addIncoming(ThenVal, ThenEnd);
+    PN->addIncoming(ElseVal, ElseEnd);
+    return PN;
+}
+
+// for i = start, end [, step] body
+//
+// Runs body with i = start, start + step, ... while i < end, or while i > end for a
+// negative step. end and step (default 1) are evaluated once. i is a local of the
+// loop that the body may assign. The value of the loop is 0.
+static Value* codegenFor(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E) {
+    ArrayRef<uint32_t> Parts = Ctx.getList(E.Operands[0], E.Operands[1]);
+    IRBuilder<> &Builder = S.getBuilder();
+    LLVMContext &C = S.getContext();
+    std::string_view VarName = Ctx.getName(E.A);
+    ValueType VarType = E.DeclType;
+    const ExprAST &EndExpr = Ctx.getExpr(Parts[1]);
+    // i is compared with end in the type they meet at, so `for i = 0, n` with an f64 n
+    // keeps an integer counter.
+    ValueType CompareType = TypeInference::getCommonType(VarType, nullptr, EndExpr.Type,
+                                                         EndExpr.Kind == ExprKind::Number ? &EndExpr : nullptr);
+    Value* Start = codegenAs(Ctx, S, Parts[0], VarType);
+    Value* End = Start ? codegenAs(Ctx, S, Parts[1], CompareType) : nullptr;
+    if (!End)
+        return nullptr;
+    Value* Step = S.createConversion(ConstantInt::get(Type::getInt64Ty(C), 1), VarType);
+    if (Parts[2] != InvalidRef) {
+        Step = codegenAs(Ctx, S, Parts[2], VarType);
+        if (!Step)
+            return nullptr;
+    }
+    AllocaInst* Slot = S.createLocal(Start->getType(), VarName);
+    Builder.CreateStore(Start, Slot);
+    AllocaInst* Shadowed = S.getNamedValue(VarName);
+    S.setNamedValue(VarName, Slot);
+
+    Function* F = Builder.GetInsertBlock()->getParent();
+    BasicBlock* CondBB = BasicBlock::Create(C, "forcond", F);
+    BasicBlock* BodyBB = BasicBlock::Create(C, "forbody", F);
+    BasicBlock* AfterBB = BasicBlock::Create(C, "forend", F);
+    Value* Zero = Constant::getNullValue(Step->getType());
+    Value* Forward = isFloatType(VarType) ? Builder.CreateFCmpOGE(Step, Zero, "forward")
+                                          : Builder.CreateICmpSGE(Step, Zero, "forward");
+    Builder.CreateBr(CondBB);
+    Builder.SetInsertPoint(CondBB);
+    Value* Cur = S.createConversion(Builder.CreateLoad(Slot->getAllocatedType(), Slot, StringRef(VarName)),
+                                    CompareType);
+    Value* Up = isFloatType(CompareType) ? Builder.CreateFCmpOLT(Cur, End, "up") : Builder.CreateICmpSLT(Cur, End, "up");
+    Value* Down = isFloatType(CompareType) ? Builder.CreateFCmpOGT(Cur, End, "down")
+                                           : Builder.CreateICmpSGT(Cur, End, "down");
+    Builder.CreateCondBr(Builder.CreateSelect(Forward, Up, Down, "forcond"), BodyBB, AfterBB);
+
+    Builder.SetInsertPoint(BodyBB);
+    if (!Ctx.getExpr(Parts[3]).codegen(Ctx, S))
+        return nullptr;
+    Value* Cur2 = Builder.CreateLoad(Slot->getAllocatedType(), Slot, StringRef(VarName));
+    Value* Next = isFloatType(VarType) ? Builder.CreateFAdd(Cur2, Step, "nextvar")
+                                       : Builder.CreateNSWAdd(Cur2, Step, "nextvar");
+    Builder.CreateStore(Next, Slot);
+    Builder.CreateBr(CondBB);
+
+    AfterBB->moveAfter(Builder.GetInsertBlock());
+    Builder.SetInsertPoint(AfterBB);
+    S.setNamedValue(VarName, Shadowed);
+    return Constant::getNullValue(getLLVMType(C, E.Type));
+}
+
+// while cond body; the value of the loop is 0.
+static Value* codegenWhile(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E) {
+    IRBuilder<> &Builder = S.getBuilder();
+    LLVMContext &C = S.getContext();
+    Function* F = Builder.GetInsertBlock()->getParent();
+    BasicBlock* CondBB = BasicBlock::Create(C, "whilecond", F);
+    BasicBlock* BodyBB = BasicBlock::Create(C, "whilebody", F);
+    BasicBlock* AfterBB = BasicBlock::Create(C, "whileend", F);
+    Builder.CreateBr(CondBB);
+    Builder.SetInsertPoint(CondBB);
+    Value* Cond = codegenAs(Ctx, S, E.A, ValueType::Bool);
+    if (!Cond)
+        return nullptr;
+    Builder.CreateCondBr(Cond, BodyBB, AfterBB);
+
+    Builder.SetInsertPoint(BodyBB);
+    if (!Ctx.getExpr(E.Operands[0]).codegen(Ctx, S))
+        return nullptr;
+    Builder.CreateBr(CondBB);
+
+    AfterBB->moveAfter(Builder.GetInsertBlock());
+    Builder.SetInsertPoint(AfterBB);
+    return Constant::getNullValue(getLLVMType(C, E.Type));
+}
+
+// var x [: type] [= init]: declares x until the end of the enclosing block or
+// function; the initializer (default 0) is evaluated before x is in scope. Its value
+// is the initial value.
+static Value* codegenVar(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E) {
+    Value* Init = Constant::getNullValue(getLLVMType(S.getContext(), E.DeclType));
+    if (E.Operands[0] != InvalidRef) {
+        Init = codegenAs(Ctx, S, E.Operands[0], E.DeclType);
+        if (!Init)
+            return nullptr;
+    }
+    std::string_view Name = Ctx.getName(E.A);
+    AllocaInst* Slot = S.createLocal(Init->getType(), Name);
+    S.getBuilder().CreateStore(Init, Slot);
+    S.setNamedValue(Name, Slot);
+    return Init;
+}
+
+// Appends the names E reads or assigns, with repeats.
+static void collectVariables(const ASTContext &Ctx, ExprRef Ref, SmallVectorImpl<Symbol> &Names) {
+    const ExprAST &E = Ctx.getExpr(Ref);
+    switch (E.Kind) {
+        case ExprKind::Number:
+            break;
+        case ExprKind::Variable:
+            Names.push_back(E.A);
+            break;
+        case ExprKind::Binary:
+        case ExprKind::While:
+            collectVariables(Ctx, E.A, Names);
+            collectVariables(Ctx, E.Operands[0], Names);
+            break;
+        case ExprKind::If:
+            collectVariables(Ctx, E.A, Names);
+            collectVariables(Ctx, E.Operands[0], Names);
+            if (E.Operands[1] != InvalidRef)
+                collectVariables(Ctx, E.Operands[1], Names);
+            break;
+        case ExprKind::Var:
+            if (E.Operands[0] != InvalidRef)
+                collectVariables(Ctx, E.Operands[0], Names);
+            break;
+        case ExprKind::For:
+            for (ExprRef Item : Ctx.getList(E.Operands[0], E.Operands[1])) {
+                if (Item != InvalidRef)
+                    collectVariables(Ctx, Item, Names);
+            }
+            break;
+        case ExprKind::Call:
+        case ExprKind::Block:
+            for (ExprRef Item : Ctx.getList(E.Operands[0], E.Operands[1]))
+                collectVariables(Ctx, Item, Names);
+            break;
+        case ExprKind::ParallelFor: {
+            ArrayRef<uint32_t> Parts = Ctx.getList(E.Operands[0], E.Operands[1]);
+            for (size_t I = 0; I < 4; ++I) {
+                if (Parts[I] != InvalidRef)
+                    collectVariables(Ctx, Parts[I], Names);
+            }
+            if (Parts[4] != InvalidRef)
+                Names.push_back(Parts[4]);
+            break;
+        }
+    }
+}
+
+// Integer sums and products wrap around, like the runtime's combination of partials.
+static Value* combineReduction(IRBuilder<> &Builder, char Op, Value* L, Value* R) {
+    if (!L->getType()->isFloatingPointTy()) {
+        switch (Op) {
+            case ReduceAdd: return Builder.CreateAdd(L, R, "redadd");
+            case ReduceMul: return Builder.CreateMul(L, R, "redmul");
+            case ReduceMin: return Builder.CreateBinaryIntrinsic(Intrinsic::smin, L, R, nullptr, "redmin");
+            default: return Builder.CreateBinaryIntrinsic(Intrinsic::smax, L, R, nullptr, "redmax");
+        }
+    }
+    switch (Op) {
+        case ReduceAdd: return Builder.CreateFAdd(L, R, "redadd");
+        case ReduceMul: return Builder.CreateFMul(L, R, "redmul");
+        case ReduceMin: return Builder.CreateMinNum(L, R, "redmin");
+        default: return Builder.CreateMaxNum(L, R, "redmax");
+    }
+}
+
+static Constant* getReductionIdentity(Type* Ty, char Op) {
+    if (auto* IntTy = dyn_cast<IntegerType>(Ty)) {
+        unsigned Bits = IntTy->getBitWidth();
+        switch (Op) {
+            case ReduceAdd: return ConstantInt::get(Ty, 0);
+            case ReduceMul: return ConstantInt::get(Ty, 1);
+            case ReduceMin: return ConstantInt::get(Ty, APInt::getSignedMaxValue(Bits));
+            default: return ConstantInt::get(Ty, APInt::getSignedMinValue(Bits));
+        }
+    }
+    switch (Op) {
+        case ReduceAdd: return ConstantFP::get(Ty, 0.0);
+        case ReduceMul: return ConstantFP::get(Ty, 1.0);
+        case ReduceMin: return ConstantFP::getInfinity(Ty);
+        default: return ConstantFP::getInfinity(Ty, /*Negative=*/true);
+    }
+}
+
+// Name of the runtime entry point that reduces in T.
+static StringRef getReduceEntryPoint(ValueType T) {
+    switch (T) {
+        case ValueType::F32: return "nexon_rt_parallel_reduce_f32";
+        case ValueType::I32: return "nexon_rt_parallel_reduce_i32";
+        case ValueType::F64: return "nexon_rt_parallel_reduce_f64";
+        default: return "nexon_rt_parallel_reduce_i64";
+    }
+}
+
+// parallel for i = start, end [, grain] [reduce(op: acc)] body
+//
+// The body is outlined into an internal function that runs the indices of one chunk,
+// void(ctx, begin, end), or, with a reduction, T(ctx, begin, end) returning the
+// chunk's partial in the accumulator's type T (i64 for a bool accumulator). The variables the body uses are copied into a struct on the
+// caller's stack whose address is ctx; each chunk works on its own copies, so
+// assignments to them are not seen outside the chunk. The loop itself is a call to
+// nexon_rt_parallel_for or the nexon_rt_parallel_reduce entry point for T, which run the chunks on the
+// ThreadPool. Without a reduction the expression is 0; with one it is the combined
+// value, which is also stored to acc.
+static Value* codegenParallelFor(const ASTContext &Ctx, CompilationSession &S, const ExprAST &E) {
+    ArrayRef<uint32_t> Parts = Ctx.getList(E.Operands[0], E.Operands[1]);
+    ExprRef StartExpr = Parts[0], EndExpr = Parts[1], GrainExpr = Parts[2], BodyExpr = Parts[3];
+    Symbol Accumulator = Parts[4];
+    std::string_view VarName = Ctx.getName(E.A);
+    bool Reduce = Accumulator != InvalidRef;
+    IRBuilder<> &Builder = S.getBuilder();
+    LLVMContext &C = S.getContext();
+    // E.Type is the accumulator's type.
+    ValueType ReduceType = E.Type == ValueType::Bool ? ValueType::I64 : E.Type;
+    Type* ReduceTy = getLLVMType(C, ReduceType);
+    Type* Int64Ty = Type::getInt64Ty(C);
+    Type* BytePtrTy = Type::getInt8PtrTy(C);
+
+    Value* Start = codegenAs(Ctx, S, StartExpr, ValueType::I64);
+    Value* End = Start ? codegenAs(Ctx, S, EndExpr, ValueType::I64) : nullptr;
+    if (!End)
+        return nullptr;
+    Value* Grain = ConstantInt::get(Int64Ty, 0);
+    if (GrainExpr != InvalidRef) {
+        Grain = codegenAs(Ctx, S, GrainExpr, ValueType::I64);
+        if (!Grain)
+            return nullptr;
+    }
+    AllocaInst* AccumulatorSlot = nullptr;
+    if (Reduce) {
+        AccumulatorSlot = S.getNamedValue(Ctx.getName(Accumulator));
+        if (!AccumulatorSlot) {
+            std::cerr << "Error: Unknown reduction variable " << Ctx.getName(Accumulator) << "\n";
+            return nullptr;
+        }
+    }
+
+    // Variables of the enclosing function that the body reads.
+    SmallVector<Symbol, 16> Names;
+    collectVariables(Ctx, BodyExpr, Names);
+    llvm::sort(Names);
+    Names.erase(std::unique(Names.begin(), Names.end()), Names.end());
+    SmallVector<Symbol, 16> Captures;
+    SmallVector<Type*, 16> CaptureTypes;
+    for (Symbol Name : Names) {
+        if (Name == Accumulator) {
+            std::cerr << "Error: Reduction variable " << Ctx.getName(Name)
+                      << " cannot be used in the parallel loop body.\n";
+            return nullptr;
+        }
+        if (Name == E.A)
+            continue;
+        if (AllocaInst* Slot = S.getNamedValue(Ctx.getName(Name))) {
+            Captures.push_back(Name);
+            CaptureTypes.push_back(Slot->getAllocatedType());
+        }
+    }
+    StructType* ContextTy = StructType::get(C, CaptureTypes);
+
+    Function* Parent = Builder.GetInsertBlock()->getParent();
+    AllocaInst* Context = S.createLocal(ContextTy, "parallel.ctx");
+    for (size_t I = 0; I < Captures.size(); ++I) {
+        std::string_view Name = Ctx.getName(Captures[I]);
+        Value* Val = Builder.CreateLoad(CaptureTypes[I], S.getNamedValue(Name), StringRef(Name));
+        Builder.CreateStore(Val, Builder.CreateStructGEP(ContextTy, Context, I));
+    }
+
+    // The outlined chunk function. The runtime only calls it with begin < end.
+    FunctionType* ChunkTy = FunctionType::get(Reduce ? ReduceTy : Type::getVoidTy(C),
+                                              { BytePtrTy, Int64Ty, Int64Ty }, false);
+    Function* Chunk = Function::Create(ChunkTy, Function::InternalLinkage, Parent->getName() + ".parallel",
+                                       S.getModule());
+    auto ChunkArg = Chunk->arg_begin();
+    Value* ChunkContext = &*ChunkArg++;
+    Value* ChunkBegin = &*ChunkArg++;
+    Value* ChunkEnd = &*ChunkArg;
+    ChunkContext->setName("ctx");
+    ChunkBegin->setName("begin");
+    ChunkEnd->setName("end");
+
+    IRBuilderBase::InsertPoint SavedInsertPoint = Builder.saveIP();
+    CompilationSession::NameScope SavedNames = S.saveNamedValues();
+    BasicBlock* ChunkEntry = BasicBlock::Create(C, "entry", Chunk);
+    BasicBlock* LoopBB = BasicBlock::Create(C, "loop", Chunk);
+    Builder.SetInsertPoint(ChunkEntry);
+    S.clearNamedValues();
+    Value* Captured = Builder.CreateBitCast(ChunkContext, ContextTy->getPointerTo());
+    for (size_t I = 0; I < Captures.size(); ++I) {
+        std::string_view Name = Ctx.getName(Captures[I]);
+        AllocaInst* Slot = S.createLocal(CaptureTypes[I], Name);
+        Builder.CreateStore(Builder.CreateLoad(CaptureTypes[I], Builder.CreateStructGEP(ContextTy, Captured, I)), Slot);
+        S.setNamedValue(Name, Slot);
+    }
+    AllocaInst* VarSlot = S.createLocal(getLLVMType(C, E.DeclType), VarName);
+    S.setNamedValue(VarName, VarSlot);
+    Builder.CreateBr(LoopBB);
+    Builder.SetInsertPoint(LoopBB);
+    PHINode* Index = Builder.CreatePHI(Int64Ty, 2, "index");
+    Index->addIncoming(ChunkBegin, ChunkEntry);
+    PHINode* Partial = nullptr;
+    if (Reduce) {
+        Partial = Builder.CreatePHI(ReduceTy, 2, "partial");
+        Partial->addIncoming(getReductionIdentity(ReduceTy, E.Op), ChunkEntry);
+    }
+    Builder.CreateStore(S.createConversion(Index, E.DeclType), VarSlot);
+    Value* BodyVal = codegenAs(Ctx, S, BodyExpr, Reduce ? ReduceType : Ctx.getExpr(BodyExpr).Type);
+    if (!BodyVal) {
+        Builder.restoreIP(SavedInsertPoint);
+        S.restoreNamedValues(std::move(SavedNames));
+        Chunk->eraseFromParent();
+        return nullptr;
+    }
+    Value* NextPartial = Reduce ? combineReduction(Builder, E.Op, Partial, BodyVal) : nullptr;
+    Value* Next = Builder.CreateNSWAdd(Index, ConstantInt::get(Int64Ty, 1), "next");
+    // The body may have added blocks of its own.
+    BasicBlock* LoopEnd = Builder.GetInsertBlock();
+    Index->addIncoming(Next, LoopEnd);
+    if (Reduce)
+        Partial->addIncoming(NextPartial, LoopEnd);
+    BasicBlock* ExitBB = BasicBlock::Create(C, "exit", Chunk);
+    Builder.CreateCondBr(Builder.CreateICmpSLT(Next, ChunkEnd, "loopcond"), LoopBB, ExitBB);
+    Builder.SetInsertPoint(ExitBB);
+    if (Reduce)
+        Builder.CreateRet(NextPartial);
+    else
+        Builder.CreateRetVoid();
+    verifyFunction(*Chunk);
+    Builder.restoreIP(SavedInsertPoint);
+    S.restoreNamedValues(std::move(SavedNames));
+
+    Value* Args[] = {
+        Builder.CreateBitCast(Chunk, BytePtrTy),
+        Builder.CreateBitCast(Context, BytePtrTy),
+        Start,
+        End,
+        Grain
+    };
+    Module &M = S.getModule();
+    if (!Reduce) {
+        FunctionCallee Run = M.getOrInsertFunction("nexon_rt_parallel_for", Type::getVoidTy(C),
+                                                   BytePtrTy, BytePtrTy, Int64Ty, Int64Ty, Int64Ty);
+        Builder.CreateCall(Run, Args);
+        return Constant::getNullValue(getLLVMType(C, E.Type));
+    }
+    FunctionCallee Run = M.getOrInsertFunction(getReduceEntryPoint(ReduceType), ReduceTy, BytePtrTy, BytePtrTy,
+                                               Int64Ty, Int64Ty, Int64Ty, Type::getInt32Ty(C));
+    SmallVector<Value*, 6> ReduceArgs(std::begin(Args), std::end(Args));
+    ReduceArgs.push_back(ConstantInt::get(Type::getInt32Ty(C), static_cast<unsigned char>(E.Op)));
+    Value* Reduced = Builder.CreateCall(Run, ReduceArgs, "reduced");
+    Type* AccumulatorTy = AccumulatorSlot->getAllocatedType();
+    Value* Initial = Builder.CreateLoad(AccumulatorTy, AccumulatorSlot, StringRef(Ctx.getName(Accumulator)));
+    Value* Result = combineReduction(Builder, E.Op, S.createConversion(Initial, ReduceTy), Reduced);
+    Result = S.createConversion(Result, AccumulatorTy);
+    Builder.CreateStore(Result, AccumulatorSlot);
+    return Result;
+}
+
+Value* ExprAST::codegen(const ASTContext &Ctx, CompilationSession &S) const {
+    switch (Kind) {
+        case ExprKind::Number:
+            return codegenNumber(S, *this);
+        case ExprKind::Variable:
+            return codegenVariable(Ctx, S, *this);
+        case ExprKind::Binary:
+            return codegenBinary(Ctx, S, *this);
+        case ExprKind::Call:
+            return codegenCall(Ctx, S, *this);
+        case ExprKind::Block:
+            return codegenBlock(Ctx, S, *this);
+        case ExprKind::ParallelFor:
+            return codegenParallelFor(Ctx, S, *this);
+        case ExprKind::If:
+            return codegenIf(Ctx, S, *this);
+        case ExprKind::For:
+            return codegenFor(Ctx, S, *this);
+        case ExprKind::While:
+            return codegenWhile(Ctx, S, *this);
+        case ExprKind::Var:
+            return codegenVar(Ctx, S, *this);
+    }
+    return nullptr;
+}
+
+FunctionSignature PrototypeAST::getSignature(const ASTContext &Ctx) const {
+    FunctionSignature Sig;
+    Sig.Name = std::string(Ctx.getName(Name));
+    Sig.Params.reserve(NumParams);
+    for (Symbol Param : Ctx.getList(FirstParam, NumParams))
+        Sig.Params.emplace_back(Ctx.getName(Param));
+    for (uint32_t Type : Ctx.getList(FirstParamType, NumParams))
+        Sig.ParamTypes.push_back(static_cast<ValueType>(Type));
+    Sig.ReturnType = ReturnType;
+    return Sig;
+}
+
+Function* PrototypeAST::codegen(const ASTContext &Ctx, CompilationSession &S) const {
+    return S.declareFunction(getSignature(Ctx));
+}
+
+Function* FunctionAST::codegen(const ASTContext &Ctx, CompilationSession &S) const {
+    const PrototypeAST &P = Ctx.getProto(Proto);
+    S.addPrototype(P.getSignature(Ctx));
+    Function* TheFunction = S.getFunction(Ctx.getName(P.Name));
+    if (!TheFunction)
+        return nullptr;
+    TypeInference::run(Ctx, *this, *S.getFunctionRegistry());
+    BasicBlock* BB = BasicBlock::Create(S.getContext(), "entry", TheFunction);
+    S.getBuilder().SetInsertPoint(BB);
+    S.clearNamedValues();
+    // Parameters are mutable locals like any other.
+    for (auto &Arg : TheFunction->args()) {
+        std::string_view Name(Arg.getName());
+        AllocaInst* Slot = S.createLocal(Arg.getType(), Name);
+        S.getBuilder().CreateStore(&Arg, Slot);
+        S.setNamedValue(Name, Slot);
+    }
+    if (Value* RetVal = codegenAs(Ctx, S, Body, TheFunction->getReturnType())) {
+        S.getBuilder().CreateRet(RetVal);
+        verifyFunction(*TheFunction);
+        return TheFunction;
+    }
+    TheFunction->eraseFromParent();
+    return nullptr;
+}
+
+void additionalASTRoutine() {
+    for (int i = 0; i < 50; ++i) {
+        std::cerr << "AST processing iteration " << i << "\n";
+    }
+}
+}
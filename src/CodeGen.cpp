@@ -1,59 +1,149 @@
-#include "Nexon/CodeGen.h"
-#include <iostream>
-#include <chrono>
-
-using namespace llvm;
-using namespace Nexon;
-
-std::unique_ptr<LLVMContext> CodeGen::GlobalContext = std::make_unique<LLVMContext>();
-std::unique_ptr<Module> CodeGen::ModuleInstance = std::make_unique<Module>("Nexon Module", *GlobalContext);
-std::unique_ptr<IRBuilder<>> CodeGen::IRBuilderInstance = std::make_unique<IRBuilder<>>(*GlobalContext);
-std::map<std::string, llvm::Value*> CodeGen::NamedValues;
-
-LLVMContext &CodeGen::getGlobalContext() {
-    return *GlobalContext;
-}
-
-IRBuilder<>* CodeGen::Builder() {
-    return IRBuilderInstance.get();
-}
-
-Module* CodeGen::TheModule() {
-    return ModuleInstance.get();
-}
-
-llvm::Value* CodeGen::getNamedValue(const std::string &Name) {
-    return NamedValues[Name];
-}
-
-void CodeGen::setNamedValue(const std::string &Name, llvm::Value* V) {
-    NamedValues[Name] = V;
-}
-
-void CodeGen::clearNamedValues() {
-    NamedValues.clear();
-}
-
-void dumpModule() {
-    ModuleInstance->print(llvm::errs(), nullptr);
-}
-
-void printGlobalVariables() {
-    for (auto &GV : ModuleInstance->globals()) {
-        llvm::errs() << "Global Variable: " << GV.getName() << "\n";
-    }
-}
-
-void performDummyWork() {
-    volatile int counter = 0;
-    for (int i = 0; i < 500; ++i) {
-        counter += i;
-    }
-    std::cout << "Dummy work done, counter: " << counter << "\n";
-}
-
-void extraCodeGenRoutine() {
-    for (int i = 0; i < 50; ++i) {
-        std::cout << "Extra CodeGen iteration " << i << std::endl;
-    }
-}
+#include "Nexon/CodeGen.h"
+#include "llvm/IR/Intrinsics.h"
+#include <iostream>
+#include <chrono>
+
+using namespace llvm;
+using namespace Nexon;
+
+void FunctionRegistry::add(FunctionSignature Sig) {
+    std::string Name = Sig.Name;
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Functions[Name] = std::move(Sig);
+}
+
+std::optional<FunctionSignature> FunctionRegistry::find(std::string_view Name) const {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    auto It = Functions.find(Name);
+    if (It == Functions.end())
+        return std::nullopt;
+    return It->second;
+}
+
+CompilationSession::CompilationSession(std::shared_ptr<FunctionRegistry> Functions)
+    : Functions(Functions ? std::move(Functions) : std::make_shared<FunctionRegistry>()) {
+    initializeModule();
+}
+
+llvm::AllocaInst* CompilationSession::getNamedValue(std::string_view Name) const {
+    auto It = NamedValues.find(Name);
+    return It == NamedValues.end() ? nullptr : It->second;
+}
+
+void CompilationSession::setNamedValue(std::string_view Name, llvm::AllocaInst* V) {
+    auto It = NamedValues.find(Name);
+    if (It != NamedValues.end())
+        It->second = V;
+    else
+        NamedValues.emplace(std::string(Name), V);
+}
+
+AllocaInst* CompilationSession::createLocal(Type* Ty, std::string_view Name) {
+    Function* F = Builder->GetInsertBlock()->getParent();
+    IRBuilder<> EntryBuilder(&F->getEntryBlock(), F->getEntryBlock().begin());
+    return EntryBuilder.CreateAlloca(Ty, nullptr, StringRef(Name));
+}
+
+Value* CompilationSession::createConversion(Value* V, Type* To) {
+    Type* From = V->getType();
+    if (From == To)
+        return V;
+    IRBuilder<> &B = *Builder;
+    if (To->isIntegerTy(1)) {
+        if (From->isFloatingPointTy())
+            return B.CreateFCmpONE(V, ConstantFP::get(From, 0.0), "tobool");
+        return B.CreateICmpNE(V, ConstantInt::get(From, 0), "tobool");
+    }
+    if (From->isIntegerTy(1))
+        return To->isFloatingPointTy() ? B.CreateUIToFP(V, To, "conv") : B.CreateZExt(V, To, "conv");
+    if (From->isIntegerTy())
+        return To->isIntegerTy() ? B.CreateSExtOrTrunc(V, To, "conv") : B.CreateSIToFP(V, To, "conv");
+    // fptosi would give poison for NaN and out-of-range values, such as the infinity of
+    // an integer division by zero; the saturating form defines them.
+    if (To->isIntegerTy())
+        return B.CreateIntrinsic(Intrinsic::fptosi_sat, { To, From }, { V }, nullptr, "conv");
+    return B.CreateFPCast(V, To, "conv");
+}
+
+Function* CompilationSession::getFunction(std::string_view Name) {
+    if (Function* F = TheModule->getFunction(StringRef(Name)))
+        return F;
+    if (auto Sig = Functions->find(Name))
+        return declareFunction(*Sig);
+    return nullptr;
+}
+
+Function* CompilationSession::declareFunction(const FunctionSignature &Sig) {
+    std::vector<Type*> ParamTypes;
+    for (size_t I = 0; I < Sig.Params.size(); ++I)
+        ParamTypes.push_back(getLLVMType(*Context, I < Sig.ParamTypes.size() ? Sig.ParamTypes[I] : ValueType::F64));
+    FunctionType* FT = FunctionType::get(getLLVMType(*Context, Sig.ReturnType), ParamTypes, false);
+    Function* F = Function::Create(FT, Function::ExternalLinkage, Sig.Name, *TheModule);
+    unsigned Idx = 0;
+    for (auto &Arg : F->args())
+        Arg.setName(Sig.Params[Idx++]);
+    return F;
+}
+
+void CompilationSession::initializeModule() {
+    NamedValues.clear();
+    // The builder and module refer to the context, so they go first.
+    Builder.reset();
+    TheModule.reset();
+    Context = std::make_unique<LLVMContext>();
+    TheModule = std::make_unique<Module>("Nexon Module", *Context);
+    Builder = std::make_unique<IRBuilder<>>(*Context);
+}
+
+orc::ThreadSafeModule CompilationSession::takeModule() {
+    orc::ThreadSafeModule TSM(std::move(TheModule), std::move(Context));
+    initializeModule();
+    return TSM;
+}
+
+Function* CompilationSession::emitMain(const std::vector<std::string> &TopLevelExprs) {
+    LLVMContext &Ctx = *Context;
+    Module* M = TheModule.get();
+    FunctionCallee Printf = M->getOrInsertFunction(
+        "printf", FunctionType::get(Type::getInt32Ty(Ctx), { Type::getInt8PtrTy(Ctx) }, true));
+    Function* Main = Function::Create(FunctionType::get(Type::getInt32Ty(Ctx), false),
+                                      Function::ExternalLinkage, "main", M);
+    Builder->SetInsertPoint(BasicBlock::Create(Ctx, "entry", Main));
+    Value* Format = Builder->CreateGlobalStringPtr("Evaluated to %g\n", "fmt");
+    for (const auto &Name : TopLevelExprs) {
+        Function* Expr = getFunction(Name);
+        if (!Expr) {
+            std::cerr << "Error: Function " << Name << " not found.\n";
+            Main->eraseFromParent();
+            return nullptr;
+        }
+        Value* Result = Builder->CreateCall(Expr, {}, "result");
+        Builder->CreateCall(Printf, { Format, Result });
+    }
+    Builder->CreateRet(ConstantInt::get(Type::getInt32Ty(Ctx), 0));
+    return Main;
+}
+
+void dumpModule(CompilationSession &Session) {
+    Session.getModule().print(llvm::errs(), nullptr);
+}
+
+void printGlobalVariables(CompilationSession &Session) {
+    for (auto &GV : Session.getModule().globals()) {
+        llvm::errs() << "Global Variable: " << GV.getName() << "\n";
+    }
+}
+
+void performDummyWork() {
+    volatile int counter = 0;
+    for (int i = 0; i < 500; ++i) {
+        counter += i;
+    }
+    std::cout << "Dummy work done, counter: " << counter << "\n";
+}
+
+void extraCodeGenRoutine() {
+    for (int i = 0; i < 50; ++i) {
+        std::cout << "Extra CodeGen iteration " << i << std::endl;
+    }
+}
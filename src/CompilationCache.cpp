@@ -0,0 +1,185 @@
+#include "Nexon/CompilationCache.h"
+#include "Nexon/Optimizer.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/Config/llvm-config.h"
+#include "llvm/Support/Chrono.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/FileUtilities.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Process.h"
+#include "llvm/Support/SHA1.h"
+#include <cstdlib>
+#include <iostream>
+
+namespace Nexon {
+using namespace llvm;
+
+// Bump when the entry layout or the meaning of a key changes.
+static const char EntryMagic[] = "NEXONCACHE1\n";
+static constexpr uint64_t DefaultMaxSizeBytes = 512ull << 20;
+
+// Tells builds of the same version apart: the commit the compiler was configured from,
+// and the size and modification time of the running executable, so that rebuilding
+// nexon retires the entries of the previous build even without a new commit.
+static const std::string &getBuildId() {
+    static const std::string Id = [] {
+        std::string Result = NEXON_BUILD_ID;
+        std::string Executable = sys::fs::getMainExecutable(nullptr, nullptr);
+        sys::fs::file_status Status;
+        if (!Executable.empty() && !sys::fs::status(Executable, Status))
+            Result += ":" + std::to_string(Status.getSize()) + ":" +
+                      std::to_string(Status.getLastModificationTime().time_since_epoch().count());
+        return Result;
+    }();
+    return Id;
+}
+
+std::unique_ptr<CompilationCache> CompilationCache::open() {
+    SmallString<256> Directory;
+    if (const char* Env = std::getenv("NEXON_CACHE_DIR")) {
+        Directory = Env;
+    } else {
+        if (!sys::path::cache_directory(Directory))
+            return nullptr;
+        sys::path::append(Directory, "nexon");
+    }
+    if (auto EC = sys::fs::create_directories(Directory)) {
+        std::cerr << "Warning: Compilation cache disabled, unable to create " << Directory.str().str()
+                  << ": " << EC.message() << "\n";
+        return nullptr;
+    }
+
+    CachePruningPolicy Policy;
+    Policy.MaxSizeBytes = DefaultMaxSizeBytes;
+    if (const char* Size = std::getenv("NEXON_CACHE_SIZE")) {
+        StringRef Value(Size);
+        std::string Spec = (Value.endswith("%") ? "cache_size=" : "cache_size_bytes=") + Value.str();
+        auto Parsed = parseCachePruningPolicy(Spec);
+        if (!Parsed) {
+            std::cerr << "Warning: Ignoring invalid NEXON_CACHE_SIZE '" << Size
+                      << "': " << toString(Parsed.takeError()) << "\n";
+        } else {
+            Policy.MaxSizeBytes = Parsed->MaxSizeBytes;
+            Policy.MaxSizePercentageOfAvailableSpace = Parsed->MaxSizePercentageOfAvailableSpace;
+        }
+    }
+    // Entries only leave the cache when it is full, least recently used first. The scan
+    // runs after every store; lookups never pay for it.
+    Policy.Interval = std::chrono::seconds(0);
+    Policy.Expiration = std::chrono::seconds(0);
+    return std::unique_ptr<CompilationCache>(new CompilationCache(Directory.str().str(), Policy));
+}
+
+std::string CompilationCache::computeKey(StringRef Kind, ArrayRef<StringRef> Fields) {
+    SHA1 Hasher;
+    // Each field is length-prefixed so that no two field lists hash alike.
+    auto AddField = [&](StringRef Field) {
+        Hasher.update(std::to_string(Field.size()) + ":");
+        Hasher.update(Field);
+    };
+    AddField(EntryMagic);
+    AddField(NEXON_VERSION);
+    AddField(getBuildId());
+    AddField(LLVM_VERSION_STRING);
+    AddField(Kind);
+    for (StringRef Field : Fields)
+        AddField(Field);
+    return toHex(Hasher.final(), /*LowerCase=*/true);
+}
+
+std::string CompilationCache::computeKey(StringRef Source, StringRef Kind, const TargetMachine &TM) {
+    std::string Triple = TM.getTargetTriple().str();
+    std::string Level = std::to_string(static_cast<int>(Optimizer::getOptimizationLevel()));
+    return computeKey(Kind, { Triple, TM.getTargetCPU(), TM.getTargetFeatureString(), Level,
+                              Optimizer::getCustomPasses(), Source });
+}
+
+std::string CompilationCache::getEntryPath(const std::string &Key) const {
+    // The "llvmcache-" prefix lets llvm::pruneCache manage the entry.
+    SmallString<256> Path(Directory);
+    sys::path::append(Path, "llvmcache-nexon-" + Key);
+    return Path.str().str();
+}
+
+// Splits the next '\n'-terminated line off Data. Returns false if there is none.
+static bool consumeLine(StringRef &Data, StringRef &Line) {
+    size_t End = Data.find('\n');
+    if (End == StringRef::npos)
+        return false;
+    Line = Data.substr(0, End);
+    Data = Data.substr(End + 1);
+    return true;
+}
+
+static bool consumeCount(StringRef &Data, uint64_t &Count) {
+    StringRef Line;
+    return consumeLine(Data, Line) && to_integer(Line, Count, 10);
+}
+
+bool CompilationCache::lookup(const std::string &Key, Entry &E) {
+    std::string Path = getEntryPath(Key);
+    int FD;
+    if (sys::fs::openFileForRead(Path, FD))
+        return false;
+    auto Buffer = MemoryBuffer::getOpenFile(sys::fs::convertFDToNativeFile(FD), Path, -1,
+                                            /*RequiresNullTerminator=*/false);
+    // Entries are evicted by access time, which many mounts do not maintain on reads.
+    auto Now = std::chrono::system_clock::now();
+    sys::fs::setLastAccessAndModificationTime(FD, Now, Now);
+    sys::Process::SafelyCloseFileDescriptor(FD);
+    if (!Buffer)
+        return false;
+
+    StringRef Data = (*Buffer)->getBuffer();
+    uint64_t NumExprs = 0, NumObjects = 0;
+    Entry Result;
+    bool Valid = Data.consume_front(EntryMagic) && consumeCount(Data, NumExprs);
+    for (uint64_t I = 0; Valid && I < NumExprs; ++I) {
+        StringRef Name;
+        Valid = consumeLine(Data, Name);
+        Result.TopLevelExprs.push_back(Name.str());
+    }
+    Valid = Valid && consumeCount(Data, NumObjects);
+    for (uint64_t I = 0; Valid && I < NumObjects; ++I) {
+        uint64_t Size = 0;
+        Valid = consumeCount(Data, Size) && Size <= Data.size();
+        if (Valid) {
+            // Copies are suitably aligned for the object loaders and outlive the mapping.
+            Result.Objects.push_back(MemoryBuffer::getMemBufferCopy(Data.substr(0, Size), Path));
+            Data = Data.substr(Size);
+        }
+    }
+    if (!Valid || !Data.empty()) {
+        std::cerr << "Warning: Discarding corrupt compilation cache entry " << Path << "\n";
+        sys::fs::remove(Path);
+        return false;
+    }
+    E = std::move(Result);
+    return true;
+}
+
+void CompilationCache::store(const std::string &Key, const std::vector<std::string> &TopLevelExprs,
+                             ArrayRef<std::unique_ptr<MemoryBuffer>> Objects) {
+    std::string Data = EntryMagic;
+    Data += std::to_string(TopLevelExprs.size()) + "\n";
+    for (const auto &Name : TopLevelExprs)
+        Data += Name + "\n";
+    Data += std::to_string(Objects.size()) + "\n";
+    for (const auto &Object : Objects) {
+        Data += std::to_string(Object->getBufferSize()) + "\n";
+        Data += Object->getBuffer().str();
+    }
+
+    // Writing to a temporary and renaming keeps concurrent readers from ever seeing a
+    // partial entry; concurrent writers of one key produce identical contents.
+    SmallString<256> TempModel(Directory);
+    sys::path::append(TempModel, "nexon-tmp-%%%%%%%%");
+    if (auto Err = writeFileAtomically(TempModel, getEntryPath(Key), Data)) {
+        std::cerr << "Warning: Unable to write compilation cache entry: " << toString(std::move(Err)) << "\n";
+        return;
+    }
+    pruneCache(Directory, Policy);
+}
+
+}
@@ -1,49 +1,68 @@
-#include "Nexon/Concurrency.h"
-#include <thread>
-#include <vector>
-#include <functional>
-#include <iostream>
-#include <chrono>
-
-namespace Nexon {
-
-void Concurrency::parallelFor(size_t start, size_t end, const std::function<void(size_t)> &func) {
-    unsigned numThreads = std::thread::hardware_concurrency();
-    if(numThreads == 0) numThreads = 4;
-    size_t total = end - start;
-    size_t chunk = (total + numThreads - 1) / numThreads;
-    std::vector<std::thread> threads;
-    for (unsigned t = 0; t < numThreads; ++t) {
-        size_t chunkStart = start + t * chunk;
-        size_t chunkEnd = std::min(chunkStart + chunk, end);
-        threads.emplace_back([=]() {
-            for (size_t i = chunkStart; i < chunkEnd; ++i)
-                func(i);
-        });
-    }
-    for (auto &th : threads)
-        th.join();
-}
-
-void benchmarkParallelFor() {
-    auto startTime = std::chrono::high_resolution_clock::now();
-    parallelFor(0, 1000000, [](size_t i) {
-        volatile double x = i * 0.001;
-    });
-    auto endTime = std::chrono::high_resolution_clock::now();
-    std::chrono::duration<double> elapsed = endTime - startTime;
-    std::cout << "Parallel for benchmark: " << elapsed.count() << " seconds." << std::endl;
-}
-
-void extraConcurrencyRoutine() {
-    for (size_t i = 0; i < 100; ++i) {
-        std::cout << "Extra concurrency routine iteration " << i << std::endl;
-    }
-}
-
-void additionalConcurrencyBenchmark() {
-    for (size_t i = 0; i < 50; ++i) {
-        std::cout << "Additional concurrency work " << i << std::endl;
-    }
-}
-}
+#include "Nexon/Concurrency.h"
+#include "Nexon/ThreadPool.h"
+#include <algorithm>
+#include <thread>
+#include <vector>
+#include <functional>
+#include <iostream>
+#include <chrono>
+
+namespace Nexon {
+
+thread_local const std::atomic<bool>* CancellationScope::Current = nullptr;
+
+size_t Concurrency::getDefaultGrain(size_t count) {
+    return std::max<size_t>(1, count / (8 * ThreadPool::get().getConcurrency()));
+}
+
+void benchmarkParallelFor() {
+    const size_t count = size_t(1) << 22;
+    const double a = 2.5;
+    // Distributed like BigArray::distributed, so that every node streams from its own memory.
+    auto xStorage = Concurrency::allocateDistributed<double>(count);
+    auto yStorage = Concurrency::allocateDistributed<double>(count);
+    double* x = xStorage.get();
+    double* y = yStorage.get();
+    Concurrency::parallelFor(0, count, [&](size_t begin, size_t end) {
+        std::fill(x + begin, x + end, 1.0);
+        std::fill(y + begin, y + end, 2.0);
+    });
+    auto time = [&](const char* label, auto &&run) {
+        run();  // Warm up the pool and the pages.
+        auto startTime = std::chrono::high_resolution_clock::now();
+        for (int rep = 0; rep < 10; ++rep)
+            run();
+        auto endTime = std::chrono::high_resolution_clock::now();
+        std::chrono::duration<double> elapsed = endTime - startTime;
+        std::cout << "  " << label << ": " << elapsed.count() / 10 * 1e3 << " ms" << std::endl;
+    };
+    std::cout << "Parallel for benchmark (y = a*x + y, " << count << " doubles, "
+              << ThreadPool::get().getConcurrency() << " threads, " << ThreadPool::get().getNumNodes()
+              << " NUMA nodes):" << std::endl;
+    std::function<void(size_t)> perIndex = [&](size_t i) { y[i] = a * x[i] + y[i]; };
+    time("std::function per index", [&] { Concurrency::parallelFor(0, count, perIndex); });
+    time("template per index     ", [&] {
+        Concurrency::parallelFor(0, count, [&](size_t i) { y[i] = a * x[i] + y[i]; });
+    });
+    time("template per range     ", [&] {
+        Concurrency::parallelFor(0, count, [&](size_t begin, size_t end) {
+            double* __restrict py = y;
+            const double* __restrict px = x;
+            for (size_t i = begin; i < end; ++i)
+                py[i] = a * px[i] + py[i];
+        });
+    });
+}
+
+void extraConcurrencyRoutine() {
+    for (size_t i = 0; i < 100; ++i) {
+        std::cout << "Extra concurrency routine iteration " << i << std::endl;
+    }
+}
+
+void additionalConcurrencyBenchmark() {
+    for (size_t i = 0; i < 50; ++i) {
+        std::cout << "Additional concurrency work " << i << std::endl;
+    }
+}
+}
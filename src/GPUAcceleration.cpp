@@ -1,49 +1,49 @@
-#include "Nexon/GPUAcceleration.h"
-#include <iostream>
-#ifdef HAVE_CUDA
-#include <cuda_runtime.h>
-__global__ void sampleKernel(int *data, int size) {
-    int idx = blockIdx.x * blockDim.x + threadIdx.x;
-    if (idx < size) {
-        data[idx] = data[idx] * 2;
-    }
-}
-#endif
-
-namespace Nexon {
-
-void GPUAcceleration::runSampleKernel() {
-#ifdef HAVE_CUDA
-    const int size = 1024;
-    int *data;
-    cudaMalloc(&data, size * sizeof(int));
-    cudaMemset(data, 1, size * sizeof(int));
-    int threadsPerBlock = 256;
-    int blocks = (size + threadsPerBlock - 1) / threadsPerBlock;
-    sampleKernel<<<blocks, threadsPerBlock>>>(data, size);
-    cudaDeviceSynchronize();
-    cudaFree(data);
-    std::cout << "GPU kernel executed successfully." << std::endl;
-#else
-    std::cout << "CUDA not available. Executing CPU fallback." << std::endl;
-    const int size = 1024;
-    int data[size];
-    for (int i = 0; i < size; ++i) { data[i] = 1; }
-    for (int i = 0; i < size; ++i) { data[i] = data[i] * 2; }
-    std::cout << "CPU fallback executed." << std::endl;
-#endif
-}
-
-void simulateDataTransfer() {
-    std::cout << "Simulating data transfer between CPU and GPU..." << std::endl;
-    for (int i = 0; i < 50; ++i) {
-        std::cout << "Transferring chunk " << i << std::endl;
-    }
-}
-
-void extraGPUFunction() {
-    for (int i = 0; i < 50; ++i) {
-        std::cout << "Extra GPU processing iteration " << i << std::endl;
-    }
-}
-}
+#include "Nexon/GPUAcceleration.h"
+#include <iostream>
+#ifdef HAVE_CUDA
+#include <cuda_runtime.h>
+__global__ void sampleKernel(int *data, int size) {
+    int idx = blockIdx.x * blockDim.x + threadIdx.x;
+    if (idx < size) {
+        data[idx] = data[idx] * 2;
+    }
+}
+#endif
+
+namespace Nexon {
+
+void GPUAcceleration::runSampleKernel() {
+#ifdef HAVE_CUDA
+    const int size = 1024;
+    int *data;
+    cudaMalloc(&data, size * sizeof(int));
+    cudaMemset(data, 1, size * sizeof(int));
+    int threadsPerBlock = 256;
+    int blocks = (size + threadsPerBlock - 1) / threadsPerBlock;
+    sampleKernel<<<blocks, threadsPerBlock>>>(data, size);
+    cudaDeviceSynchronize();
+    cudaFree(data);
+    std::cout << "GPU kernel executed successfully." << std::endl;
+#else
+    std::cout << "CUDA not available. Executing CPU fallback." << std::endl;
+    const int size = 1024;
+    int data[size];
+    for (int i = 0; i < size; ++i) { data[i] = 1; }
+    for (int i = 0; i < size; ++i) { data[i] = data[i] * 2; }
+    std::cout << "CPU fallback executed." << std::endl;
+#endif
+}
+
+void simulateDataTransfer() {
+    std::cout << "Simulating data transfer between CPU and GPU..." << std::endl;
+    for (int i = 0; i < 50; ++i) {
+        std::cout << "Transferring chunk " << i << std::endl;
+    }
+}
+
+void extraGPUFunction() {
+    for (int i = 0; i < 50; ++i) {
+        std::cout << "Extra GPU processing iteration " << i << std::endl;
+    }
+}
+}
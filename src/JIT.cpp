@@ -0,0 +1,162 @@
+#include "Nexon/JIT.h"
+#include "Nexon/AST.h"
+#include "Nexon/CodeGen.h"
+#include "Nexon/ObjectEmitter.h"
+#include "Nexon/Optimizer.h"
+#include "Nexon/RuntimeLibrary.h"
+#include "Nexon/StartupProfile.h"
+#include "llvm/ExecutionEngine/Orc/ExecutionUtils.h"
+#include <cstdlib>
+#include <iostream>
+
+namespace Nexon {
+using namespace llvm;
+
+// Materializes one lazily compiled function from its AST when its stub is first called.
+class FunctionASTMaterializationUnit : public orc::MaterializationUnit {
+public:
+    FunctionASTMaterializationUnit(JIT &J, std::shared_ptr<const ASTContext> Ctx, FuncRef F,
+                                   std::shared_ptr<FunctionRegistry> Functions, orc::SymbolStringPtr Name)
+        : MaterializationUnit(Interface(
+              orc::SymbolFlagsMap{ { Name, JITSymbolFlags::Exported | JITSymbolFlags::Callable } }, nullptr)),
+          J(J), Ctx(std::move(Ctx)), F(F), Functions(std::move(Functions)) { }
+    StringRef getName() const override { return "FunctionASTMaterializationUnit"; }
+    void materialize(std::unique_ptr<orc::MaterializationResponsibility> R) override {
+        orc::ThreadSafeModule TSM = J.lowerFunction(*Ctx, F, Functions);
+        if (!TSM) {
+            std::cerr << "Error: Lazy compilation of function " << Ctx->getFunctionName(F) << " failed.\n";
+            R->failMaterialization();
+            return;
+        }
+        J.LLJ->getIRTransformLayer().emit(std::move(R), std::move(TSM));
+    }
+private:
+    void discard(const orc::JITDylib &, const orc::SymbolStringPtr &) override { }
+    JIT &J;
+    std::shared_ptr<const ASTContext> Ctx;
+    FuncRef F;
+    std::shared_ptr<FunctionRegistry> Functions;
+};
+
+// Called by a call-through stub whose function could not be compiled.
+static void reportLazyCompileFailure() {
+    std::cerr << "Error: Unable to compile a lazily called function.\n";
+    std::exit(EXIT_FAILURE);
+}
+
+std::unique_ptr<JIT> JIT::create() {
+    ObjectEmitter::initializeTargets();
+    StartupProfile::Stage Stage("jit");
+    auto TM = ObjectEmitter::createTargetMachine("", "");
+    if (!TM)
+        return nullptr;
+    auto LLJOrErr = orc::LLJITBuilder().setDataLayout(TM->createDataLayout()).create();
+    if (!LLJOrErr) {
+        std::cerr << "Error: Unable to create JIT: " << toString(LLJOrErr.takeError()) << "\n";
+        return nullptr;
+    }
+    auto LLJ = std::move(*LLJOrErr);
+
+    // Let JIT-compiled code call into the host process (libm, runtime entry points).
+    auto Generator = orc::DynamicLibrarySearchGenerator::GetForCurrentProcess(
+        LLJ->getDataLayout().getGlobalPrefix());
+    if (!Generator) {
+        std::cerr << "Error: Unable to expose host symbols to JIT: " << toString(Generator.takeError()) << "\n";
+        return nullptr;
+    }
+    LLJ->getMainJITDylib().addGenerator(std::move(*Generator));
+    // The runtime library is not exported from the executable, so it is defined
+    // explicitly.
+    orc::SymbolMap RuntimeSymbols;
+    for (const auto &S : RuntimeLibrary::getSymbols())
+        RuntimeSymbols[LLJ->mangleAndIntern(S.Name)] =
+            JITEvaluatedSymbol(pointerToJITTargetAddress(S.Address), JITSymbolFlags::Exported | JITSymbolFlags::Callable);
+    if (auto Err = LLJ->getMainJITDylib().define(orc::absoluteSymbols(std::move(RuntimeSymbols)))) {
+        std::cerr << "Error: Unable to define runtime symbols: " << toString(std::move(Err)) << "\n";
+        return nullptr;
+    }
+    return std::unique_ptr<JIT>(new JIT(std::move(LLJ), std::move(TM)));
+}
+
+bool JIT::addModule(orc::ThreadSafeModule TSM) {
+    if (auto Err = LLJ->addIRModule(std::move(TSM))) {
+        std::cerr << "Error: Unable to add module to JIT: " << toString(std::move(Err)) << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool JIT::addObject(std::unique_ptr<MemoryBuffer> Obj) {
+    if (auto Err = LLJ->addObjectFile(std::move(Obj))) {
+        std::cerr << "Error: Unable to add object to JIT: " << toString(std::move(Err)) << "\n";
+        return false;
+    }
+    return true;
+}
+
+bool JIT::enableLazyCompilation() {
+    auto &ES = LLJ->getExecutionSession();
+    auto LCTMOrErr = orc::createLocalLazyCallThroughManager(
+        getTargetTriple(), ES, pointerToJITTargetAddress(&reportLazyCompileFailure));
+    if (!LCTMOrErr) {
+        std::cerr << "Error: Unable to create lazy call-through manager: " << toString(LCTMOrErr.takeError()) << "\n";
+        return false;
+    }
+    LCTM = std::move(*LCTMOrErr);
+    ISM = orc::createLocalIndirectStubsManagerBuilder(getTargetTriple())();
+
+    // Function bodies live in a separate dylib; the main dylib only holds their stubs.
+    // Bodies link against the main dylib so calls between lazy functions stay lazy.
+    auto ImplJDOrErr = LLJ->createJITDylib("<main>.impl");
+    if (!ImplJDOrErr) {
+        std::cerr << "Error: Unable to create JIT dylib: " << toString(ImplJDOrErr.takeError()) << "\n";
+        return false;
+    }
+    ImplJD = &*ImplJDOrErr;
+    ImplJD->setLinkOrder({ { &LLJ->getMainJITDylib(), orc::JITDylibLookupFlags::MatchExportedSymbolsOnly } },
+                         false);
+    return true;
+}
+
+bool JIT::addLazyFunction(std::shared_ptr<const ASTContext> Ctx, FuncRef F,
+                          std::shared_ptr<FunctionRegistry> Functions) {
+    if (!ImplJD && !enableLazyCompilation())
+        return false;
+    // Other modules need the signature to call F before it is compiled.
+    const PrototypeAST &Proto = Ctx->getProto(Ctx->getFunction(F).Proto);
+    Functions->add(Proto.getSignature(*Ctx));
+    std::string Name(Ctx->getFunctionName(F));
+    auto MangledName = LLJ->mangleAndIntern(Name);
+    orc::SymbolAliasMap Aliases;
+    Aliases[MangledName] = orc::SymbolAliasMapEntry(MangledName, JITSymbolFlags::Exported | JITSymbolFlags::Callable);
+    if (auto Err = ImplJD->define(std::make_unique<FunctionASTMaterializationUnit>(*this, std::move(Ctx), F, std::move(Functions),
+                                                                           MangledName))) {
+        std::cerr << "Error: Unable to define function " << Name << ": " << toString(std::move(Err)) << "\n";
+        return false;
+    }
+    if (auto Err = LLJ->getMainJITDylib().define(orc::lazyReexports(*LCTM, *ISM, *ImplJD, std::move(Aliases)))) {
+        std::cerr << "Error: Unable to create stub for " << Name << ": " << toString(std::move(Err)) << "\n";
+        return false;
+    }
+    return true;
+}
+
+orc::ThreadSafeModule JIT::lowerFunction(const ASTContext &Ctx, FuncRef F,
+                                         std::shared_ptr<FunctionRegistry> Functions) {
+    CompilationSession Session(std::move(Functions));
+    ObjectEmitter::configureModule(Session.getModule(), *TM);
+    if (!Ctx.getFunction(F).codegen(Ctx, Session) || !Optimizer::runOptimizationPasses(Session.getModule(), *TM))
+        return orc::ThreadSafeModule();
+    return Session.takeModule();
+}
+
+void* JIT::lookup(const std::string &Name) {
+    auto Sym = LLJ->lookup(Name);
+    if (!Sym) {
+        std::cerr << "Error: JIT symbol " << Name << " not found: " << toString(Sym.takeError()) << "\n";
+        return nullptr;
+    }
+    return reinterpret_cast<void*>(static_cast<uintptr_t>(Sym->getAddress()));
+}
+
+}
@@ -1,75 +1,380 @@
-#include "Nexon/Lexer.h"
-#include <cstdlib>
-#include <iostream>
-
-namespace Nexon {
-
-char Lexer::getNextChar() {
-    if (Position < Input.size())
-        return Input[Position++];
-    return EOF;
-}
-
-char Lexer::peekChar() const {
-    if (Position < Input.size())
-        return Input[Position];
-    return EOF;
-}
-
-int Lexer::getNextToken() {
-    while (std::isspace(peekChar()))
-        getNextChar();
-    char CurChar = peekChar();
-    if (std::isalpha(CurChar)) {
-        IdentifierStr.clear();
-        while (std::isalnum(peekChar()))
-            IdentifierStr.push_back(getNextChar());
-        if (IdentifierStr == "def")
-            return tok_def;
-        if (IdentifierStr == "extern")
-            return tok_extern;
-        return tok_identifier;
-    }
-    if (std::isdigit(CurChar) || CurChar == '.') {
-        std::string NumStr;
-        while (std::isdigit(peekChar()) || peekChar() == '.')
-            NumStr.push_back(getNextChar());
-        NumVal = std::strtod(NumStr.c_str(), nullptr);
-        return tok_number;
-    }
-    if (CurChar == '#') {
-        while (getNextChar() != '\n' && peekChar() != EOF) { }
-        return getNextToken();
-    }
-    int ThisChar = getNextChar();
-    if (ThisChar == EOF)
-        return tok_eof;
-    return ThisChar;
-}
-
-void debugTokens(const std::string &input) {
-    Lexer lex(input);
-    int token = lex.getNextToken();
-    while (token != tok_eof) {
-        std::cout << "Token: " << token << ", ";
-        if (token == tok_identifier)
-            std::cout << "Identifier: " << lex.getIdentifierStr();
-        else if (token == tok_number)
-            std::cout << "Number: " << lex.getNumVal();
-        std::cout << std::endl;
-        token = lex.getNextToken();
-    }
-}
-
-void extraLexerRoutine() {
-    for (int i = 0; i < 50; ++i) {
-        std::cout << "Extra Lexer routine line " << i << std::endl;
-    }
-}
-
-void additionalLexerWork() {
-    for (int i = 0; i < 20; ++i) {
-        std::cout << "Additional Lexer work " << i << std::endl;
-    }
-}
-}
+#include "Nexon/Lexer.h"
+#include <algorithm>
+#include <array>
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__) && defined(__SSE2__)
+#define NEXON_LEXER_X86_SIMD 1
+#include <immintrin.h>
+#endif
+
+namespace Nexon {
+
+// ---------------------------------------------------------------------------
+// Character classification. ASCII-only and locale-independent, unlike <cctype>.
+// ---------------------------------------------------------------------------
+
+enum CharClass : uint8_t {
+    CC_Space = 1 << 0,
+    CC_Alpha = 1 << 1,
+    CC_Digit = 1 << 2,
+    CC_Dot = 1 << 3
+};
+
+static constexpr std::array<uint8_t, 256> makeCharClassTable() {
+    std::array<uint8_t, 256> Table{};
+    for (unsigned C = 0; C < 256; ++C) {
+        uint8_t Class = 0;
+        if (C == ' ' || (C >= '\t' && C <= '\r'))
+            Class |= CC_Space;
+        if ((C >= 'a' && C <= 'z') || (C >= 'A' && C <= 'Z'))
+            Class |= CC_Alpha;
+        if (C >= '0' && C <= '9')
+            Class |= CC_Digit;
+        if (C == '.')
+            Class |= CC_Dot;
+        Table[C] = Class;
+    }
+    return Table;
+}
+
+static constexpr std::array<uint8_t, 256> CharClassTable = makeCharClassTable();
+
+static inline uint8_t charClass(char C) {
+    return CharClassTable[static_cast<unsigned char>(C)];
+}
+
+// ---------------------------------------------------------------------------
+// Keywords, matched through a perfect hash over (length, first, last char).
+// The table is built and checked for collisions at compile time.
+// ---------------------------------------------------------------------------
+
+struct KeywordEntry {
+    std::string_view Text;
+    int Tok;
+};
+
+static constexpr KeywordEntry Keywords[] = {
+    { "def", tok_def },
+    { "extern", tok_extern },
+    { "parallel", tok_parallel },
+    { "for", tok_for },
+    { "if", tok_if },
+    { "else", tok_else },
+    { "while", tok_while },
+    { "var", tok_var }
+};
+
+static constexpr size_t KeywordTableSize = 64;
+
+static constexpr size_t keywordHash(std::string_view S) {
+    return (S.size() * 7 + static_cast<unsigned char>(S.front()) +
+            static_cast<unsigned char>(S.back()) * 3) & (KeywordTableSize - 1);
+}
+
+static constexpr std::array<KeywordEntry, KeywordTableSize> makeKeywordTable() {
+    std::array<KeywordEntry, KeywordTableSize> Table{};
+    for (const auto &K : Keywords)
+        Table[keywordHash(K.Text)] = K;
+    return Table;
+}
+
+static constexpr std::array<KeywordEntry, KeywordTableSize> KeywordTable = makeKeywordTable();
+
+static constexpr bool keywordHashIsPerfect() {
+    for (const auto &K : Keywords)
+        if (KeywordTable[keywordHash(K.Text)].Text != K.Text)
+            return false;
+    return true;
+}
+static_assert(keywordHashIsPerfect(), "keyword hash collision: adjust keywordHash or KeywordTableSize");
+
+static inline int lookupKeyword(std::string_view Ident) {
+    const KeywordEntry &Entry = KeywordTable[keywordHash(Ident)];
+    return Entry.Text == Ident ? Entry.Tok : tok_identifier;
+}
+
+// ---------------------------------------------------------------------------
+// Scanning kernels. Each returns the first position at or after P that does not
+// belong to the run being scanned. The SIMD versions classify 16 or 32 bytes at
+// a time and finish the tail with the table-driven scalar loop.
+// ---------------------------------------------------------------------------
+
+static const char* identEndScalar(const char* P, const char* End) {
+    while (P != End && (charClass(*P) & (CC_Alpha | CC_Digit)))
+        ++P;
+    return P;
+}
+
+static const char* numberEndScalar(const char* P, const char* End) {
+    while (P != End && (charClass(*P) & (CC_Digit | CC_Dot)))
+        ++P;
+    return P;
+}
+
+// Skips whitespace, counting newlines into Line and tracking where the current line starts.
+static const char* spaceEndScalar(const char* P, const char* End, unsigned &Line, const char* &LineBegin) {
+    while (P != End && (charClass(*P) & CC_Space)) {
+        if (*P == '\n') {
+            ++Line;
+            LineBegin = P + 1;
+        }
+        ++P;
+    }
+    return P;
+}
+
+#ifdef NEXON_LEXER_X86_SIMD
+
+// Byte-wise unsigned range test Lo <= C < Lo + Len, done with signed compares by
+// biasing the range to start at -128.
+#define NEXON_IN_RANGE_128(C, Lo, Len) \
+    _mm_cmplt_epi8(_mm_add_epi8((C), _mm_set1_epi8(static_cast<char>(0x80 - (Lo)))), \
+                   _mm_set1_epi8(static_cast<char>(-128 + (Len))))
+#define NEXON_IN_RANGE_256(C, Lo, Len) \
+    _mm256_cmpgt_epi8(_mm256_set1_epi8(static_cast<char>(-128 + (Len))), \
+                      _mm256_add_epi8((C), _mm256_set1_epi8(static_cast<char>(0x80 - (Lo)))))
+
+static inline __m128i identMask128(__m128i C) {
+    __m128i Lower = _mm_or_si128(C, _mm_set1_epi8(0x20));
+    return _mm_or_si128(NEXON_IN_RANGE_128(Lower, 'a', 26), NEXON_IN_RANGE_128(C, '0', 10));
+}
+
+static inline __m128i numberMask128(__m128i C) {
+    return _mm_or_si128(NEXON_IN_RANGE_128(C, '0', 10), _mm_cmpeq_epi8(C, _mm_set1_epi8('.')));
+}
+
+static inline __m128i spaceMask128(__m128i C) {
+    return _mm_or_si128(_mm_cmpeq_epi8(C, _mm_set1_epi8(' ')), NEXON_IN_RANGE_128(C, '\t', 5));
+}
+
+static const char* identEndSSE2(const char* P, const char* End) {
+    for (; End - P >= 16; P += 16) {
+        __m128i C = _mm_loadu_si128(reinterpret_cast<const __m128i*>(P));
+        unsigned Stop = ~static_cast<unsigned>(_mm_movemask_epi8(identMask128(C))) & 0xFFFFu;
+        if (Stop)
+            return P + __builtin_ctz(Stop);
+    }
+    return identEndScalar(P, End);
+}
+
+static const char* numberEndSSE2(const char* P, const char* End) {
+    for (; End - P >= 16; P += 16) {
+        __m128i C = _mm_loadu_si128(reinterpret_cast<const __m128i*>(P));
+        unsigned Stop = ~static_cast<unsigned>(_mm_movemask_epi8(numberMask128(C))) & 0xFFFFu;
+        if (Stop)
+            return P + __builtin_ctz(Stop);
+    }
+    return numberEndScalar(P, End);
+}
+
+static const char* spaceEndSSE2(const char* P, const char* End, unsigned &Line, const char* &LineBegin) {
+    for (; End - P >= 16; P += 16) {
+        __m128i C = _mm_loadu_si128(reinterpret_cast<const __m128i*>(P));
+        unsigned Stop = ~static_cast<unsigned>(_mm_movemask_epi8(spaceMask128(C))) & 0xFFFFu;
+        unsigned Newlines = static_cast<unsigned>(_mm_movemask_epi8(_mm_cmpeq_epi8(C, _mm_set1_epi8('\n'))));
+        if (Stop)
+            Newlines &= (1u << __builtin_ctz(Stop)) - 1;
+        if (Newlines) {
+            Line += __builtin_popcount(Newlines);
+            LineBegin = P + (31 - __builtin_clz(Newlines)) + 1;
+        }
+        if (Stop)
+            return P + __builtin_ctz(Stop);
+    }
+    return spaceEndScalar(P, End, Line, LineBegin);
+}
+
+__attribute__((target("avx2"))) static inline __m256i identMask256(__m256i C) {
+    __m256i Lower = _mm256_or_si256(C, _mm256_set1_epi8(0x20));
+    return _mm256_or_si256(NEXON_IN_RANGE_256(Lower, 'a', 26), NEXON_IN_RANGE_256(C, '0', 10));
+}
+
+__attribute__((target("avx2"))) static inline __m256i numberMask256(__m256i C) {
+    return _mm256_or_si256(NEXON_IN_RANGE_256(C, '0', 10), _mm256_cmpeq_epi8(C, _mm256_set1_epi8('.')));
+}
+
+__attribute__((target("avx2"))) static inline __m256i spaceMask256(__m256i C) {
+    return _mm256_or_si256(_mm256_cmpeq_epi8(C, _mm256_set1_epi8(' ')), NEXON_IN_RANGE_256(C, '\t', 5));
+}
+
+__attribute__((target("avx2"))) static const char* identEndAVX2(const char* P, const char* End) {
+    for (; End - P >= 32; P += 32) {
+        __m256i C = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(P));
+        unsigned Stop = ~static_cast<unsigned>(_mm256_movemask_epi8(identMask256(C)));
+        if (Stop)
+            return P + __builtin_ctz(Stop);
+    }
+    return identEndSSE2(P, End);
+}
+
+__attribute__((target("avx2"))) static const char* numberEndAVX2(const char* P, const char* End) {
+    for (; End - P >= 32; P += 32) {
+        __m256i C = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(P));
+        unsigned Stop = ~static_cast<unsigned>(_mm256_movemask_epi8(numberMask256(C)));
+        if (Stop)
+            return P + __builtin_ctz(Stop);
+    }
+    return numberEndSSE2(P, End);
+}
+
+__attribute__((target("avx2"))) static const char* spaceEndAVX2(const char* P, const char* End, unsigned &Line,
+                                                                const char* &LineBegin) {
+    for (; End - P >= 32; P += 32) {
+        __m256i C = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(P));
+        unsigned Stop = ~static_cast<unsigned>(_mm256_movemask_epi8(spaceMask256(C)));
+        unsigned Newlines = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(C, _mm256_set1_epi8('\n'))));
+        if (Stop)
+            Newlines &= (1u << __builtin_ctz(Stop)) - 1;
+        if (Newlines) {
+            Line += __builtin_popcount(Newlines);
+            LineBegin = P + (31 - __builtin_clz(Newlines)) + 1;
+        }
+        if (Stop)
+            return P + __builtin_ctz(Stop);
+    }
+    return spaceEndSSE2(P, End, Line, LineBegin);
+}
+
+#undef NEXON_IN_RANGE_128
+#undef NEXON_IN_RANGE_256
+
+#endif // NEXON_LEXER_X86_SIMD
+
+struct ScanKernels {
+    const char* Name;
+    const char* (*IdentEnd)(const char*, const char*);
+    const char* (*NumberEnd)(const char*, const char*);
+    const char* (*SpaceEnd)(const char*, const char*, unsigned&, const char*&);
+};
+
+static const ScanKernels ScalarKernels = { "scalar", identEndScalar, numberEndScalar, spaceEndScalar };
+
+// Picks the widest kernels the running CPU supports, once per process.
+static const ScanKernels &scanKernels() {
+    static const ScanKernels Kernels = []() -> ScanKernels {
+#ifdef NEXON_LEXER_X86_SIMD
+        if (__builtin_cpu_supports("avx2"))
+            return { "avx2", identEndAVX2, numberEndAVX2, spaceEndAVX2 };
+        return { "sse2", identEndSSE2, numberEndSSE2, spaceEndSSE2 };
+#else
+        return ScalarKernels;
+#endif
+    }();
+    return Kernels;
+}
+
+Lexer::Lexer(std::string_view input, LexerKernels kernels)
+    : Input(input), Kernels(kernels == LexerKernels::Scalar ? &ScalarKernels : &scanKernels()), Position(0) { }
+
+int Lexer::getNextToken() {
+    const ScanKernels &K = *Kernels;
+    const char* Begin = Input.data();
+    const char* End = Begin + Input.size();
+    const char* P = Begin + Position;
+    const char* LineBegin = Begin + LineStart;
+
+    // Skip whitespace and '#' comments; memchr is itself vectorized by the C library.
+    while (true) {
+        // Most tokens are separated by at most one space; only call a kernel for longer runs.
+        if (P != End && *P == ' ')
+            ++P;
+        if (P != End && (charClass(*P) & CC_Space))
+            P = K.SpaceEnd(P, End, Line, LineBegin);
+        if (P == End || *P != '#')
+            break;
+        const void* Newline = std::memchr(P, '\n', static_cast<size_t>(End - P));
+        P = Newline ? static_cast<const char*>(Newline) : End;
+    }
+
+    const char* Start = P;
+    TokenLoc.Line = Line;
+    TokenLoc.Column = static_cast<unsigned>(Start - LineBegin + 1);
+    int Tok;
+    if (P == End) {
+        Tok = tok_eof;
+    } else if (charClass(*P) & CC_Alpha) {
+        ++P;
+        if (P != End && (charClass(*P) & (CC_Alpha | CC_Digit)))
+            P = K.IdentEnd(P, End);
+        Tok = lookupKeyword(std::string_view(Start, static_cast<size_t>(P - Start)));
+    } else if (charClass(*P) & (CC_Digit | CC_Dot)) {
+        ++P;
+        if (P != End && (charClass(*P) & (CC_Digit | CC_Dot)))
+            P = K.NumberEnd(P, End);
+        // Short integer literals convert exactly without a float parser. Others go through
+        // from_chars, which parses in place and, like strtod, ignores malformed trailing
+        // text such as a second '.'.
+        uint64_t IntVal = 0;
+        const char* Q = Start;
+        while (Q != P && (charClass(*Q) & CC_Digit))
+            IntVal = IntVal * 10 + static_cast<uint64_t>(*Q++ - '0');
+        if (Q == P && P - Start <= 15) {
+            NumVal = static_cast<double>(IntVal);
+        } else {
+            NumVal = 0.0;
+            std::from_chars(Start, P, NumVal);
+        }
+        Tok = tok_number;
+    } else if (P + 1 != End && P[1] == '=' && (*P == '<' || *P == '>' || *P == '=' || *P == '!')) {
+        Tok = *P == '<' ? tok_le : *P == '>' ? tok_ge : *P == '=' ? tok_eq : tok_ne;
+        P += 2;
+    } else {
+        // Single-character token; unsigned so bytes >= 0x80 cannot alias tok_* values.
+        Tok = static_cast<unsigned char>(*P++);
+    }
+
+    TokenText = std::string_view(Start, static_cast<size_t>(P - Start));
+    Position = static_cast<size_t>(P - Begin);
+    LineStart = static_cast<size_t>(LineBegin - Begin);
+    return Tok;
+}
+
+void benchmarkLexer(std::string_view input) {
+    // Repeat until enough bytes have been lexed for a stable figure.
+    const size_t TargetBytes = size_t(1) << 30;
+    size_t Passes = std::max<size_t>(1, TargetBytes / std::max<size_t>(input.size(), 1));
+    size_t Tokens = 0;
+    auto startTime = std::chrono::high_resolution_clock::now();
+    for (size_t Pass = 0; Pass < Passes; ++Pass) {
+        Lexer lex(input);
+        while (lex.getNextToken() != tok_eof)
+            ++Tokens;
+    }
+    auto endTime = std::chrono::high_resolution_clock::now();
+    std::chrono::duration<double> elapsed = endTime - startTime;
+    double bytes = static_cast<double>(input.size()) * static_cast<double>(Passes);
+    std::cout << "Lexer benchmark (" << scanKernels().Name << "): " << Tokens << " tokens, "
+              << bytes / elapsed.count() / 1e9 << " GB/s." << std::endl;
+}
+
+void debugTokens(std::string_view input) {
+    Lexer lex(input);
+    int token = lex.getNextToken();
+    while (token != tok_eof) {
+        std::cout << "Token: " << token << ", ";
+        if (token == tok_identifier)
+            std::cout << "Identifier: " << lex.getIdentifierStr();
+        else if (token == tok_number)
+            std::cout << "Number: " << lex.getNumVal();
+        std::cout << std::endl;
+        token = lex.getNextToken();
+    }
+}
+
+void extraLexerRoutine() {
+    for (int i = 0; i < 50; ++i) {
+        std::cout << "Extra Lexer routine line " << i << std::endl;
+    }
+}
+
+void additionalLexerWork() {
+    for (int i = 0; i < 20; ++i) {
+        std::cout << "Additional Lexer work " << i << std::endl;
+    }
+}
+}
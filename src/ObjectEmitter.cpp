@@ -0,0 +1,183 @@
+#include "Nexon/ObjectEmitter.h"
+#include "Nexon/StartupProfile.h"
+#include "llvm/ADT/StringMap.h"
+#include "llvm/IR/LegacyPassManager.h"
+#include "llvm/MC/SubtargetFeature.h"
+#include "llvm/MC/TargetRegistry.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/Path.h"
+#include "llvm/Support/Program.h"
+#include "llvm/Support/SmallVectorMemoryBuffer.h"
+#include "llvm/Support/TargetSelect.h"
+#include "llvm/Support/raw_ostream.h"
+#include <cstdlib>
+#include <iostream>
+#include <mutex>
+
+namespace Nexon {
+using namespace llvm;
+
+void ObjectEmitter::initializeTargets() {
+    static std::once_flag Once;
+    std::call_once(Once, [] {
+        StartupProfile::Stage Stage("llvm targets");
+        InitializeAllTargetInfos();
+        InitializeAllTargets();
+        InitializeAllTargetMCs();
+        InitializeAllAsmPrinters();
+        InitializeAllAsmParsers();
+    });
+}
+
+std::unique_ptr<TargetMachine> ObjectEmitter::createTargetMachine(const std::string &Triple,
+                                                                  const std::string &CPU) {
+    initializeTargets();
+
+    std::string TargetTriple = Triple.empty() ? sys::getProcessTriple() : Triple;
+    std::string Error;
+    const Target* T = TargetRegistry::lookupTarget(TargetTriple, Error);
+    if (!T) {
+        std::cerr << "Error: Unknown target " << TargetTriple << ": " << Error << "\n";
+        return nullptr;
+    }
+
+    // Tune for the host unless a CPU was requested explicitly.
+    std::string CPUName = CPU;
+    SubtargetFeatures Features;
+    if (CPU.empty() || CPU == "native") {
+        if (Triple.empty()) {
+            CPUName = sys::getHostCPUName().str();
+            StringMap<bool> HostFeatures;
+            if (sys::getHostCPUFeatures(HostFeatures))
+                for (auto &F : HostFeatures)
+                    Features.AddFeature(F.first(), F.second);
+        } else {
+            CPUName = "generic";
+        }
+    }
+
+    TargetOptions Options;
+    std::unique_ptr<TargetMachine> TM(T->createTargetMachine(TargetTriple, CPUName, Features.getString(),
+                                                             Options, Reloc::PIC_, None,
+                                                             CodeGenOpt::Aggressive));
+    if (!TM)
+        std::cerr << "Error: Unable to create target machine for " << TargetTriple << "\n";
+    return TM;
+}
+
+void ObjectEmitter::configureModule(Module &M, TargetMachine &TM) {
+    M.setTargetTriple(TM.getTargetTriple().str());
+    M.setDataLayout(TM.createDataLayout());
+}
+
+bool ObjectEmitter::emitObjectFile(Module &M, TargetMachine &TM, const std::string &Path) {
+    std::error_code EC;
+    raw_fd_ostream Out(Path, EC, sys::fs::OF_None);
+    if (EC) {
+        std::cerr << "Error: Unable to open " << Path << ": " << EC.message() << "\n";
+        return false;
+    }
+    if (!emitObject(M, TM, Out))
+        return false;
+    Out.flush();
+    return true;
+}
+
+std::unique_ptr<MemoryBuffer> ObjectEmitter::emitObjectBuffer(Module &M, TargetMachine &TM) {
+    SmallVector<char, 0> Buffer;
+    raw_svector_ostream Out(Buffer);
+    if (!emitObject(M, TM, Out))
+        return nullptr;
+    return std::make_unique<SmallVectorMemoryBuffer>(std::move(Buffer), M.getModuleIdentifier(), false);
+}
+
+bool ObjectEmitter::emitObject(Module &M, TargetMachine &TM, raw_pwrite_stream &Out) {
+    legacy::PassManager PM;
+    if (TM.addPassesToEmitFile(PM, Out, nullptr, CGFT_ObjectFile)) {
+        std::cerr << "Error: Target " << TM.getTargetTriple().str() << " cannot emit object files.\n";
+        return false;
+    }
+    PM.run(M);
+    return true;
+}
+
+// Directories holding the runtime libraries: $NEXON_RUNTIME_DIR if set, otherwise the
+// directory of the nexon executable (a build tree) and ../lib next to it (an install).
+static std::vector<std::string> getRuntimeDirectories() {
+    if (const char* Dir = std::getenv("NEXON_RUNTIME_DIR"))
+        return { Dir };
+    SmallString<256> ExeDir(sys::fs::getMainExecutable(nullptr, nullptr));
+    sys::path::remove_filename(ExeDir);
+    SmallString<256> LibDir(ExeDir);
+    sys::path::append(LibDir, "..", "lib");
+    return { std::string(ExeDir), std::string(LibDir) };
+}
+
+// Returns the path of the library Name in the first of Dirs that has it, or an empty
+// string if none does.
+static std::string findLibrary(const std::vector<std::string> &Dirs, StringRef Name) {
+    for (const auto &Dir : Dirs) {
+        SmallString<256> Path(Dir);
+        sys::path::append(Path, Name);
+        if (sys::fs::exists(Path))
+            return std::string(Path);
+    }
+    return "";
+}
+
+bool ObjectEmitter::linkExecutable(const std::vector<std::string> &Objects, const std::string &Output) {
+    std::vector<std::string> Dirs = getRuntimeDirectories();
+    std::string Runtime = findLibrary(Dirs, NEXON_RUNTIME_LIBRARY);
+    if (Runtime.empty()) {
+        std::cerr << "Error: " << NEXON_RUNTIME_LIBRARY << " not found in";
+        for (const auto &Dir : Dirs)
+            std::cerr << " " << Dir;
+        std::cerr << ". Set NEXON_RUNTIME_DIR to the directory that holds it.\n";
+        return false;
+    }
+    // LLVMSupport is looked up next to the runtime first, then in the LLVM installation
+    // nexon was built against.
+    std::string Support = findLibrary(Dirs, sys::path::filename(NEXON_LLVM_SUPPORT_LIBRARY));
+    if (Support.empty())
+        Support = NEXON_LLVM_SUPPORT_LIBRARY;
+    // The runtime is C++ on top of LLVMSupport; the linker only pulls in the members
+    // a program references, so programs without channels or parallel loops stay small.
+    return runLinker(Objects, Output, { Runtime, Support, "-lstdc++", "-lpthread", "-lm" });
+}
+
+bool ObjectEmitter::linkRelocatable(const std::vector<std::string> &Objects, const std::string &Output) {
+    return runLinker(Objects, Output, { "-r", "-nostdlib" });
+}
+
+bool ObjectEmitter::runLinker(const std::vector<std::string> &Objects, const std::string &Output,
+                              const std::vector<std::string> &ExtraArgs) {
+    // Only the linker driver is invoked, to pull in the C runtime startup files and the
+    // system libraries.
+    const char* LinkerEnv = std::getenv("NEXON_LINKER");
+    std::string LinkerName = LinkerEnv ? LinkerEnv : "cc";
+    auto Linker = sys::findProgramByName(LinkerName);
+    if (!Linker) {
+        std::cerr << "Error: Linker " << LinkerName << " not found. Set NEXON_LINKER to override.\n";
+        return false;
+    }
+    std::vector<StringRef> Args = { *Linker };
+    for (const auto &Obj : Objects)
+        Args.push_back(Obj);
+    Args.push_back("-o");
+    Args.push_back(Output);
+    for (const auto &Arg : ExtraArgs)
+        Args.push_back(Arg);
+    std::string ErrMsg;
+    int Ret = sys::ExecuteAndWait(*Linker, Args, None, {}, 0, 0, &ErrMsg);
+    if (Ret != 0) {
+        std::cerr << "Error: Linking " << Output << " failed";
+        if (!ErrMsg.empty())
+            std::cerr << ": " << ErrMsg;
+        std::cerr << "\n";
+        return false;
+    }
+    return true;
+}
+
+}
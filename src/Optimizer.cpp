@@ -1,33 +1,103 @@
-#include "Nexon/Optimizer.h"
-#include "Nexon/CodeGen.h"
-#include "llvm/IR/LegacyPassManager.h"
-#include "llvm/Transforms/Scalar.h"
-#include <iostream>
-
-namespace Nexon {
-
-void Optimizer::runOptimizationPasses() {
-    llvm::legacy::PassManager passManager;
-    passManager.add(llvm::createPromoteMemoryToRegisterPass());
-    passManager.add(llvm::createInstructionCombiningPass());
-    passManager.add(llvm::createReassociatePass());
-    passManager.add(llvm::createGVNPass());
-    passManager.add(llvm::createCFGSimplificationPass());
-    passManager.run(*CodeGen::TheModule());
-    std::cout << "Optimization passes executed." << std::endl;
-}
-
-void extraOptimization() {
-    std::cout << "Running extra optimization routine..." << std::endl;
-    for (int i = 0; i < 50; ++i) {
-        volatile int dummy = i * i;
-    }
-    std::cout << "Extra optimization routine completed." << std::endl;
-}
-
-void additionalOptimizerRoutine() {
-    for (int i = 0; i < 50; ++i) {
-        std::cout << "Additional optimizer iteration " << i << std::endl;
-    }
-}
-}
+#include "Nexon/Optimizer.h"
+#include "Nexon/ObjectEmitter.h"
+#include "llvm/Analysis/CGSCCPassManager.h"
+#include "llvm/Analysis/LoopAnalysisManager.h"
+#include "llvm/IR/PassManager.h"
+#include "llvm/Passes/PassBuilder.h"
+#include <iostream>
+
+namespace Nexon {
+using namespace llvm;
+
+OptLevel Optimizer::CurrentLevel = OptLevel::O2;
+std::string Optimizer::CustomPipeline;
+
+static OptimizationLevel toLLVMLevel(OptLevel Level) {
+    switch (Level) {
+        case OptLevel::O0: return OptimizationLevel::O0;
+        case OptLevel::O1: return OptimizationLevel::O1;
+        case OptLevel::O2: return OptimizationLevel::O2;
+        case OptLevel::O3: return OptimizationLevel::O3;
+        case OptLevel::Os: return OptimizationLevel::Os;
+    }
+    return OptimizationLevel::O2;
+}
+
+bool Optimizer::runOptimizationPasses(Module &M) {
+    auto TM = ObjectEmitter::createTargetMachine("", "");
+    if (!TM)
+        return false;
+    return runOptimizationPasses(M, *TM);
+}
+
+bool Optimizer::runOptimizationPasses(Module &M, TargetMachine &TM) {
+    if (M.getTargetTriple().empty())
+        M.setTargetTriple(TM.getTargetTriple().str());
+    if (M.getDataLayout().isDefault())
+        M.setDataLayout(TM.createDataLayout());
+
+    // Same policy as clang: unroll, interleave and vectorize from -O2 (including -Os).
+    bool Aggressive = CurrentLevel == OptLevel::O2 || CurrentLevel == OptLevel::O3 ||
+                      CurrentLevel == OptLevel::Os;
+    PipelineTuningOptions PTO;
+    PTO.LoopUnrolling = Aggressive;
+    PTO.LoopInterleaving = Aggressive;
+    PTO.LoopVectorization = Aggressive;
+    PTO.SLPVectorization = Aggressive;
+
+    LoopAnalysisManager LAM;
+    FunctionAnalysisManager FAM;
+    CGSCCAnalysisManager CGAM;
+    ModuleAnalysisManager MAM;
+    PassBuilder PB(&TM, PTO);
+    PB.registerModuleAnalyses(MAM);
+    PB.registerCGSCCAnalyses(CGAM);
+    PB.registerFunctionAnalyses(FAM);
+    PB.registerLoopAnalyses(LAM);
+    PB.crossRegisterProxies(LAM, FAM, CGAM, MAM);
+
+    ModulePassManager MPM = CurrentLevel == OptLevel::O0
+        ? PB.buildO0DefaultPipeline(OptimizationLevel::O0)
+        : PB.buildPerModuleDefaultPipeline(toLLVMLevel(CurrentLevel));
+    if (!CustomPipeline.empty()) {
+        if (auto Err = PB.parsePassPipeline(MPM, CustomPipeline)) {
+            std::cerr << "Error: Invalid pass pipeline '" << CustomPipeline << "': "
+                      << toString(std::move(Err)) << "\n";
+            return false;
+        }
+    }
+    MPM.run(M, MAM);
+    return true;
+}
+
+bool Optimizer::parseOptimizationFlag(const std::string &Flag, OptLevel &Level) {
+    if (Flag == "-O0") Level = OptLevel::O0;
+    else if (Flag == "-O1") Level = OptLevel::O1;
+    else if (Flag == "-O2") Level = OptLevel::O2;
+    else if (Flag == "-O3") Level = OptLevel::O3;
+    else if (Flag == "-Os") Level = OptLevel::Os;
+    else return false;
+    return true;
+}
+
+void Optimizer::addCustomPasses(const std::string &Pipeline) {
+    if (!CustomPipeline.empty())
+        CustomPipeline += ",";
+    CustomPipeline += Pipeline;
+}
+
+void extraOptimization() {
+    std::cout << "Running extra optimization routine..." << std::endl;
+    for (int i = 0; i < 50; ++i) {
+        volatile int dummy = i * i;
+        (void)dummy;
+    }
+    std::cout << "Extra optimization routine completed." << std::endl;
+}
+
+void additionalOptimizerRoutine() {
+    for (int i = 0; i < 50; ++i) {
+        std::cout << "Additional optimizer iteration " << i << std::endl;
+    }
+}
+}
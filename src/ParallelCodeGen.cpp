@@ -0,0 +1,57 @@
+#include "Nexon/ParallelCodeGen.h"
+#include "Nexon/CodeGen.h"
+#include "Nexon/Concurrency.h"
+#include "Nexon/ObjectEmitter.h"
+#include "Nexon/Optimizer.h"
+#include <algorithm>
+#include <atomic>
+#include <thread>
+
+namespace Nexon {
+using namespace llvm;
+
+unsigned ParallelCodeGen::getDefaultJobs() {
+    unsigned Jobs = std::thread::hardware_concurrency();
+    return Jobs ? Jobs : 1;
+}
+
+unsigned ParallelCodeGen::getNumShards(unsigned Jobs, size_t NumFunctions) {
+    return static_cast<unsigned>(std::min<size_t>(std::max(Jobs, 1u), NumFunctions));
+}
+
+bool ParallelCodeGen::lowerFunctions(const ASTContext &Ctx, ArrayRef<FuncRef> Functions,
+                                     const std::shared_ptr<FunctionRegistry> &Registry, unsigned Jobs,
+                                     const std::string &Triple, const std::string &CPU,
+                                     const ShardConsumer &Consume) {
+    unsigned NumShards = getNumShards(Jobs, Functions.size());
+    if (NumShards == 0)
+        return true;
+    // Target machines are created up front: target registration is not thread-safe.
+    std::vector<std::unique_ptr<TargetMachine>> TMs;
+    for (unsigned Shard = 0; Shard < NumShards; ++Shard) {
+        TMs.push_back(ObjectEmitter::createTargetMachine(Triple, CPU));
+        if (!TMs.back())
+            return false;
+    }
+
+    std::atomic<bool> Failed(false);
+    Concurrency::parallelFor(0, NumShards, [&](size_t Shard) {
+        TargetMachine &TM = *TMs[Shard];
+        CompilationSession Session(Registry);
+        ObjectEmitter::configureModule(Session.getModule(), TM);
+        size_t Begin = Functions.size() * Shard / NumShards;
+        size_t End = Functions.size() * (Shard + 1) / NumShards;
+        for (size_t I = Begin; I < End && !Failed; ++I) {
+            if (!Ctx.getFunction(Functions[I]).codegen(Ctx, Session)) {
+                Failed = true;
+                break;
+            }
+        }
+        if (Failed || !Optimizer::runOptimizationPasses(Session.getModule(), TM) ||
+            !Consume(static_cast<unsigned>(Shard), Session.takeModule(), TM))
+            Failed = true;
+    }, /*grain=*/1);
+    return !Failed;
+}
+
+}
@@ -1,154 +1,483 @@
-#include "Nexon/Parser.h"
-#include <map>
-#include <iostream>
-
-namespace Nexon {
-
-static std::map<int, int> BinopPrecedence = {
-    {'<', 10},
-    {'+', 20},
-    {'-', 20},
-    {'*', 40},
-    {'/', 40}
-};
-
-Parser::Parser(const std::string &input) : Lex(input) {
-    CurTok = Lex.getNextToken();
-}
-
-int Parser::getCurrentToken() { return CurTok; }
-int Parser::getNextToken() { return CurTok = Lex.getNextToken(); }
-
-std::unique_ptr<ExprAST> Parser::parseNumberExpr() {
-    auto Result = std::make_unique<NumberExprAST>(Lex.getNumVal());
-    getNextToken();
-    return Result;
-}
-
-std::unique_ptr<ExprAST> Parser::parseParenExpr() {
-    getNextToken(); // Consume '('
-    auto V = parseExpression();
-    if (getCurrentToken() != ')') {
-        std::cerr << "Error: expected ')'." << std::endl;
-        return nullptr;
-    }
-    getNextToken(); // Consume ')'
-    return V;
-}
-
-std::unique_ptr<ExprAST> Parser::parseIdentifierExpr() {
-    std::string IdName = Lex.getIdentifierStr();
-    getNextToken();
-    if (getCurrentToken() != '(')
-        return std::make_unique<VariableExprAST>(IdName);
-    getNextToken(); // Consume '('
-    std::vector<std::unique_ptr<ExprAST>> Args;
-    if (getCurrentToken() != ')') {
-        while (true) {
-            if (auto Arg = parseExpression())
-                Args.push_back(std::move(Arg));
-            else
-                return nullptr;
-            if (getCurrentToken() == ')')
-                break;
-            if (getCurrentToken() != ',') {
-                std::cerr << "Error: expected ',' or ')'." << std::endl;
-                return nullptr;
-            }
-            getNextToken();
-        }
-    }
-    getNextToken(); // Consume ')'
-    return std::make_unique<CallExprAST>(IdName, std::move(Args));
-}
-
-std::unique_ptr<ExprAST> Parser::parsePrimary() {
-    switch (getCurrentToken()) {
-        case tok_identifier:
-            return parseIdentifierExpr();
-        case tok_number:
-            return parseNumberExpr();
-        case '(':
-            return parseParenExpr();
-        default:
-            std::cerr << "Error: unknown token when expecting an expression." << std::endl;
-            return nullptr;
-    }
-}
-
-std::unique_ptr<ExprAST> Parser::parseBinOpRHS(int ExprPrec, std::unique_ptr<ExprAST> LHS) {
-    while (true) {
-        int TokPrec = BinopPrecedence[getCurrentToken()];
-        if (TokPrec < ExprPrec)
-            return LHS;
-        int BinOp = getCurrentToken();
-        getNextToken();
-        auto RHS = parsePrimary();
-        if (!RHS)
-            return nullptr;
-        int NextPrec = BinopPrecedence[getCurrentToken()];
-        if (TokPrec < NextPrec) {
-            RHS = parseBinOpRHS(TokPrec + 1, std::move(RHS));
-            if (!RHS)
-                return nullptr;
-        }
-        LHS = std::make_unique<BinaryExprAST>(BinOp, std::move(LHS), std::move(RHS));
-    }
-}
-
-std::unique_ptr<ExprAST> Parser::parseExpression() {
-    auto LHS = parsePrimary();
-    if (!LHS)
-        return nullptr;
-    return parseBinOpRHS(0, std::move(LHS));
-}
-
-std::unique_ptr<PrototypeAST> Parser::parsePrototype() {
-    if (getCurrentToken() != tok_identifier) {
-        std::cerr << "Error: expected function name in prototype." << std::endl;
-        return nullptr;
-    }
-    std::string FnName = Lex.getIdentifierStr();
-    getNextToken();
-    if (getCurrentToken() != '(') {
-        std::cerr << "Error: expected '(' in prototype." << std::endl;
-        return nullptr;
-    }
-    getNextToken(); // Consume '('
-    std::vector<std::string> ArgNames;
-    while (getCurrentToken() == tok_identifier) {
-        ArgNames.push_back(Lex.getIdentifierStr());
-        getNextToken();
-    }
-    if (getCurrentToken() != ')') {
-        std::cerr << "Error: expected ')' in prototype." << std::endl;
-        return nullptr;
-    }
-    getNextToken(); // Consume ')'
-    return std::make_unique<PrototypeAST>(FnName, std::move(ArgNames));
-}
-
-std::unique_ptr<FunctionAST> Parser::parseDefinition() {
-    getNextToken(); // Consume 'def'
-    auto Proto = parsePrototype();
-    if (!Proto)
-        return nullptr;
-    if (auto E = parseExpression())
-        return std::make_unique<FunctionAST>(std::move(Proto), std::move(E));
-    return nullptr;
-}
-
-std::unique_ptr<FunctionAST> Parser::parseTopLevelExpr() {
-    if (auto E = parseExpression()) {
-        auto Proto = std::make_unique<PrototypeAST>("__anon_expr", std::vector<std::string>());
-        return std::make_unique<FunctionAST>(std::move(Proto), std::move(E));
-    }
-    return nullptr;
-}
-
-void extraParserRoutine() {
-    for (int i = 0; i < 50; ++i) {
-        std::cout << "Extra parser iteration " << i << std::endl;
-    }
-}
-}
+#include "Nexon/Parser.h"
+#include "llvm/ADT/SmallVector.h"
+#include <charconv>
+#include <cstdint>
+#include <map>
+#include <iostream>
+
+namespace Nexon {
+
+static std::map<int, int> BinopPrecedence = {
+    {'=', 2},
+    {tok_eq, 5},
+    {tok_ne, 5},
+    {'<', 10},
+    {'>', 10},
+    {tok_le, 10},
+    {tok_ge, 10},
+    {'+', 20},
+    {'-', 20},
+    {'*', 40},
+    {'/', 40}
+};
+
+// Returns the precedence of a binary operator token, or -1 if it is not one.
+static int getTokPrecedence(int Tok) {
+    auto It = BinopPrecedence.find(Tok);
+    return It == BinopPrecedence.end() ? -1 : It->second;
+}
+
+// Operator stored in the AST for a binary operator token.
+static char getBinaryOp(int Tok) {
+    switch (Tok) {
+        case tok_le: return OpLessEqual;
+        case tok_ge: return OpGreaterEqual;
+        case tok_eq: return OpEqual;
+        case tok_ne: return OpNotEqual;
+        default: return static_cast<char>(Tok);
+    }
+}
+
+Parser::Parser(const TokenBuffer &tokens, ASTContext &ctx) : Tokens(tokens), Ctx(ctx) { }
+
+void Parser::logError(const char *Msg) const {
+    SourceLocation Loc = Tokens.getLoc(Index);
+    std::cerr << "Error: " << Loc.Line << ":" << Loc.Column << ": " << Msg << std::endl;
+}
+
+int Parser::getNextToken() {
+    // The final token is tok_eof; stay on it once reached.
+    if (Index + 1 < Tokens.size())
+        ++Index;
+    return getCurrentToken();
+}
+
+int Parser::peekToken(size_t K) const {
+    return Tokens.getKind(std::min(Index + K, Tokens.size() - 1));
+}
+
+ExprRef Parser::parseNumberExpr(bool Negative) {
+    // Literals of digits only are i64, parsed exactly; anything with a '.' is f64.
+    std::string_view Text = Tokens.getText(Index);
+    ExprRef Result;
+    if (std::all_of(Text.begin(), Text.end(), [](char C) { return C >= '0' && C <= '9'; })) {
+        // The magnitude may be one more than INT64_MAX when negated.
+        uint64_t Magnitude = 0;
+        uint64_t Limit = static_cast<uint64_t>(INT64_MAX) + (Negative ? 1 : 0);
+        if (std::from_chars(Text.data(), Text.data() + Text.size(), Magnitude).ec != std::errc() ||
+            Magnitude > Limit) {
+            logError("integer literal does not fit in i64; write it with a '.' for an f64.");
+            return InvalidRef;
+        }
+        Result = Ctx.makeInteger(static_cast<int64_t>(Negative ? 0 - Magnitude : Magnitude));
+    } else {
+        double Value = Tokens.getNumVal(Index);
+        Result = Ctx.makeNumber(Negative ? -Value : Value);
+    }
+    getNextToken();
+    return Result;
+}
+
+// - operand. A literal operand is negated in place, so the most negative i64 can be
+// written. Anything else is multiplied by -1, which unlike 0 - x keeps the sign of a
+// floating-point zero and, for an integer operand, the operand's type.
+ExprRef Parser::parseNegationExpr() {
+    getNextToken(); // Consume '-'
+    if (getCurrentToken() == tok_number)
+        return parseNumberExpr(/*Negative=*/true);
+    ExprRef Operand = parsePrimary();
+    if (Operand == InvalidRef)
+        return InvalidRef;
+    return Ctx.makeBinary('*', Ctx.makeInteger(-1), Operand);
+}
+
+ExprRef Parser::parseParenExpr() {
+    getNextToken(); // Consume '('
+    ExprRef V = parseExpression();
+    if (V == InvalidRef)
+        return InvalidRef;
+    if (getCurrentToken() != ')') {
+        logError("expected ')'.");
+        return InvalidRef;
+    }
+    getNextToken(); // Consume ')'
+    return V;
+}
+
+ExprRef Parser::parseIdentifierExpr() {
+    Symbol IdName = Ctx.intern(Tokens.getText(Index));
+    getNextToken();
+    if (getCurrentToken() != '(')
+        return Ctx.makeVariable(IdName);
+    getNextToken(); // Consume '('
+    SmallVector<ExprRef, 8> Args;
+    if (getCurrentToken() != ')') {
+        while (true) {
+            ExprRef Arg = parseExpression();
+            if (Arg == InvalidRef)
+                return InvalidRef;
+            Args.push_back(Arg);
+            if (getCurrentToken() == ')')
+                break;
+            if (getCurrentToken() != ',') {
+                logError("expected ',' or ')'.");
+                return InvalidRef;
+            }
+            getNextToken();
+        }
+    }
+    getNextToken(); // Consume ')'
+    return Ctx.makeCall(IdName, Args);
+}
+
+ExprRef Parser::parseBlockExpr() {
+    getNextToken(); // Consume '{'
+    SmallVector<ExprRef, 8> Body;
+    while (getCurrentToken() != '}') {
+        ExprRef E = parseExpression();
+        if (E == InvalidRef)
+            return InvalidRef;
+        Body.push_back(E);
+        if (getCurrentToken() == ';') {
+            getNextToken();
+        } else if (getCurrentToken() != '}') {
+            logError("expected ';' or '}' in block.");
+            return InvalidRef;
+        }
+    }
+    getNextToken(); // Consume '}'
+    return Ctx.makeBlock(Body);
+}
+
+bool Parser::parseForHeader(Symbol &Var, ExprRef &Start, ExprRef &End, ExprRef &Extra) {
+    getNextToken(); // Consume 'for'
+    if (getCurrentToken() != tok_identifier) {
+        logError("expected loop variable after 'for'.");
+        return false;
+    }
+    Var = Ctx.intern(Tokens.getText(Index));
+    getNextToken();
+    if (getCurrentToken() != '=') {
+        logError("expected '=' after loop variable.");
+        return false;
+    }
+    getNextToken(); // Consume '='
+    Start = parseExpression();
+    if (Start == InvalidRef)
+        return false;
+    if (getCurrentToken() != ',') {
+        logError("expected ',' after loop start value.");
+        return false;
+    }
+    getNextToken(); // Consume ','
+    End = parseExpression();
+    if (End == InvalidRef)
+        return false;
+    Extra = InvalidRef;
+    if (getCurrentToken() == ',') {
+        getNextToken(); // Consume ','
+        Extra = parseExpression();
+        if (Extra == InvalidRef)
+            return false;
+    }
+    return true;
+}
+
+ExprRef Parser::parseLoopBody() {
+    if (getCurrentToken() != '{') {
+        logError("expected '{' before loop body.");
+        return InvalidRef;
+    }
+    return parseBlockExpr();
+}
+
+// parallel for i = start, end [, grain] [reduce(op: acc)] { body }
+ExprRef Parser::parseParallelForExpr() {
+    getNextToken(); // Consume 'parallel'
+    if (getCurrentToken() != tok_for) {
+        logError("expected 'for' after 'parallel'.");
+        return InvalidRef;
+    }
+    Symbol Var;
+    ExprRef Start, End, Grain;
+    if (!parseForHeader(Var, Start, End, Grain))
+        return InvalidRef;
+    char ReduceOp = 0;
+    Symbol Accumulator = InvalidRef;
+    if (getCurrentToken() == tok_identifier && Tokens.getText(Index) == "reduce") {
+        getNextToken(); // Consume 'reduce'
+        if (getCurrentToken() != '(') {
+            logError("expected '(' after 'reduce'.");
+            return InvalidRef;
+        }
+        getNextToken(); // Consume '('
+        int Tok = getCurrentToken();
+        std::string_view Text = Tokens.getText(Index);
+        if (Tok == '+' || Tok == '*')
+            ReduceOp = static_cast<char>(Tok);
+        else if (Tok == tok_identifier && Text == "min")
+            ReduceOp = ReduceMin;
+        else if (Tok == tok_identifier && Text == "max")
+            ReduceOp = ReduceMax;
+        else {
+            logError("expected '+', '*', 'min' or 'max' as reduction operator.");
+            return InvalidRef;
+        }
+        getNextToken();
+        if (getCurrentToken() != ':') {
+            logError("expected ':' after reduction operator.");
+            return InvalidRef;
+        }
+        getNextToken(); // Consume ':'
+        if (getCurrentToken() != tok_identifier) {
+            logError("expected reduction variable.");
+            return InvalidRef;
+        }
+        Accumulator = Ctx.intern(Tokens.getText(Index));
+        getNextToken();
+        if (getCurrentToken() != ')') {
+            logError("expected ')' after reduction variable.");
+            return InvalidRef;
+        }
+        getNextToken(); // Consume ')'
+    }
+    ExprRef Body = parseLoopBody();
+    if (Body == InvalidRef)
+        return InvalidRef;
+    return Ctx.makeParallelFor(Var, Start, End, Grain, Body, ReduceOp, Accumulator);
+}
+
+// for i = start, end [, step] { body }
+ExprRef Parser::parseForExpr() {
+    Symbol Var;
+    ExprRef Start, End, Step;
+    if (!parseForHeader(Var, Start, End, Step))
+        return InvalidRef;
+    if (Step != InvalidRef) {
+        // A zero step never reaches the end; reject it when it is a literal.
+        const ExprAST &S = Ctx.getExpr(Step);
+        if (S.Kind == ExprKind::Number && (S.Type == ValueType::I64 ? S.Int == 0 : S.Num == 0)) {
+            logError("loop step must not be zero.");
+            return InvalidRef;
+        }
+    }
+    ExprRef Body = parseLoopBody();
+    if (Body == InvalidRef)
+        return InvalidRef;
+    return Ctx.makeFor(Var, Start, End, Step, Body);
+}
+
+// while cond { body }
+ExprRef Parser::parseWhileExpr() {
+    getNextToken(); // Consume 'while'
+    ExprRef Cond = parseExpression();
+    if (Cond == InvalidRef)
+        return InvalidRef;
+    ExprRef Body = parseLoopBody();
+    if (Body == InvalidRef)
+        return InvalidRef;
+    return Ctx.makeWhile(Cond, Body);
+}
+
+// if cond { then } [else { else } | else if ...]
+ExprRef Parser::parseIfExpr() {
+    getNextToken(); // Consume 'if'
+    ExprRef Cond = parseExpression();
+    if (Cond == InvalidRef)
+        return InvalidRef;
+    if (getCurrentToken() != '{') {
+        logError("expected '{' after if condition.");
+        return InvalidRef;
+    }
+    ExprRef Then = parseBlockExpr();
+    if (Then == InvalidRef)
+        return InvalidRef;
+    ExprRef Else = InvalidRef;
+    if (getCurrentToken() == tok_else) {
+        getNextToken(); // Consume 'else'
+        if (getCurrentToken() == tok_if) {
+            Else = parseIfExpr();
+        } else if (getCurrentToken() == '{') {
+            Else = parseBlockExpr();
+        } else {
+            logError("expected '{' or 'if' after 'else'.");
+            return InvalidRef;
+        }
+        if (Else == InvalidRef)
+            return InvalidRef;
+    }
+    return Ctx.makeIf(Cond, Then, Else);
+}
+
+std::optional<ValueType> Parser::parseType() {
+    std::optional<ValueType> Type;
+    if (getCurrentToken() == tok_identifier)
+        Type = parseTypeName(Tokens.getText(Index));
+    if (!Type) {
+        logError("expected a type: bool, i32, i64, f32 or f64.");
+        return std::nullopt;
+    }
+    getNextToken();
+    return Type;
+}
+
+// var x [: type] [= init]
+ExprRef Parser::parseVarExpr() {
+    getNextToken(); // Consume 'var'
+    if (getCurrentToken() != tok_identifier) {
+        logError("expected variable name after 'var'.");
+        return InvalidRef;
+    }
+    Symbol Name = Ctx.intern(Tokens.getText(Index));
+    getNextToken();
+    std::optional<ValueType> Type;
+    if (getCurrentToken() == ':') {
+        getNextToken(); // Consume ':'
+        Type = parseType();
+        if (!Type)
+            return InvalidRef;
+    }
+    ExprRef Init = InvalidRef;
+    if (getCurrentToken() == '=') {
+        getNextToken(); // Consume '='
+        Init = parseExpression();
+        if (Init == InvalidRef)
+            return InvalidRef;
+    }
+    return Ctx.makeVar(Name, Init, Type);
+}
+
+ExprRef Parser::parsePrimary() {
+    switch (getCurrentToken()) {
+        case tok_identifier:
+            return parseIdentifierExpr();
+        case tok_number:
+            return parseNumberExpr();
+        case '-':
+            return parseNegationExpr();
+        case '(':
+            return parseParenExpr();
+        case '{':
+            return parseBlockExpr();
+        case tok_parallel:
+            return parseParallelForExpr();
+        case tok_for:
+            return parseForExpr();
+        case tok_while:
+            return parseWhileExpr();
+        case tok_if:
+            return parseIfExpr();
+        case tok_var:
+            return parseVarExpr();
+        default:
+            logError("unknown token when expecting an expression.");
+            return InvalidRef;
+    }
+}
+
+ExprRef Parser::parseBinOpRHS(int ExprPrec, ExprRef LHS) {
+    while (true) {
+        int TokPrec = getTokPrecedence(getCurrentToken());
+        if (TokPrec < ExprPrec)
+            return LHS;
+        int BinOp = getCurrentToken();
+        getNextToken();
+        ExprRef RHS = parsePrimary();
+        if (RHS == InvalidRef)
+            return InvalidRef;
+        int NextPrec = getTokPrecedence(getCurrentToken());
+        // Assignment is right-associative: a = b = c is a = (b = c).
+        bool RightAssoc = BinOp == '=';
+        if (TokPrec < NextPrec || (RightAssoc && TokPrec == NextPrec)) {
+            RHS = parseBinOpRHS(RightAssoc ? TokPrec : TokPrec + 1, RHS);
+            if (RHS == InvalidRef)
+                return InvalidRef;
+        }
+        LHS = Ctx.makeBinary(getBinaryOp(BinOp), LHS, RHS);
+    }
+}
+
+ExprRef Parser::parseExpression() {
+    ExprRef LHS = parsePrimary();
+    if (LHS == InvalidRef)
+        return InvalidRef;
+    return parseBinOpRHS(0, LHS);
+}
+
+ProtoRef Parser::parsePrototype() {
+    if (getCurrentToken() != tok_identifier) {
+        logError("expected function name in prototype.");
+        return InvalidRef;
+    }
+    Symbol FnName = Ctx.intern(Tokens.getText(Index));
+    getNextToken();
+    if (getCurrentToken() != '(') {
+        logError("expected '(' in prototype.");
+        return InvalidRef;
+    }
+    getNextToken(); // Consume '('
+    // Parameters are "name" or "name: type".
+    SmallVector<Symbol, 8> ArgNames;
+    SmallVector<ValueType, 8> ArgTypes;
+    while (getCurrentToken() == tok_identifier) {
+        ArgNames.push_back(Ctx.intern(Tokens.getText(Index)));
+        ArgTypes.push_back(ValueType::F64);
+        getNextToken();
+        if (getCurrentToken() == ':') {
+            getNextToken(); // Consume ':'
+            std::optional<ValueType> Type = parseType();
+            if (!Type)
+                return InvalidRef;
+            ArgTypes.back() = *Type;
+        }
+    }
+    if (getCurrentToken() != ')') {
+        logError("expected ')' in prototype.");
+        return InvalidRef;
+    }
+    getNextToken(); // Consume ')'
+    // Optional "-> type".
+    ValueType ReturnType = ValueType::F64;
+    if (getCurrentToken() == '-' && peekToken(1) == '>') {
+        getNextToken(); // Consume '-'
+        getNextToken(); // Consume '>'
+        std::optional<ValueType> Type = parseType();
+        if (!Type)
+            return InvalidRef;
+        ReturnType = *Type;
+    }
+    return Ctx.makePrototype(FnName, ArgNames, ArgTypes, ReturnType);
+}
+
+FuncRef Parser::parseDefinition() {
+    getNextToken(); // Consume 'def'
+    ProtoRef Proto = parsePrototype();
+    if (Proto == InvalidRef)
+        return InvalidRef;
+    ExprRef E = parseExpression();
+    if (E == InvalidRef)
+        return InvalidRef;
+    return Ctx.makeFunction(Proto, E);
+}
+
+ProtoRef Parser::parseExtern() {
+    getNextToken(); // Consume 'extern'
+    return parsePrototype();
+}
+
+FuncRef Parser::parseTopLevelExpr() {
+    ExprRef E = parseExpression();
+    if (E == InvalidRef)
+        return InvalidRef;
+    // Each top-level expression gets a unique name so a whole file can live in one module.
+    std::string Name = "__anon_expr." + std::to_string(AnonExprCount++);
+    ProtoRef Proto = Ctx.makePrototype(Ctx.intern(Name), {});
+    return Ctx.makeFunction(Proto, E);
+}
+
+void extraParserRoutine() {
+    for (int i = 0; i < 50; ++i) {
+        std::cout << "Extra parser iteration " << i << std::endl;
+    }
+}
+}
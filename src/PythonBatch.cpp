@@ -0,0 +1,331 @@
+#include "Nexon/PythonBatch.h"
+#include "Nexon/CompilationCache.h"
+#include "Nexon/Runtime.h"
+#include "llvm/Support/MemoryBuffer.h"
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#include <marshal.h>
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <map>
+#include <thread>
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
+
+namespace Nexon {
+using namespace llvm;
+
+namespace {
+
+struct Script {
+    std::string File;
+    // Marshalled code object; empty if the script could not be compiled.
+    std::string Code;
+};
+
+// Compiles File to a marshalled code object, or takes it from Cache. The key covers
+// the exact interpreter version, since marshal formats and bytecode change with it.
+bool compileScript(const std::string &File, std::string &Code, CompilationCache* Cache) {
+    auto Buffer = MemoryBuffer::getFile(File, /*IsText=*/false, /*RequiresNullTerminator=*/true);
+    if (!Buffer) {
+        std::cerr << "Error: Unable to open Python source file " << File << ": " << Buffer.getError().message() << "\n";
+        return false;
+    }
+    StringRef Source = (*Buffer)->getBuffer();
+    std::string Key;
+    if (Cache) {
+        Key = CompilationCache::computeKey("python", { Py_GetVersion(), File, Source });
+        CompilationCache::Entry E;
+        if (Cache->lookup(Key, E) && E.Objects.size() == 1) {
+            Code = E.Objects[0]->getBuffer().str();
+            return true;
+        }
+    }
+    PyObject* CodeObject = Py_CompileString(Source.data(), File.c_str(), Py_file_input);
+    if (!CodeObject) {
+        PyErr_Print();
+        return false;
+    }
+    PyObject* Bytes = PyMarshal_WriteObjectToString(CodeObject, Py_MARSHAL_VERSION);
+    Py_DECREF(CodeObject);
+    if (!Bytes) {
+        PyErr_Print();
+        return false;
+    }
+    Code.assign(PyBytes_AS_STRING(Bytes), PyBytes_GET_SIZE(Bytes));
+    Py_DECREF(Bytes);
+    if (Cache) {
+        std::vector<std::unique_ptr<MemoryBuffer>> Objects;
+        Objects.push_back(MemoryBuffer::getMemBuffer(Code, File, /*RequiresNullTerminator=*/false));
+        Cache->store(Key, {}, Objects);
+    }
+    return true;
+}
+
+void flushPythonStreams() {
+    for (const char* Name : { "stdout", "stderr" }) {
+        PyObject* Stream = PySys_GetObject(Name);
+        PyObject* Result = Stream && Stream != Py_None ? PyObject_CallMethod(Stream, "flush", nullptr) : nullptr;
+        if (!Result)
+            PyErr_Clear();
+        Py_XDECREF(Result);
+    }
+}
+
+// Reports the pending exception of a script. SystemExit(0) and SystemExit(None) are
+// successful exits; PyErr_Print would exit the whole process for them instead.
+bool handleScriptException() {
+    if (!PyErr_ExceptionMatches(PyExc_SystemExit)) {
+        PyErr_Print();
+        return false;
+    }
+    PyObject *Type, *Value, *Traceback;
+    PyErr_Fetch(&Type, &Value, &Traceback);
+    PyErr_NormalizeException(&Type, &Value, &Traceback);
+    PyObject* ExitCode = Value ? PyObject_GetAttrString(Value, "code") : nullptr;
+    bool Success = !ExitCode || ExitCode == Py_None || (PyLong_Check(ExitCode) && PyLong_AsLong(ExitCode) == 0);
+    PyErr_Clear();
+    Py_XDECREF(ExitCode);
+    Py_XDECREF(Type);
+    Py_XDECREF(Value);
+    Py_XDECREF(Traceback);
+    return Success;
+}
+
+#if PY_VERSION_HEX >= 0x030C0000
+// True if the pending exception is the ImportError raised for an extension module that
+// does not support sub-interpreters (check_multi_interp_extensions).
+bool isSubinterpreterImportError() {
+    if (!PyErr_ExceptionMatches(PyExc_ImportError))
+        return false;
+    PyObject *Type, *Value, *Traceback;
+    PyErr_Fetch(&Type, &Value, &Traceback);
+    PyErr_NormalizeException(&Type, &Value, &Traceback);
+    bool Match = false;
+    if (PyObject* Message = Value ? PyObject_Str(Value) : nullptr) {
+        const char* Text = PyUnicode_AsUTF8(Message);
+        Match = Text && std::strstr(Text, "subinterpreters");
+        Py_DECREF(Message);
+    }
+    PyErr_Restore(Type, Value, Traceback);
+    return Match;
+}
+#endif
+
+// Runs a script as `__main__` with fresh globals in the current interpreter. If
+// Unsupported is given, an import that fails because the script runs in a
+// sub-interpreter sets it instead of being reported.
+bool execScript(const Script &S, char* Unsupported = nullptr) {
+    bool Ok = false;
+    if (PyObject* CodeObject = PyMarshal_ReadObjectFromString(S.Code.data(), S.Code.size())) {
+        PyObject* Globals = PyDict_New();
+        PyObject* Name = PyUnicode_FromString("__main__");
+        PyObject* File = PyUnicode_DecodeFSDefault(S.File.c_str());
+        if (Globals && Name && File && PyDict_SetItemString(Globals, "__name__", Name) == 0 &&
+            PyDict_SetItemString(Globals, "__file__", File) == 0 &&
+            PyDict_SetItemString(Globals, "__builtins__", PyImport_AddModule("builtins")) == 0) {
+            PyObject* Result = PyEval_EvalCode(CodeObject, Globals, Globals);
+            Ok = Result != nullptr;
+            Py_XDECREF(Result);
+        }
+        Py_XDECREF(File);
+        Py_XDECREF(Name);
+        Py_XDECREF(Globals);
+        Py_DECREF(CodeObject);
+    }
+    if (!Ok) {
+#if PY_VERSION_HEX >= 0x030C0000
+        if (Unsupported && (*Unsupported = isSubinterpreterImportError()))
+            PyErr_Clear();
+        else
+#else
+        (void)Unsupported;
+#endif
+            Ok = handleScriptException();
+    }
+    flushPythonStreams();
+    return Ok;
+}
+
+#if PY_VERSION_HEX >= 0x030C0000
+// Runs every script in a sub-interpreter of its own, with its own GIL, on Jobs threads.
+// Creating an interpreter briefly takes the main GIL; running one does not. Scripts that
+// import an extension module without sub-interpreter support are marked in Unsupported.
+void runInSubinterpreters(const std::vector<Script> &Scripts, unsigned Jobs, std::vector<char> &Succeeded,
+                          std::vector<char> &Unsupported) {
+    PyInterpreterState* Main = PyInterpreterState_Get();
+    std::atomic<size_t> Next { 0 };
+    PyThreadState* Saved = PyEval_SaveThread();
+    std::vector<std::thread> Workers;
+    for (unsigned W = 0; W < Jobs; ++W) {
+        Workers.emplace_back([&] {
+            PyThreadState* MainState = PyThreadState_New(Main);
+            for (size_t I = Next++; I < Scripts.size(); I = Next++) {
+                if (Scripts[I].Code.empty())
+                    continue;
+                PyEval_RestoreThread(MainState);
+                PyInterpreterConfig Config = {};
+                Config.use_main_obmalloc = 0;
+                Config.allow_fork = 0;
+                Config.allow_exec = 0;
+                Config.allow_threads = 1;
+                Config.allow_daemon_threads = 0;
+                Config.check_multi_interp_extensions = 1;
+                Config.gil = PyInterpreterConfig_OWN_GIL;
+                PyThreadState* Sub = nullptr;
+                PyStatus Status = Py_NewInterpreterFromConfig(&Sub, &Config);
+                if (PyStatus_Exception(Status)) {
+                    PyEval_SaveThread();
+                    std::cerr << "Error: Unable to create a Python sub-interpreter: "
+                              << (Status.err_msg ? Status.err_msg : "unknown error") << "\n";
+                    continue;
+                }
+                // Sub is now current and holds its own GIL; the main GIL is released.
+                Succeeded[I] = execScript(Scripts[I], &Unsupported[I]);
+                Py_EndInterpreter(Sub);
+            }
+            PyEval_RestoreThread(MainState);
+            PyThreadState_Clear(MainState);
+            PyThreadState_DeleteCurrent();
+        });
+    }
+    for (auto &Worker : Workers)
+        Worker.join();
+    PyEval_RestoreThread(Saved);
+}
+#endif
+
+#ifndef _WIN32
+// Runs every script in a forked copy of this process, at most Jobs at a time.
+void runInProcesses(const std::vector<Script> &Scripts, unsigned Jobs, std::vector<char> &Succeeded) {
+    std::map<pid_t, size_t> Running;
+    size_t Next = 0;
+    while (Next < Scripts.size() || !Running.empty()) {
+        while (Next < Scripts.size() && Running.size() < Jobs) {
+            size_t I = Next++;
+            if (Scripts[I].Code.empty())
+                continue;
+            // Buffered output would otherwise be written once by every child.
+            flushPythonStreams();
+            std::cout.flush();
+            std::fflush(nullptr);
+            PyOS_BeforeFork();
+            pid_t Pid = fork();
+            if (Pid == 0) {
+                PyOS_AfterFork_Child();
+                bool Ok = execScript(Scripts[I]);
+                std::cout.flush();
+                std::fflush(nullptr);
+                _exit(Ok ? EXIT_SUCCESS : EXIT_FAILURE);
+            }
+            PyOS_AfterFork_Parent();
+            if (Pid < 0) {
+                perror("fork");
+                Succeeded[I] = execScript(Scripts[I]);
+                continue;
+            }
+            Running[Pid] = I;
+        }
+        if (Running.empty())
+            break;
+        int Status;
+        pid_t Pid = waitpid(-1, &Status, 0);
+        if (Pid < 0) {
+            if (errno == EINTR)
+                continue;
+            perror("waitpid");
+            break;
+        }
+        auto It = Running.find(Pid);
+        if (It == Running.end())
+            continue;
+        Succeeded[It->second] = WIFEXITED(Status) && WEXITSTATUS(Status) == EXIT_SUCCESS;
+        Running.erase(It);
+    }
+}
+#endif
+
+}
+
+bool PythonBatch::hasPerInterpreterGIL() {
+    return PY_VERSION_HEX >= 0x030C0000;
+}
+
+unsigned PythonBatch::run(const std::vector<std::string> &Files, unsigned Jobs, bool UseProcesses,
+                          CompilationCache* Cache) {
+    if (!Py_IsInitialized())
+        Runtime::initializePython();
+    // Each distinct script is compiled once, however often it is listed.
+    std::vector<Script> Scripts;
+    std::map<std::string, std::string> Compiled;
+    for (const auto &File : Files) {
+        auto It = Compiled.find(File);
+        if (It == Compiled.end()) {
+            std::string Code;
+            compileScript(File, Code, Cache);
+            It = Compiled.emplace(File, std::move(Code)).first;
+        }
+        Scripts.push_back({ File, It->second });
+    }
+
+    std::vector<char> Succeeded(Scripts.size(), false);
+    Jobs = std::max(1u, std::min<unsigned>(Jobs, Scripts.size()));
+    // Before 3.12 there are no per-interpreter GILs, so workers are always processes.
+    UseProcesses = UseProcesses || !hasPerInterpreterGIL();
+    if (Jobs == 1) {
+        for (size_t I = 0; I < Scripts.size(); ++I)
+            Succeeded[I] = !Scripts[I].Code.empty() && execScript(Scripts[I]);
+    } else {
+#if PY_VERSION_HEX >= 0x030C0000
+        if (!UseProcesses) {
+            std::vector<char> Unsupported(Scripts.size(), false);
+            runInSubinterpreters(Scripts, Jobs, Succeeded, Unsupported);
+            // Scripts that need a single-interpreter extension module run again from the
+            // top in processes (or one after another in this interpreter, without fork).
+            // What ran before the failing import is not undone, so the warning says so.
+            std::vector<Script> Retry(Scripts.size());
+            for (size_t I = 0; I < Scripts.size(); ++I) {
+                if (!Unsupported[I])
+                    continue;
+                std::cerr << "Warning: " << Scripts[I].File
+                          << " imports a module that does not support sub-interpreters; running it again "
+                             "outside one, so anything it did before that import happens twice. Use "
+                             "--processes to run each script once.\n";
+                Retry[I] = Scripts[I];
+            }
+#ifndef _WIN32
+            runInProcesses(Retry, Jobs, Succeeded);
+#else
+            for (size_t I = 0; I < Retry.size(); ++I)
+                if (!Retry[I].Code.empty())
+                    Succeeded[I] = execScript(Retry[I]);
+#endif
+        } else
+#endif
+        {
+#ifndef _WIN32
+            runInProcesses(Scripts, Jobs, Succeeded);
+#else
+            // Without fork, older Pythons run the batch one script after another.
+            for (size_t I = 0; I < Scripts.size(); ++I)
+                Succeeded[I] = !Scripts[I].Code.empty() && execScript(Scripts[I]);
+#endif
+        }
+    }
+
+    unsigned Failed = 0;
+    for (size_t I = 0; I < Scripts.size(); ++I) {
+        if (!Succeeded[I]) {
+            std::cerr << "Error: Python script " << Scripts[I].File << " failed." << std::endl;
+            ++Failed;
+        }
+    }
+    return Failed;
+}
+
+}
@@ -0,0 +1,232 @@
+#include "Nexon/PythonBridge.h"
+#include "Nexon/PythonModule.h"
+#include "Nexon/Runtime.h"
+#include <Python.h>
+#include <cstring>
+#include <iostream>
+
+namespace Nexon {
+
+namespace {
+
+struct ElementInfo {
+    Py_ssize_t Size;
+    // struct-module format of exported buffers.
+    const char* Format;
+    // Format characters accepted on import; int64 is 'l' or 'q' depending on the exporter.
+    const char* Accepted;
+    // __array_interface__ type string without the byte-order character.
+    const char* TypeStr;
+};
+
+const ElementInfo &getElementInfo(ElementType Type) {
+    static const ElementInfo F64 { 8, "d", "d", "f8" };
+    static const ElementInfo F32 { 4, "f", "f", "f4" };
+    static const ElementInfo I64 { 8, "q", sizeof(long) == 8 ? "lq" : "q", "i8" };
+    static const ElementInfo I32 { 4, "i", sizeof(long) == 4 ? "il" : "i", "i4" };
+    static const ElementInfo U8 { 1, "B", "B", "u1" };
+    switch (Type) {
+    case ElementType::F64: return F64;
+    case ElementType::F32: return F32;
+    case ElementType::I64: return I64;
+    case ElementType::I32: return I32;
+    case ElementType::U8: break;
+    }
+    return U8;
+}
+
+// Returns true if a buffer format string describes native elements of Info.
+bool formatMatches(const char* Format, const ElementInfo &Info) {
+    if (!Format)
+        Format = "B";
+    // Native byte order, with or without native alignment.
+    if (*Format == '@' || *Format == '=' || *Format == (PY_LITTLE_ENDIAN ? '<' : '>'))
+        ++Format;
+    return Format[0] && !Format[1] && std::strchr(Info.Accepted, Format[0]);
+}
+
+// Returns the pending Python exception as text and clears it.
+std::string takePythonError() {
+    PyObject *Type, *Value, *Traceback;
+    PyErr_Fetch(&Type, &Value, &Traceback);
+    std::string Message = "unknown Python error";
+    if (PyObject* Text = Value ? PyObject_Str(Value) : nullptr) {
+        if (const char* UTF8 = PyUnicode_AsUTF8(Text))
+            Message = UTF8;
+        Py_DECREF(Text);
+    }
+    PyErr_Clear();
+    Py_XDECREF(Type);
+    Py_XDECREF(Value);
+    Py_XDECREF(Traceback);
+    return Message;
+}
+
+// The `nexon.Array` type: memory owned by Nexon, exposed to Python.
+struct ArrayObject {
+    PyObject_HEAD
+    void* Data;
+    Py_ssize_t Count;
+    Py_ssize_t ItemSize;
+    ElementType Type;
+    bool ReadOnly;
+    // Allocated separately: Python does not run C++ constructors on object memory.
+    std::shared_ptr<void>* Owner;
+};
+
+void arrayDealloc(PyObject* Self) {
+    auto* A = reinterpret_cast<ArrayObject*>(Self);
+    delete A->Owner;
+    PyTypeObject* Type = Py_TYPE(Self);
+    Type->tp_free(Self);
+    Py_DECREF(Type);
+}
+
+int arrayGetBuffer(PyObject* Self, Py_buffer* View, int Flags) {
+    auto* A = reinterpret_cast<ArrayObject*>(Self);
+    if ((Flags & PyBUF_WRITABLE) && A->ReadOnly) {
+        PyErr_SetString(PyExc_BufferError, "nexon.Array is read-only");
+        View->obj = nullptr;
+        return -1;
+    }
+    View->buf = A->Data;
+    View->obj = Self;
+    Py_INCREF(Self);
+    View->len = A->Count * A->ItemSize;
+    View->itemsize = A->ItemSize;
+    View->readonly = A->ReadOnly;
+    View->ndim = 1;
+    View->format = (Flags & PyBUF_FORMAT) ? const_cast<char*>(getElementInfo(A->Type).Format) : nullptr;
+    View->shape = (Flags & PyBUF_ND) ? &A->Count : nullptr;
+    View->strides = ((Flags & PyBUF_STRIDES) == PyBUF_STRIDES) ? &A->ItemSize : nullptr;
+    View->suboffsets = nullptr;
+    View->internal = nullptr;
+    return 0;
+}
+
+Py_ssize_t arrayLength(PyObject* Self) {
+    return reinterpret_cast<ArrayObject*>(Self)->Count;
+}
+
+PyObject* arrayInterface(PyObject* Self, void*) {
+    auto* A = reinterpret_cast<ArrayObject*>(Self);
+    std::string TypeStr = (A->ItemSize == 1 ? "|" : PY_LITTLE_ENDIAN ? "<" : ">");
+    TypeStr += getElementInfo(A->Type).TypeStr;
+    return Py_BuildValue("{s:(n),s:s,s:(N,O),s:i}", "shape", A->Count, "typestr", TypeStr.c_str(),
+                         "data", PyLong_FromVoidPtr(A->Data), A->ReadOnly ? Py_True : Py_False,
+                         "version", 3);
+}
+
+PyGetSetDef ArrayGetSet[] = {
+    { "__array_interface__", arrayInterface, nullptr, "NumPy array interface (version 3).", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+PyType_Slot ArraySlots[] = {
+    { Py_tp_dealloc, reinterpret_cast<void*>(arrayDealloc) },
+    { Py_tp_getset, ArrayGetSet },
+    { Py_tp_doc, const_cast<char*>("Memory owned by Nexon, shared with Python without copying.") },
+    { Py_bf_getbuffer, reinterpret_cast<void*>(arrayGetBuffer) },
+    { Py_sq_length, reinterpret_cast<void*>(arrayLength) },
+    { 0, nullptr }
+};
+
+PyType_Spec ArraySpec = {
+    "nexon.Array", sizeof(ArrayObject), 0, Py_TPFLAGS_DEFAULT, ArraySlots
+};
+
+}
+
+PyObject* PythonBridge::createArrayType(PyObject* Module) {
+    return PyType_FromModuleAndSpec(Module, &ArraySpec, nullptr);
+}
+
+PyObject* PythonBridge::getArrayType() {
+    // The type lives in the state of this interpreter's nexon module, so each
+    // sub-interpreter has its own. sys.modules keeps the module, and so the type, alive.
+    PyObject* Module = PyImport_ImportModule("nexon");
+    if (!Module)
+        return nullptr;
+    PyObject* Type = PythonModule::getArrayType(Module);
+    Py_DECREF(Module);
+    return Type;
+}
+
+PyObject* PythonBridge::exportBuffer(void* Data, size_t Count, ElementType Type,
+                                     std::shared_ptr<void> Owner, bool ReadOnly) {
+    if (!Py_IsInitialized())
+        Runtime::initializePython();
+    PyObject* ArrayType = getArrayType();
+    if (!ArrayType) {
+        std::cerr << "Error: Unable to create nexon.Array type: " << takePythonError() << "\n";
+        return nullptr;
+    }
+    // The new instance holds a reference to its (heap) type, released in arrayDealloc.
+    auto* A = PyObject_New(ArrayObject, reinterpret_cast<PyTypeObject*>(ArrayType));
+    if (!A) {
+        std::cerr << "Error: Unable to export array: " << takePythonError() << "\n";
+        return nullptr;
+    }
+    A->Data = Data;
+    A->Count = static_cast<Py_ssize_t>(Count);
+    A->ItemSize = getElementInfo(Type).Size;
+    A->Type = Type;
+    A->ReadOnly = ReadOnly;
+    A->Owner = new std::shared_ptr<void>(std::move(Owner));
+    return reinterpret_cast<PyObject*>(A);
+}
+
+bool PythonBridge::importBuffer(PyObject* Obj, ElementType Type, void* &Data, size_t &Count,
+                                std::shared_ptr<void> &Owner) {
+    auto View = std::make_unique<Py_buffer>();
+    if (PyObject_GetBuffer(Obj, View.get(), PyBUF_FORMAT | PyBUF_C_CONTIGUOUS | PyBUF_WRITABLE) != 0) {
+        std::cerr << "Error: Unable to import Python buffer: " << takePythonError() << "\n";
+        return false;
+    }
+    const ElementInfo &Info = getElementInfo(Type);
+    if (View->itemsize != Info.Size || !formatMatches(View->format, Info)) {
+        std::cerr << "Error: Unable to import Python buffer: element format '"
+                  << (View->format ? View->format : "B") << "' does not match '" << Info.Format << "'.\n";
+        PyBuffer_Release(View.get());
+        return false;
+    }
+    Data = View->buf;
+    Count = static_cast<size_t>(View->len / View->itemsize);
+    Owner = std::shared_ptr<void>(View.release(), [](void* P) {
+        auto* V = static_cast<Py_buffer*>(P);
+        // The owner may be released on any thread, or after the interpreter is gone.
+        if (Py_IsInitialized()) {
+            PyGILState_STATE State = PyGILState_Ensure();
+            PyBuffer_Release(V);
+            PyGILState_Release(State);
+        }
+        delete V;
+    });
+    return true;
+}
+
+bool PythonBridge::setGlobal(const std::string &Name, PyObject* Obj) {
+    if (!Obj)
+        return false;
+    if (!Py_IsInitialized())
+        Runtime::initializePython();
+    PyObject* Globals = PyModule_GetDict(PyImport_AddModule("__main__"));
+    int Result = PyDict_SetItemString(Globals, Name.c_str(), Obj);
+    Py_DECREF(Obj);
+    if (Result != 0) {
+        std::cerr << "Error: Unable to bind Python global " << Name << ": " << takePythonError() << "\n";
+        return false;
+    }
+    return true;
+}
+
+PyObject* PythonBridge::getGlobal(const std::string &Name) {
+    if (!Py_IsInitialized())
+        return nullptr;
+    PyObject* Globals = PyModule_GetDict(PyImport_AddModule("__main__"));
+    PyObject* Value = PyDict_GetItemString(Globals, Name.c_str());
+    Py_XINCREF(Value);
+    return Value;
+}
+
+}
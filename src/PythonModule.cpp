@@ -0,0 +1,376 @@
+#include "Nexon/PythonModule.h"
+#include "Nexon/AST.h"
+#include "Nexon/CodeGen.h"
+#include "Nexon/JIT.h"
+#include "Nexon/ObjectEmitter.h"
+#include "Nexon/Optimizer.h"
+#include "Nexon/Parser.h"
+#include "Nexon/PythonBridge.h"
+#include "Nexon/TokenBuffer.h"
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+#ifdef HAVE_NUMPY
+#define NPY_NO_DEPRECATED_API NPY_1_7_API_VERSION
+#include <numpy/ndarraytypes.h>
+#include <numpy/ufuncobject.h>
+#endif
+#include <vector>
+
+namespace Nexon {
+using namespace llvm;
+
+namespace {
+
+// A Nexon function compiled for Python, with the wrappers generated for it. The JIT
+// that owns the code lives as long as the function or any ufunc made from it.
+struct CompiledFunction {
+    std::shared_ptr<JIT> Engine;
+    std::string Name;
+    size_t NumArgs;
+    // double Name(Args[0], ..., Args[NumArgs - 1])
+    double (*Call)(const double* Args);
+    // A NumPy ufunc inner loop: void(char **Args, intptr_t *Dims, intptr_t *Steps, void *Data).
+    void* Loop;
+};
+
+// Emits `double Name(double *Args)`, which unpacks Args and calls F, converting the
+// arguments and result from and to double.
+Function* emitCallWrapper(CompilationSession &S, Function* F) {
+    LLVMContext &Ctx = S.getContext();
+    IRBuilder<> &Builder = S.getBuilder();
+    Type* DoubleTy = Type::getDoubleTy(Ctx);
+    auto* WrapperTy = FunctionType::get(DoubleTy, { Type::getDoublePtrTy(Ctx) }, false);
+    Function* W = Function::Create(WrapperTy, Function::ExternalLinkage, "__nexon_pycall." + F->getName(),
+                                   S.getModule());
+    Builder.SetInsertPoint(BasicBlock::Create(Ctx, "entry", W));
+    std::vector<Value*> Args;
+    for (unsigned I = 0; I < F->arg_size(); ++I) {
+        Value* Arg = Builder.CreateLoad(DoubleTy, Builder.CreateConstInBoundsGEP1_64(DoubleTy, W->getArg(0), I));
+        Args.push_back(S.createConversion(Arg, F->getArg(I)->getType()));
+    }
+    Builder.CreateRet(S.createConversion(Builder.CreateCall(F, Args), DoubleTy));
+    return W;
+}
+
+// Emits the ufunc inner loop of F: for each of Dims[0] elements, loads one double from
+// every input array (advancing by its stride in Steps), calls F and stores the result.
+Function* emitUfuncLoop(CompilationSession &S, Function* F) {
+    LLVMContext &Ctx = S.getContext();
+    IRBuilder<> &Builder = S.getBuilder();
+    Type* DoubleTy = Type::getDoubleTy(Ctx);
+    Type* BytePtrTy = Type::getInt8PtrTy(Ctx);
+    Type* IntPtrTy = S.getModule().getDataLayout().getIntPtrType(Ctx);
+    auto* LoopTy = FunctionType::get(Type::getVoidTy(Ctx),
+        { BytePtrTy->getPointerTo(), IntPtrTy->getPointerTo(), IntPtrTy->getPointerTo(), BytePtrTy }, false);
+    Function* L = Function::Create(LoopTy, Function::ExternalLinkage, "__nexon_ufunc." + F->getName(),
+                                   S.getModule());
+    BasicBlock* Entry = BasicBlock::Create(Ctx, "entry", L);
+    BasicBlock* Body = BasicBlock::Create(Ctx, "loop", L);
+    BasicBlock* Exit = BasicBlock::Create(Ctx, "exit", L);
+
+    // Operand K is input K, or the output for K == NumArgs.
+    unsigned NumOperands = F->arg_size() + 1;
+    Builder.SetInsertPoint(Entry);
+    Value* Count = Builder.CreateLoad(IntPtrTy, L->getArg(1));
+    std::vector<Value*> Bases, Strides;
+    for (unsigned K = 0; K < NumOperands; ++K) {
+        Bases.push_back(Builder.CreateLoad(BytePtrTy, Builder.CreateConstInBoundsGEP1_64(BytePtrTy, L->getArg(0), K)));
+        Strides.push_back(Builder.CreateLoad(IntPtrTy, Builder.CreateConstInBoundsGEP1_64(IntPtrTy, L->getArg(2), K)));
+    }
+    Builder.CreateCondBr(Builder.CreateICmpSGT(Count, ConstantInt::get(IntPtrTy, 0)), Body, Exit);
+
+    Builder.SetInsertPoint(Body);
+    PHINode* Index = Builder.CreatePHI(IntPtrTy, 2);
+    Index->addIncoming(ConstantInt::get(IntPtrTy, 0), Entry);
+    auto ElementPtr = [&](unsigned K) {
+        Value* Byte = Builder.CreateInBoundsGEP(Builder.getInt8Ty(), Bases[K], Builder.CreateMul(Index, Strides[K]));
+        return Builder.CreateBitCast(Byte, Type::getDoublePtrTy(Ctx));
+    };
+    std::vector<Value*> Args;
+    for (unsigned K = 0; K + 1 < NumOperands; ++K)
+        Args.push_back(S.createConversion(Builder.CreateLoad(DoubleTy, ElementPtr(K)), F->getArg(K)->getType()));
+    Builder.CreateStore(S.createConversion(Builder.CreateCall(F, Args), DoubleTy), ElementPtr(NumOperands - 1));
+    Value* Next = Builder.CreateAdd(Index, ConstantInt::get(IntPtrTy, 1));
+    Index->addIncoming(Next, Body);
+    Builder.CreateCondBr(Builder.CreateICmpSLT(Next, Count), Body, Exit);
+
+    Builder.SetInsertPoint(Exit);
+    Builder.CreateRetVoid();
+    return L;
+}
+
+// Compiles the definitions and externs of Source and returns the function called
+// Name, or the last definition if Name is empty. Sets a Python error on failure;
+// parse and code generation diagnostics go to stderr as usual.
+std::shared_ptr<CompiledFunction> compileFunction(std::string_view Source, std::string Name) {
+    TokenBuffer Tokens;
+    if (!Tokens.tokenize(Source)) {
+        PyErr_SetString(PyExc_SyntaxError, "invalid Nexon source");
+        return nullptr;
+    }
+    std::shared_ptr<JIT> Engine = JIT::create();
+    if (!Engine) {
+        PyErr_SetString(PyExc_RuntimeError, "unable to create a JIT");
+        return nullptr;
+    }
+    CompilationSession Session;
+    ObjectEmitter::configureModule(Session.getModule(), Engine->getTargetMachine());
+    ASTContext Ctx;
+    Parser P(Tokens, Ctx);
+    std::string LastDefinition;
+    for (int Tok = P.getCurrentToken(); Tok != tok_eof; Tok = P.getCurrentToken()) {
+        if (Tok == ';') {
+            P.getNextToken();
+        } else if (Tok == tok_def) {
+            FuncRef F = P.parseDefinition();
+            if (F == InvalidRef || !Ctx.getFunction(F).codegen(Ctx, Session)) {
+                PyErr_SetString(PyExc_SyntaxError, "invalid Nexon definition");
+                return nullptr;
+            }
+            LastDefinition = std::string(Ctx.getFunctionName(F));
+        } else if (Tok == tok_extern) {
+            ProtoRef Proto = P.parseExtern();
+            if (Proto == InvalidRef || !Ctx.getProto(Proto).codegen(Ctx, Session)) {
+                PyErr_SetString(PyExc_SyntaxError, "invalid Nexon extern");
+                return nullptr;
+            }
+            Session.addPrototype(Ctx.getProto(Proto).getSignature(Ctx));
+        } else {
+            PyErr_SetString(PyExc_SyntaxError, "nexon.compile accepts only def and extern");
+            return nullptr;
+        }
+    }
+    if (Name.empty())
+        Name = LastDefinition;
+    Function* F = Name.empty() ? nullptr : Session.getModule().getFunction(Name);
+    if (!F || F->isDeclaration()) {
+        PyErr_Format(PyExc_NameError, "no Nexon function '%s' is defined", Name.c_str());
+        return nullptr;
+    }
+
+    auto Result = std::make_shared<CompiledFunction>();
+    Result->Engine = Engine;
+    Result->Name = Name;
+    Result->NumArgs = F->arg_size();
+    std::string CallName = emitCallWrapper(Session, F)->getName().str();
+    std::string LoopName = emitUfuncLoop(Session, F)->getName().str();
+    if (!Optimizer::runOptimizationPasses(Session.getModule(), Engine->getTargetMachine()) ||
+        !Engine->addModule(Session.takeModule())) {
+        PyErr_SetString(PyExc_RuntimeError, "unable to compile Nexon source");
+        return nullptr;
+    }
+    Result->Call = reinterpret_cast<double (*)(const double*)>(Engine->lookup(CallName));
+    Result->Loop = Engine->lookup(LoopName);
+    if (!Result->Call || !Result->Loop) {
+        PyErr_SetString(PyExc_RuntimeError, "unable to compile Nexon source");
+        return nullptr;
+    }
+    return Result;
+}
+
+// The `nexon.Function` type: a compiled Nexon function callable from Python.
+struct FunctionObject {
+    PyObject_HEAD
+    // Allocated separately: Python does not run C++ constructors on object memory.
+    std::shared_ptr<CompiledFunction>* Compiled;
+};
+
+CompiledFunction &getCompiled(PyObject* Self) {
+    return **reinterpret_cast<FunctionObject*>(Self)->Compiled;
+}
+
+void functionDealloc(PyObject* Self) {
+    delete reinterpret_cast<FunctionObject*>(Self)->Compiled;
+    PyTypeObject* Type = Py_TYPE(Self);
+    Type->tp_free(Self);
+    Py_DECREF(Type);
+}
+
+PyObject* functionCall(PyObject* Self, PyObject* Args, PyObject* Kwargs) {
+    CompiledFunction &F = getCompiled(Self);
+    if (Kwargs && PyDict_GET_SIZE(Kwargs) != 0) {
+        PyErr_Format(PyExc_TypeError, "%s() takes no keyword arguments", F.Name.c_str());
+        return nullptr;
+    }
+    Py_ssize_t NumArgs = PyTuple_GET_SIZE(Args);
+    if (static_cast<size_t>(NumArgs) != F.NumArgs) {
+        PyErr_Format(PyExc_TypeError, "%s() takes %zu arguments (%zd given)", F.Name.c_str(), F.NumArgs, NumArgs);
+        return nullptr;
+    }
+    std::vector<double> Values(F.NumArgs);
+    for (Py_ssize_t I = 0; I < NumArgs; ++I) {
+        Values[I] = PyFloat_AsDouble(PyTuple_GET_ITEM(Args, I));
+        if (Values[I] == -1.0 && PyErr_Occurred())
+            return nullptr;
+    }
+    return PyFloat_FromDouble(F.Call(Values.data()));
+}
+
+PyObject* functionName(PyObject* Self, void*) {
+    return PyUnicode_FromString(getCompiled(Self).Name.c_str());
+}
+
+PyObject* functionNumArgs(PyObject* Self, void*) {
+    return PyLong_FromSize_t(getCompiled(Self).NumArgs);
+}
+
+#ifdef HAVE_NUMPY
+// Everything a ufunc needs from its function; NumPy keeps the pointers, not copies.
+struct UfuncData {
+    std::shared_ptr<CompiledFunction> Compiled;
+    PyUFuncGenericFunction Loops[1];
+    void* Data[1] = { nullptr };
+    std::vector<char> Types;
+};
+
+// Returns a new NumPy ufunc whose only loop (all float64) is the compiled inner loop.
+PyObject* functionUfunc(PyObject* Self, void*) {
+    // NumPy is imported on first use, so `import nexon` does not require it.
+    static bool UmathImported = false;
+    if (!UmathImported) {
+        if (_import_umath() < 0)
+            return nullptr;
+        UmathImported = true;
+    }
+    auto* U = new UfuncData;
+    U->Compiled = *reinterpret_cast<FunctionObject*>(Self)->Compiled;
+    U->Loops[0] = reinterpret_cast<PyUFuncGenericFunction>(U->Compiled->Loop);
+    U->Types.assign(U->Compiled->NumArgs + 1, NPY_DOUBLE);
+    PyObject* Owner = PyCapsule_New(U, nullptr, [](PyObject* Capsule) {
+        delete static_cast<UfuncData*>(PyCapsule_GetPointer(Capsule, nullptr));
+    });
+    if (!Owner) {
+        delete U;
+        return nullptr;
+    }
+    PyObject* Ufunc = PyUFunc_FromFuncAndData(U->Loops, U->Data, U->Types.data(), 1,
+                                              static_cast<int>(U->Compiled->NumArgs), 1, PyUFunc_None,
+                                              U->Compiled->Name.c_str(), "Compiled Nexon function.", 0);
+    if (!Ufunc) {
+        Py_DECREF(Owner);
+        return nullptr;
+    }
+    // The ufunc releases `obj` when it is destroyed.
+    reinterpret_cast<PyUFuncObject*>(Ufunc)->obj = Owner;
+    return Ufunc;
+}
+#else
+PyObject* functionUfunc(PyObject*, void*) {
+    PyErr_SetString(PyExc_NotImplementedError, "nexon was built without NumPy support");
+    return nullptr;
+}
+#endif
+
+PyGetSetDef FunctionGetSet[] = {
+    { "name", functionName, nullptr, "Name of the Nexon function.", nullptr },
+    { "nargs", functionNumArgs, nullptr, "Number of arguments.", nullptr },
+    { "ufunc", functionUfunc, nullptr, "A new NumPy ufunc applying the function element-wise.", nullptr },
+    { nullptr, nullptr, nullptr, nullptr, nullptr }
+};
+
+PyType_Slot FunctionSlots[] = {
+    { Py_tp_dealloc, reinterpret_cast<void*>(functionDealloc) },
+    { Py_tp_call, reinterpret_cast<void*>(functionCall) },
+    { Py_tp_getset, FunctionGetSet },
+    { Py_tp_doc, const_cast<char*>("A Nexon function compiled to native code.") },
+    { 0, nullptr }
+};
+
+PyType_Spec FunctionSpec = {
+    "nexon.Function", sizeof(FunctionObject), 0, Py_TPFLAGS_DEFAULT, FunctionSlots
+};
+
+// Per-module state. Every interpreter that imports nexon gets its own module and its
+// own heap types, so the module can be imported by sub-interpreters with their own GIL.
+struct ModuleState {
+    PyObject* FunctionType;
+    PyObject* ArrayType;
+};
+
+ModuleState &getState(PyObject* Module) {
+    return *static_cast<ModuleState*>(PyModule_GetState(Module));
+}
+
+// nexon.compile(source, name=None): the function called name, or the last definition.
+PyObject* moduleCompile(PyObject* Module, PyObject* Args, PyObject* Kwargs) {
+    static const char* Keywords[] = { "source", "name", nullptr };
+    const char* Source;
+    Py_ssize_t SourceSize;
+    const char* Name = nullptr;
+    if (!PyArg_ParseTupleAndKeywords(Args, Kwargs, "s#|z", const_cast<char**>(Keywords), &Source, &SourceSize, &Name))
+        return nullptr;
+    auto Compiled = compileFunction(std::string_view(Source, SourceSize), Name ? Name : "");
+    if (!Compiled)
+        return nullptr;
+    auto* FunctionType = reinterpret_cast<PyTypeObject*>(getState(Module).FunctionType);
+    auto* F = PyObject_New(FunctionObject, FunctionType);
+    if (!F)
+        return nullptr;
+    F->Compiled = new std::shared_ptr<CompiledFunction>(std::move(Compiled));
+    return reinterpret_cast<PyObject*>(F);
+}
+
+PyMethodDef ModuleMethods[] = {
+    { "compile", reinterpret_cast<PyCFunction>(reinterpret_cast<void (*)()>(moduleCompile)),
+      METH_VARARGS | METH_KEYWORDS,
+      "compile(source, name=None)\n\nCompiles the def and extern statements of a Nexon source and returns "
+      "the function called name (default: the last def) as a native callable." },
+    { nullptr, nullptr, 0, nullptr }
+};
+
+int moduleExec(PyObject* Module) {
+    ModuleState &State = getState(Module);
+    State.FunctionType = PyType_FromModuleAndSpec(Module, &FunctionSpec, nullptr);
+    State.ArrayType = PythonBridge::createArrayType(Module);
+    if (!State.FunctionType || !State.ArrayType || PyModule_AddObjectRef(Module, "Function", State.FunctionType) < 0 ||
+        PyModule_AddObjectRef(Module, "Array", State.ArrayType) < 0)
+        return -1;
+    return 0;
+}
+
+int moduleTraverse(PyObject* Module, visitproc visit, void* arg) {
+    // Py_VISIT expects the parameters to be called visit and arg.
+    Py_VISIT(getState(Module).FunctionType);
+    Py_VISIT(getState(Module).ArrayType);
+    return 0;
+}
+
+int moduleClear(PyObject* Module) {
+    Py_CLEAR(getState(Module).FunctionType);
+    Py_CLEAR(getState(Module).ArrayType);
+    return 0;
+}
+
+void moduleFree(void* Module) {
+    moduleClear(static_cast<PyObject*>(Module));
+}
+
+PyModuleDef_Slot ModuleSlots[] = {
+    { Py_mod_exec, reinterpret_cast<void*>(moduleExec) },
+#if PY_VERSION_HEX >= 0x030C0000
+    { Py_mod_multiple_interpreters, Py_MOD_PER_INTERPRETER_GIL_SUPPORTED },
+#endif
+    { 0, nullptr }
+};
+
+// Multi-phase initialization: the module is created and executed once per interpreter.
+PyModuleDef ModuleDef = {
+    PyModuleDef_HEAD_INIT, "nexon", "Compile Nexon functions to native code.", sizeof(ModuleState),
+    ModuleMethods, ModuleSlots, moduleTraverse, moduleClear, moduleFree
+};
+
+PyObject* initModule() {
+    return PyModuleDef_Init(&ModuleDef);
+}
+
+}
+
+void PythonModule::registerModule() {
+    PyImport_AppendInittab("nexon", initModule);
+}
+
+PyObject* PythonModule::getArrayType(PyObject* Module) {
+    return getState(Module).ArrayType;
+}
+
+}
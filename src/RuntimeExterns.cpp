@@ -0,0 +1,16 @@
+#include "Nexon/RuntimeLibrary.h"
+
+// The runtime under the names Nexon code declares with `extern`, for executables
+// built by `nexon compile`. The JIT maps these names through RuntimeLibrary::getSymbols
+// instead, so this file is only linked when a program references one of them.
+extern "C" {
+
+double chanNew(double capacity) { return nexon_chan_new(capacity); }
+double chanSend(double ch, double value) { return nexon_chan_send(ch, value); }
+double chanRecv(double ch) { return nexon_chan_recv(ch); }
+double chanTrySend(double ch, double value) { return nexon_chan_try_send(ch, value); }
+double chanTryRecv(double ch) { return nexon_chan_try_recv(ch); }
+double chanClose(double ch) { return nexon_chan_close(ch); }
+double chanLen(double ch) { return nexon_chan_len(ch); }
+
+}
@@ -0,0 +1,194 @@
+#include "Nexon/RuntimeLibrary.h"
+#include "Nexon/Channel.h"
+#include "Nexon/Concurrency.h"
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <iostream>
+#include <limits>
+#include <mutex>
+#include <type_traits>
+
+namespace Nexon {
+
+namespace {
+
+// Channels live until the process exits; their handles are 1-based slots, so a
+// handle is checked with one atomic load.
+constexpr size_t MaxChannels = 4096;
+std::atomic<Channel<double>*> Channels[MaxChannels];
+std::atomic<size_t> NumChannels { 0 };
+
+Channel<double>* getChannel(double Handle) {
+    size_t Count = NumChannels.load(std::memory_order_acquire);
+    if (!(Handle >= 1 && Handle <= static_cast<double>(Count)) || Handle != std::floor(Handle)) {
+        std::cerr << "Error: Invalid channel handle " << Handle << ".\n";
+        return nullptr;
+    }
+    return Channels[static_cast<size_t>(Handle) - 1].load(std::memory_order_acquire);
+}
+
+constexpr double NaN = std::numeric_limits<double>::quiet_NaN();
+
+size_t getGrain(int64_t grain) {
+    return grain > 0 ? static_cast<size_t>(grain) : 0;
+}
+
+// The reduction behind the typed nexon_rt_parallel_reduce entry points. Integer sums
+// and products wrap around, as they do in the generated chunk loops.
+template<typename T>
+T reduceChunks(T (*body)(void*, int64_t, int64_t), void* context, int64_t begin, int64_t end, int64_t grain,
+               int32_t op) {
+    using Wrapped = std::conditional_t<std::is_integral_v<T>, std::make_unsigned<T>, std::common_type<T>>;
+    using U = typename Wrapped::type;
+    T identity;
+    T (*combine)(T, T);
+    switch (op) {
+        case '+':
+            identity = 0;
+            combine = [](T a, T b) { return static_cast<T>(static_cast<U>(a) + static_cast<U>(b)); };
+            break;
+        case '*':
+            identity = 1;
+            combine = [](T a, T b) { return static_cast<T>(static_cast<U>(a) * static_cast<U>(b)); };
+            break;
+        case '<':
+            if constexpr (std::is_integral_v<T>) {
+                identity = std::numeric_limits<T>::max();
+                combine = [](T a, T b) { return std::min(a, b); };
+            } else {
+                identity = std::numeric_limits<T>::infinity();
+                combine = [](T a, T b) { return std::fmin(a, b); };
+            }
+            break;
+        case '>':
+            if constexpr (std::is_integral_v<T>) {
+                identity = std::numeric_limits<T>::min();
+                combine = [](T a, T b) { return std::max(a, b); };
+            } else {
+                identity = -std::numeric_limits<T>::infinity();
+                combine = [](T a, T b) { return std::fmax(a, b); };
+            }
+            break;
+        default:
+            std::cerr << "Error: Unknown reduction operator " << op << ".\n";
+            // NaN, or 0 for the integer types.
+            return std::numeric_limits<T>::quiet_NaN();
+    }
+    if (begin >= end)
+        return identity;
+    size_t count = static_cast<size_t>(end - begin);
+    // The default block size depends only on the count, which keeps results
+    // reproducible, and gives at least 64 blocks (or one per index) so that short loops
+    // with expensive bodies still spread over the pool.
+    size_t blockSize = getGrain(grain);
+    if (blockSize == 0)
+        blockSize = std::clamp<size_t>(count / 64, 1, size_t(1) << 14);
+    return Concurrency::parallelReduce(size_t(0), count, identity, [&](size_t chunkBegin, size_t chunkEnd) {
+        return body(context, begin + static_cast<int64_t>(chunkBegin), begin + static_cast<int64_t>(chunkEnd));
+    }, combine, ReductionOrder::Deterministic, blockSize);
+}
+
+}
+
+llvm::ArrayRef<RuntimeLibrary::Symbol> RuntimeLibrary::getSymbols() {
+    static const Symbol Symbols[] = {
+        { "chanNew", reinterpret_cast<void*>(&nexon_chan_new) },
+        { "chanSend", reinterpret_cast<void*>(&nexon_chan_send) },
+        { "chanRecv", reinterpret_cast<void*>(&nexon_chan_recv) },
+        { "chanTrySend", reinterpret_cast<void*>(&nexon_chan_try_send) },
+        { "chanTryRecv", reinterpret_cast<void*>(&nexon_chan_try_recv) },
+        { "chanClose", reinterpret_cast<void*>(&nexon_chan_close) },
+        { "chanLen", reinterpret_cast<void*>(&nexon_chan_len) },
+        { "nexon_rt_parallel_for", reinterpret_cast<void*>(&nexon_rt_parallel_for) },
+        { "nexon_rt_parallel_reduce_f64", reinterpret_cast<void*>(&nexon_rt_parallel_reduce_f64) },
+        { "nexon_rt_parallel_reduce_f32", reinterpret_cast<void*>(&nexon_rt_parallel_reduce_f32) },
+        { "nexon_rt_parallel_reduce_i64", reinterpret_cast<void*>(&nexon_rt_parallel_reduce_i64) },
+        { "nexon_rt_parallel_reduce_i32", reinterpret_cast<void*>(&nexon_rt_parallel_reduce_i32) },
+    };
+    return Symbols;
+}
+
+}
+
+using namespace Nexon;
+
+double nexon_chan_new(double capacity) {
+    static std::mutex CreateMutex;
+    std::lock_guard<std::mutex> Lock(CreateMutex);
+    size_t Index = NumChannels.load(std::memory_order_relaxed);
+    if (Index == MaxChannels) {
+        std::cerr << "Error: Too many channels (at most " << MaxChannels << ").\n";
+        return NaN;
+    }
+    size_t Size = capacity >= 1 && capacity <= 1e9 ? static_cast<size_t>(capacity) : 1;
+    Channels[Index].store(new Channel<double>(Size), std::memory_order_release);
+    NumChannels.store(Index + 1, std::memory_order_release);
+    return static_cast<double>(Index + 1);
+}
+
+double nexon_chan_send(double channel, double value) {
+    Channel<double>* Ch = getChannel(channel);
+    return Ch && Ch->send(value) ? 1 : 0;
+}
+
+double nexon_chan_recv(double channel) {
+    Channel<double>* Ch = getChannel(channel);
+    double Value;
+    return Ch && Ch->receive(Value) ? Value : NaN;
+}
+
+double nexon_chan_try_send(double channel, double value) {
+    Channel<double>* Ch = getChannel(channel);
+    return Ch && Ch->trySend(value) ? 1 : 0;
+}
+
+double nexon_chan_try_recv(double channel) {
+    Channel<double>* Ch = getChannel(channel);
+    double Value;
+    return Ch && Ch->tryReceive(Value) ? Value : NaN;
+}
+
+double nexon_chan_close(double channel) {
+    Channel<double>* Ch = getChannel(channel);
+    if (!Ch)
+        return 0;
+    Ch->close();
+    return 1;
+}
+
+double nexon_chan_len(double channel) {
+    Channel<double>* Ch = getChannel(channel);
+    return Ch ? static_cast<double>(Ch->size()) : 0;
+}
+
+void nexon_rt_parallel_for(void (*body)(void*, int64_t, int64_t), void* context, int64_t begin, int64_t end,
+                           int64_t grain) {
+    if (begin >= end)
+        return;
+    // Indices are offsets from begin so that negative ranges work.
+    size_t count = static_cast<size_t>(end - begin);
+    Concurrency::parallelFor(0, count, [&](size_t chunkBegin, size_t chunkEnd) {
+        body(context, begin + static_cast<int64_t>(chunkBegin), begin + static_cast<int64_t>(chunkEnd));
+    }, getGrain(grain));
+}
+
+float nexon_rt_parallel_reduce_f32(float (*body)(void*, int64_t, int64_t), void* context, int64_t begin,
+                                   int64_t end, int64_t grain, int32_t op) {
+    return reduceChunks(body, context, begin, end, grain, op);
+}
+
+double nexon_rt_parallel_reduce_f64(double (*body)(void*, int64_t, int64_t), void* context, int64_t begin,
+                                    int64_t end, int64_t grain, int32_t op) {
+    return reduceChunks(body, context, begin, end, grain, op);
+}
+
+int32_t nexon_rt_parallel_reduce_i32(int32_t (*body)(void*, int64_t, int64_t), void* context, int64_t begin,
+                                     int64_t end, int64_t grain, int32_t op) {
+    return reduceChunks(body, context, begin, end, grain, op);
+}
+
+int64_t nexon_rt_parallel_reduce_i64(int64_t (*body)(void*, int64_t, int64_t), void* context, int64_t begin,
+                                     int64_t end, int64_t grain, int32_t op) {
+    return reduceChunks(body, context, begin, end, grain, op);
+}
@@ -0,0 +1,332 @@
+#include "Nexon/Server.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#ifndef _WIN32
+#include <cerrno>
+#include <csignal>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+
+extern char **environ;
+#endif
+
+namespace Nexon {
+
+#ifndef _WIN32
+
+// A request is a 4-byte length followed by length-prefixed strings: the magic, the
+// working directory, the argument count, the arguments and the environment. The
+// client's stdin, stdout and stderr travel with the first byte. The reply is the
+// 4-byte exit code.
+static const char RequestMagic[] = "NEXON-REQUEST-1";
+static constexpr uint32_t MaxRequestSize = 16u << 20;
+
+static volatile sig_atomic_t StopRequested = 0;
+
+static void requestStop(int) {
+    StopRequested = 1;
+}
+
+static bool writeAll(int FD, const void* Data, size_t Size) {
+    const char* P = static_cast<const char*>(Data);
+    while (Size > 0) {
+        ssize_t N = write(FD, P, Size);
+        if (N < 0 && errno == EINTR)
+            continue;
+        if (N <= 0)
+            return false;
+        P += N;
+        Size -= static_cast<size_t>(N);
+    }
+    return true;
+}
+
+static bool readAll(int FD, void* Data, size_t Size) {
+    char* P = static_cast<char*>(Data);
+    while (Size > 0) {
+        ssize_t N = read(FD, P, Size);
+        if (N < 0 && errno == EINTR)
+            continue;
+        if (N <= 0)
+            return false;
+        P += N;
+        Size -= static_cast<size_t>(N);
+    }
+    return true;
+}
+
+static bool makeAddress(const std::string &SocketPath, sockaddr_un &Addr) {
+    std::memset(&Addr, 0, sizeof(Addr));
+    Addr.sun_family = AF_UNIX;
+    if (SocketPath.size() >= sizeof(Addr.sun_path))
+        return false;
+    std::memcpy(Addr.sun_path, SocketPath.c_str(), SocketPath.size() + 1);
+    return true;
+}
+
+// Connects to SocketPath; returns -1 if nothing is listening there.
+static int connectTo(const std::string &SocketPath) {
+    sockaddr_un Addr;
+    if (!makeAddress(SocketPath, Addr))
+        return -1;
+    int FD = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (FD < 0)
+        return -1;
+    if (connect(FD, reinterpret_cast<sockaddr*>(&Addr), sizeof(Addr)) != 0) {
+        close(FD);
+        return -1;
+    }
+    return FD;
+}
+
+static void appendField(std::string &Payload, const std::string &Field) {
+    uint32_t Size = static_cast<uint32_t>(Field.size());
+    Payload.append(reinterpret_cast<const char*>(&Size), sizeof(Size));
+    Payload += Field;
+}
+
+static bool takeField(const std::string &Payload, size_t &Pos, std::string &Field) {
+    uint32_t Size;
+    if (Payload.size() - Pos < sizeof(Size))
+        return false;
+    std::memcpy(&Size, Payload.data() + Pos, sizeof(Size));
+    Pos += sizeof(Size);
+    if (Payload.size() - Pos < Size)
+        return false;
+    Field.assign(Payload, Pos, Size);
+    Pos += Size;
+    return true;
+}
+
+std::string Server::getDefaultSocketPath() {
+    if (const char* Path = std::getenv("NEXON_SERVER_SOCKET"))
+        return Path;
+    if (const char* RuntimeDir = std::getenv("XDG_RUNTIME_DIR"))
+        return std::string(RuntimeDir) + "/nexon.sock";
+    return "/tmp/nexon-" + std::to_string(getuid()) + ".sock";
+}
+
+bool Server::forward(const std::string &SocketPath, const std::vector<std::string> &Args, int &ExitCode) {
+    int FD = connectTo(SocketPath);
+    if (FD < 0)
+        return false;
+
+    char Cwd[4096];
+    if (!getcwd(Cwd, sizeof(Cwd))) {
+        close(FD);
+        return false;
+    }
+    std::string Payload;
+    appendField(Payload, RequestMagic);
+    appendField(Payload, Cwd);
+    appendField(Payload, std::to_string(Args.size()));
+    for (const auto &Arg : Args)
+        appendField(Payload, Arg);
+    for (char** Env = environ; *Env; ++Env)
+        appendField(Payload, *Env);
+
+    uint32_t Size = static_cast<uint32_t>(Payload.size());
+    int StdFDs[3] = { STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO };
+    iovec IOV = { &Size, sizeof(Size) };
+    alignas(cmsghdr) char Control[CMSG_SPACE(sizeof(StdFDs))];
+    msghdr Msg = {};
+    Msg.msg_iov = &IOV;
+    Msg.msg_iovlen = 1;
+    Msg.msg_control = Control;
+    Msg.msg_controllen = sizeof(Control);
+    cmsghdr* CM = CMSG_FIRSTHDR(&Msg);
+    CM->cmsg_level = SOL_SOCKET;
+    CM->cmsg_type = SCM_RIGHTS;
+    CM->cmsg_len = CMSG_LEN(sizeof(StdFDs));
+    std::memcpy(CMSG_DATA(CM), StdFDs, sizeof(StdFDs));
+    if (sendmsg(FD, &Msg, 0) != static_cast<ssize_t>(sizeof(Size))) {
+        close(FD);
+        return false;
+    }
+
+    // The request now belongs to the server, so a broken connection is an error rather
+    // than a reason to run the command a second time locally.
+    int32_t Code;
+    if (!writeAll(FD, Payload.data(), Payload.size()) || !readAll(FD, &Code, sizeof(Code))) {
+        std::cerr << "Error: Lost connection to the nexon server at " << SocketPath << ".\n";
+        Code = EXIT_FAILURE;
+    }
+    close(FD);
+    ExitCode = Code;
+    return true;
+}
+
+// Runs in the forked per-request process: reads the request, runs it in a further
+// fork (commands may exit() at any point) and reports how that process ended.
+static void handleConnection(int Conn, const Server::CommandHandler &Handler) {
+    uint32_t Size = 0;
+    int StdFDs[3] = { -1, -1, -1 };
+    iovec IOV = { &Size, sizeof(Size) };
+    alignas(cmsghdr) char Control[CMSG_SPACE(sizeof(StdFDs))];
+    msghdr Msg = {};
+    Msg.msg_iov = &IOV;
+    Msg.msg_iovlen = 1;
+    Msg.msg_control = Control;
+    Msg.msg_controllen = sizeof(Control);
+    if (recvmsg(Conn, &Msg, 0) != static_cast<ssize_t>(sizeof(Size)) || Size > MaxRequestSize)
+        return;
+    cmsghdr* CM = CMSG_FIRSTHDR(&Msg);
+    if (!CM || CM->cmsg_type != SCM_RIGHTS || CM->cmsg_len != CMSG_LEN(sizeof(StdFDs)))
+        return;
+    std::memcpy(StdFDs, CMSG_DATA(CM), sizeof(StdFDs));
+
+    std::string Payload(Size, '\0');
+    std::string Magic, Cwd, ArgCount;
+    size_t Pos = 0;
+    unsigned long NumArgs = 0;
+    if (!readAll(Conn, &Payload[0], Size) || !takeField(Payload, Pos, Magic) || Magic != RequestMagic ||
+        !takeField(Payload, Pos, Cwd) || !takeField(Payload, Pos, ArgCount))
+        return;
+    NumArgs = std::strtoul(ArgCount.c_str(), nullptr, 10);
+    std::vector<std::string> Args, Env;
+    for (std::string Field; Pos < Payload.size();) {
+        if (!takeField(Payload, Pos, Field))
+            return;
+        (Args.size() < NumArgs ? Args : Env).push_back(Field);
+    }
+    if (Args.size() != NumArgs || Args.empty())
+        return;
+
+    std::cout.flush();
+    std::cerr.flush();
+    pid_t Worker = fork();
+    if (Worker < 0)
+        return;
+    if (Worker == 0) {
+        signal(SIGPIPE, SIG_DFL);
+        // Lift the received descriptors above 2 first so installing one cannot clobber another.
+        for (int &FD : StdFDs)
+            FD = fcntl(FD, F_DUPFD, 3);
+        for (int I = 0; I < 3; ++I) {
+            dup2(StdFDs[I], I);
+            close(StdFDs[I]);
+        }
+        close(Conn);
+        if (chdir(Cwd.c_str()) != 0) {
+            std::cerr << "Error: Unable to enter " << Cwd << " on the nexon server.\n";
+            _exit(EXIT_FAILURE);
+        }
+        std::vector<char*> EnvPtrs;
+        for (auto &Var : Env)
+            EnvPtrs.push_back(&Var[0]);
+        EnvPtrs.push_back(nullptr);
+        environ = EnvPtrs.data();
+        std::vector<char*> Argv;
+        for (auto &Arg : Args)
+            Argv.push_back(&Arg[0]);
+        Argv.push_back(nullptr);
+        std::exit(Handler(static_cast<int>(Args.size()), Argv.data()));
+    }
+    for (int FD : StdFDs)
+        close(FD);
+
+    // A client that goes away (e.g. on Ctrl-C) takes its command with it. The worker is
+    // waited for without being reaped, so its pid cannot be reused before the kill.
+    std::thread([Conn, Worker]() {
+        char Byte;
+        while (read(Conn, &Byte, 1) > 0) { }
+        kill(Worker, SIGTERM);
+    }).detach();
+    siginfo_t Info = {};
+    while (waitid(P_PID, static_cast<id_t>(Worker), &Info, WEXITED | WNOWAIT) != 0 && errno == EINTR) { }
+    int32_t Code = Info.si_code == CLD_EXITED ? Info.si_status : 128 + Info.si_status;
+    writeAll(Conn, &Code, sizeof(Code));
+}
+
+bool Server::serve(const std::string &SocketPath, const CommandHandler &Handler) {
+    sockaddr_un Addr;
+    if (!makeAddress(SocketPath, Addr)) {
+        std::cerr << "Error: Socket path " << SocketPath << " is too long.\n";
+        return false;
+    }
+    int Existing = connectTo(SocketPath);
+    if (Existing >= 0) {
+        close(Existing);
+        std::cerr << "Error: A nexon server is already listening on " << SocketPath << ".\n";
+        return false;
+    }
+    // Nothing answers on the path, so any file left there is stale.
+    unlink(SocketPath.c_str());
+    int Listener = socket(AF_UNIX, SOCK_STREAM, 0);
+    mode_t OldMask = umask(077);
+    bool Bound = Listener >= 0 && bind(Listener, reinterpret_cast<sockaddr*>(&Addr), sizeof(Addr)) == 0;
+    umask(OldMask);
+    if (!Bound || listen(Listener, SOMAXCONN) != 0) {
+        std::cerr << "Error: Unable to listen on " << SocketPath << ": " << std::strerror(errno) << "\n";
+        if (Listener >= 0)
+            close(Listener);
+        return false;
+    }
+
+    struct sigaction Stop = {};
+    Stop.sa_handler = requestStop;
+    sigemptyset(&Stop.sa_mask);
+    sigaction(SIGINT, &Stop, nullptr);
+    sigaction(SIGTERM, &Stop, nullptr);
+    signal(SIGCHLD, SIG_IGN);
+    signal(SIGPIPE, SIG_IGN);
+    std::cout << "Nexon server listening on " << SocketPath << std::endl;
+
+    while (!StopRequested) {
+        int Conn = accept(Listener, nullptr, nullptr);
+        if (Conn < 0)
+            continue;
+#ifdef SO_PEERCRED
+        ucred Peer;
+        socklen_t PeerSize = sizeof(Peer);
+        if (getsockopt(Conn, SOL_SOCKET, SO_PEERCRED, &Peer, &PeerSize) != 0 || Peer.uid != getuid()) {
+            close(Conn);
+            continue;
+        }
+#endif
+        std::cout.flush();
+        std::cerr.flush();
+        pid_t Child = fork();
+        if (Child == 0) {
+            close(Listener);
+            signal(SIGCHLD, SIG_DFL);
+            signal(SIGINT, SIG_DFL);
+            signal(SIGTERM, SIG_DFL);
+            handleConnection(Conn, Handler);
+            _exit(0);
+        }
+        close(Conn);
+    }
+    close(Listener);
+    unlink(SocketPath.c_str());
+    std::cout << "Nexon server stopped." << std::endl;
+    return true;
+}
+
+#else
+
+std::string Server::getDefaultSocketPath() {
+    const char* Path = std::getenv("NEXON_SERVER_SOCKET");
+    return Path ? Path : "";
+}
+
+bool Server::serve(const std::string &, const CommandHandler &) {
+    std::cerr << "Error: nexon serve is not supported on this platform.\n";
+    return false;
+}
+
+bool Server::forward(const std::string &, const std::vector<std::string> &, int &) {
+    return false;
+}
+
+#endif
+
+}
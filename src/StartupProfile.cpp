@@ -0,0 +1,48 @@
+#include "Nexon/StartupProfile.h"
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+namespace Nexon {
+
+bool StartupProfile::Enabled = false;
+const char* StartupProfile::Title = nullptr;
+double StartupProfile::CpuBeforeMain = 0;
+std::chrono::steady_clock::time_point StartupProfile::MainStart;
+std::vector<std::pair<const char*, double>> StartupProfile::Stages;
+
+static double millisecondsSince(std::chrono::steady_clock::time_point Start) {
+    return std::chrono::duration<double, std::milli>(std::chrono::steady_clock::now() - Start).count();
+}
+
+void StartupProfile::enable(const char* ReportTitle) {
+    if (Enabled)
+        return;
+    Enabled = true;
+    Title = ReportTitle;
+    MainStart = std::chrono::steady_clock::now();
+    // CPU time already spent loading the binary and running static initializers.
+    CpuBeforeMain = 1000.0 * static_cast<double>(std::clock()) / CLOCKS_PER_SEC;
+    std::atexit(report);
+}
+
+StartupProfile::Stage::Stage(const char* Name) : Name(Name) {
+    if (Enabled)
+        Start = std::chrono::steady_clock::now();
+}
+
+StartupProfile::Stage::~Stage() {
+    if (Enabled)
+        Stages.emplace_back(Name, millisecondsSince(Start));
+}
+
+void StartupProfile::report() {
+    // stdio rather than iostreams: this runs from atexit, after the streams may be gone.
+    std::fprintf(stderr, "%s:\n", Title);
+    std::fprintf(stderr, "  %-24s %9.3f ms (CPU)\n", "before main", CpuBeforeMain);
+    for (const auto &S : Stages)
+        std::fprintf(stderr, "  %-24s %9.3f ms\n", S.first, S.second);
+    std::fprintf(stderr, "  %-24s %9.3f ms\n", "main to exit", millisecondsSince(MainStart));
+}
+
+}
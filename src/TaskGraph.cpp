@@ -0,0 +1,143 @@
+#include "Nexon/TaskGraph.h"
+#include "Nexon/Concurrency.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/JSON.h"
+#include "llvm/Support/raw_ostream.h"
+#include <iostream>
+#include <set>
+
+namespace Nexon {
+using namespace llvm;
+
+TaskGraph::NodeId TaskGraph::add(StringRef Name, unique_function<void()> Work, ArrayRef<NodeId> Dependencies) {
+    auto N = std::make_unique<Node>();
+    N->Name = Name.str();
+    N->Work = std::move(Work);
+    Nodes.push_back(std::move(N));
+    NodeId Id = Nodes.size() - 1;
+    for (NodeId Dependency : Dependencies)
+        addDependency(Dependency, Id);
+    return Id;
+}
+
+void TaskGraph::addDependency(NodeId From, NodeId To) {
+    Nodes[From]->Successors.push_back(To);
+    ++Nodes[To]->NumDependencies;
+}
+
+bool TaskGraph::hasCycle() const {
+    // Kahn's algorithm: every node is reachable in topological order unless some are
+    // on a cycle.
+    std::vector<unsigned> Remaining;
+    std::vector<NodeId> Ready;
+    for (NodeId Id = 0; Id < Nodes.size(); ++Id) {
+        Remaining.push_back(Nodes[Id]->NumDependencies);
+        if (Remaining.back() == 0)
+            Ready.push_back(Id);
+    }
+    size_t Visited = 0;
+    while (!Ready.empty()) {
+        NodeId Id = Ready.back();
+        Ready.pop_back();
+        ++Visited;
+        for (NodeId Successor : Nodes[Id]->Successors) {
+            if (--Remaining[Successor] == 0)
+                Ready.push_back(Successor);
+        }
+    }
+    return Visited != Nodes.size();
+}
+
+bool TaskGraph::run() {
+    if (hasCycle()) {
+        std::cerr << "Error: Task graph has a dependency cycle." << std::endl;
+        return false;
+    }
+    RunStart = std::chrono::steady_clock::now();
+    for (auto &N : Nodes) {
+        N->Remaining.store(N->NumDependencies, std::memory_order_relaxed);
+        N->Ran = false;
+    }
+    Unfinished.store(Nodes.size(), std::memory_order_relaxed);
+    ThreadPool &Pool = ThreadPool::get();
+    for (NodeId Id = 0; Id < Nodes.size(); ++Id) {
+        if (Nodes[Id]->NumDependencies == 0)
+            Pool.submitFunction([this, Id] { runNode(Id); });
+    }
+    Pool.helpUntil([this] { return Unfinished.load(std::memory_order_acquire) == 0; });
+    bool Completed = !Cancelled.exchange(false, std::memory_order_relaxed);
+    for (auto &N : Nodes)
+        Completed = Completed && N->Ran;
+    return Completed;
+}
+
+Future<bool> TaskGraph::runAsync() {
+    return Concurrency::async([this] { return run(); });
+}
+
+void TaskGraph::runNode(NodeId Id) {
+    Node &N = *Nodes[Id];
+    // A skipped node still releases its successors, which are skipped in turn.
+    if (!Cancelled.load(std::memory_order_relaxed)) {
+        CancellationScope Scope(&Cancelled);
+        N.Thread = ThreadPool::getWorkerIndex();
+        N.Start = std::chrono::steady_clock::now();
+        N.Work();
+        N.End = std::chrono::steady_clock::now();
+        N.Ran = true;
+    }
+    for (NodeId Successor : N.Successors) {
+        if (Nodes[Successor]->Remaining.fetch_sub(1, std::memory_order_acq_rel) == 1)
+            ThreadPool::get().submitFunction([this, Successor] { runNode(Successor); });
+    }
+    Unfinished.fetch_sub(1, std::memory_order_release);
+}
+
+bool TaskGraph::exportTrace(StringRef Path) const {
+    std::error_code EC;
+    raw_fd_ostream Out(Path, EC, sys::fs::OF_Text);
+    if (EC) {
+        std::cerr << "Error: Unable to write trace file " << Path.str() << ": " << EC.message() << std::endl;
+        return false;
+    }
+    auto Microseconds = [this](std::chrono::steady_clock::time_point T) {
+        return std::chrono::duration_cast<std::chrono::microseconds>(T - RunStart).count();
+    };
+    // Trace thread 0 is the thread that called run(); worker i is thread i + 1.
+    auto TraceThread = [](int Worker) { return static_cast<int64_t>(Worker + 1); };
+    json::OStream J(Out);
+    J.object([&] {
+        J.attributeArray("traceEvents", [&] {
+            std::set<int> Threads;
+            for (auto &N : Nodes) {
+                if (!N->Ran)
+                    continue;
+                Threads.insert(N->Thread);
+                J.object([&] {
+                    J.attribute("name", N->Name);
+                    J.attribute("ph", "X");
+                    J.attribute("pid", 1);
+                    J.attribute("tid", TraceThread(N->Thread));
+                    J.attribute("ts", Microseconds(N->Start));
+                    J.attribute("dur", Microseconds(N->End) - Microseconds(N->Start));
+                });
+            }
+            for (int Thread : Threads) {
+                J.object([&] {
+                    J.attribute("name", "thread_name");
+                    J.attribute("ph", "M");
+                    J.attribute("pid", 1);
+                    J.attribute("tid", TraceThread(Thread));
+                    J.attributeObject("args", [&] {
+                        J.attribute("name", Thread < 0 ? std::string("caller") : "worker " + std::to_string(Thread));
+                    });
+                });
+            }
+        });
+        J.attribute("displayTimeUnit", "ms");
+    });
+    Out << "\n";
+    return true;
+}
+
+}
@@ -0,0 +1,334 @@
+#include "Nexon/ThreadPool.h"
+#include "Nexon/Topology.h"
+#include <algorithm>
+#include <charconv>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <map>
+#ifndef _WIN32
+#include <pthread.h>
+#endif
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace Nexon {
+
+namespace {
+
+// Index of the pool worker running on this thread, or -1 for other threads.
+thread_local int CurrentWorker = -1;
+
+std::atomic<ThreadPool*> Instance { nullptr };
+std::mutex InstanceMutex;
+
+// Failed attempts to find work before an idle thread yields, and before a worker parks.
+constexpr unsigned SpinLimit = 64;
+constexpr unsigned ParkLimit = 256;
+
+unsigned getRequestedThreads() {
+    if (const char* Env = std::getenv("NEXON_NUM_THREADS")) {
+        unsigned long Value = 0;
+        const char* End = Env + std::strlen(Env);
+        auto [Ptr, EC] = std::from_chars(Env, End, Value);
+        if (EC == std::errc() && Ptr == End && Value > 0 && Value <= 4096)
+            return static_cast<unsigned>(Value);
+        std::cerr << "Warning: Ignoring invalid NEXON_NUM_THREADS '" << Env << "'.\n";
+    }
+    return Topology::get().getConcurrency();
+}
+
+enum class AffinityMode { None, Node, Core };
+
+AffinityMode getAffinityMode() {
+    const char* Env = std::getenv("NEXON_AFFINITY");
+    if (!Env || std::strcmp(Env, "node") == 0)
+        return AffinityMode::Node;
+    if (std::strcmp(Env, "core") == 0)
+        return AffinityMode::Core;
+    if (std::strcmp(Env, "none") != 0)
+        std::cerr << "Warning: Ignoring invalid NEXON_AFFINITY '" << Env << "' (expected node, core or none).\n";
+    return AffinityMode::None;
+}
+
+// Binds the calling thread to the CPU at Index in Topology::getCPUs(), or to every
+// usable CPU of that CPU's node.
+void pinCurrentThread(size_t Index, AffinityMode Mode) {
+#ifdef __linux__
+    if (Mode == AffinityMode::None)
+        return;
+    const Topology &T = Topology::get();
+    const auto &CPUs = T.getCPUs();
+    unsigned MaxCPU = *std::max_element(CPUs.begin(), CPUs.end());
+    cpu_set_t* Set = CPU_ALLOC(MaxCPU + 1);
+    size_t Bytes = CPU_ALLOC_SIZE(MaxCPU + 1);
+    CPU_ZERO_S(Bytes, Set);
+    for (size_t I = 0; I < CPUs.size(); ++I) {
+        if (Mode == AffinityMode::Core ? I == Index : T.getNodeOfCPU(I) == T.getNodeOfCPU(Index))
+            CPU_SET_S(CPUs[I], Bytes, Set);
+    }
+    // Failure (e.g. a mask changed since start-up) leaves the thread unpinned.
+    pthread_setaffinity_np(pthread_self(), Bytes, Set);
+    CPU_FREE(Set);
+#else
+    (void)Index;
+    (void)Mode;
+#endif
+}
+
+// Shared by the tasks of one parallelFor call, which lives on the caller's stack.
+struct LoopState {
+    llvm::function_ref<void(size_t, size_t)> Body;
+    size_t Grain;
+    // Chunks not yet finished.
+    std::atomic<size_t> Pending;
+};
+
+class RangeTask : public ThreadPool::Task {
+public:
+    RangeTask(ThreadPool &Pool, LoopState &Loop, size_t Begin, size_t End)
+        : Pool(Pool), Loop(Loop), Begin(Begin), End(End) { }
+    void execute() override {
+        run(Pool, Loop, Begin, End);
+        delete this;
+    }
+    // Splits off the upper half for other threads until [Begin, End) fits the grain,
+    // then runs it. Finishing the chunk is the last access to Loop.
+    static void run(ThreadPool &Pool, LoopState &Loop, size_t Begin, size_t End) {
+        while (End - Begin > Loop.Grain) {
+            size_t Mid = Begin + (End - Begin) / 2;
+            Loop.Pending.fetch_add(1, std::memory_order_relaxed);
+            Pool.submit(new RangeTask(Pool, Loop, Mid, End));
+            End = Mid;
+        }
+        Loop.Body(Begin, End);
+        Loop.Pending.fetch_sub(1, std::memory_order_release);
+    }
+private:
+    ThreadPool &Pool;
+    LoopState &Loop;
+    size_t Begin, End;
+};
+
+}
+
+ThreadPool &ThreadPool::get() {
+    ThreadPool* Pool = Instance.load(std::memory_order_acquire);
+    if (Pool)
+        return *Pool;
+    std::lock_guard<std::mutex> Lock(InstanceMutex);
+    Pool = Instance.load(std::memory_order_relaxed);
+    if (!Pool) {
+#ifndef _WIN32
+        // A forked child (e.g. a `nexon serve` request) has none of the workers; it
+        // starts a pool of its own on first use.
+        static bool AtForkRegistered = false;
+        if (!AtForkRegistered) {
+            pthread_atfork(nullptr, nullptr, [] {
+                Instance.store(nullptr, std::memory_order_relaxed);
+                CurrentWorker = -1;
+            });
+            AtForkRegistered = true;
+        }
+#endif
+        // Never destroyed: workers run until the process exits.
+        Pool = new ThreadPool(getRequestedThreads() - 1);
+        Instance.store(Pool, std::memory_order_release);
+    }
+    return *Pool;
+}
+
+ThreadPool::ThreadPool(unsigned NumWorkers) {
+    const Topology &Topo = Topology::get();
+    size_t NumCPUs = Topo.getCPUs().size();
+    unsigned NumThreads = NumWorkers + 1;
+    // Spread the threads evenly over the usable CPUs; thread 0 is the caller, which is
+    // left where it is. Pool nodes are the topology nodes that get a worker.
+    std::map<unsigned, unsigned> PoolNode;
+    for (unsigned I = 0; I < NumWorkers; ++I) {
+        auto W = std::make_unique<Worker>();
+        size_t Slot = I + 1;
+        W->CPUIndex = NumThreads <= NumCPUs ? Slot * NumCPUs / NumThreads : Slot % NumCPUs;
+        auto It = PoolNode.emplace(Topo.getNodeOfCPU(W->CPUIndex), static_cast<unsigned>(PoolNode.size())).first;
+        W->Node = It->second;
+        if (W->Node == NodeWeights.size())
+            NodeWeights.push_back(0);
+        ++NodeWeights[W->Node];
+        Workers.push_back(std::move(W));
+    }
+    for (size_t N = 0; N < NodeWeights.size(); ++N)
+        NodeQueues.push_back(std::make_unique<TaskQueue>());
+    // Every deque exists before any worker can try to steal from it.
+    AffinityMode Mode = getAffinityMode();
+    for (unsigned I = 0; I < NumWorkers; ++I) {
+        Workers[I]->Thread = std::thread([this, I, Mode] {
+            pinCurrentThread(Workers[I]->CPUIndex, Mode);
+            workerLoop(I);
+        });
+    }
+}
+
+void ThreadPool::TaskQueue::push(Task* T) {
+    std::lock_guard<std::mutex> Lock(Mutex);
+    Tasks.push_back(T);
+    Size.fetch_add(1, std::memory_order_release);
+}
+
+ThreadPool::Task* ThreadPool::TaskQueue::pop() {
+    if (Size.load(std::memory_order_acquire) == 0)
+        return nullptr;
+    std::lock_guard<std::mutex> Lock(Mutex);
+    if (Tasks.empty())
+        return nullptr;
+    Task* T = Tasks.front();
+    Tasks.pop_front();
+    Size.fetch_sub(1, std::memory_order_relaxed);
+    return T;
+}
+
+void ThreadPool::workerLoop(unsigned Index) {
+    CurrentWorker = static_cast<int>(Index);
+    unsigned Idle = 0;
+    while (true) {
+        if (Task* T = findTask(Idle)) {
+            T->execute();
+            Idle = 0;
+            continue;
+        }
+        if (++Idle < ParkLimit) {
+            if (Idle >= SpinLimit)
+                std::this_thread::yield();
+            continue;
+        }
+        // Park until something is submitted. Reading the version before the last look
+        // for work means a submission in between keeps this worker awake.
+        uint64_t Version = WorkVersion.load(std::memory_order_seq_cst);
+        if (Task* T = findTask(Idle)) {
+            T->execute();
+            Idle = 0;
+            continue;
+        }
+        std::unique_lock<std::mutex> Lock(SleepMutex);
+        NumSleeping.fetch_add(1, std::memory_order_seq_cst);
+        SleepCondition.wait(Lock, [&] { return WorkVersion.load(std::memory_order_seq_cst) != Version; });
+        NumSleeping.fetch_sub(1, std::memory_order_relaxed);
+        Idle = 0;
+    }
+}
+
+void ThreadPool::submit(Task* T) {
+    int Self = CurrentWorker;
+    if (Self >= 0)
+        Workers[Self]->Deque.push(T);
+    else
+        Shared.push(T);
+    wakeWorker();
+}
+
+void ThreadPool::wakeWorker() {
+    WorkVersion.fetch_add(1, std::memory_order_seq_cst);
+    if (NumSleeping.load(std::memory_order_seq_cst) != 0) {
+        std::lock_guard<std::mutex> Lock(SleepMutex);
+        SleepCondition.notify_one();
+    }
+}
+
+void ThreadPool::wakeAllWorkers() {
+    WorkVersion.fetch_add(1, std::memory_order_seq_cst);
+    if (NumSleeping.load(std::memory_order_seq_cst) != 0) {
+        std::lock_guard<std::mutex> Lock(SleepMutex);
+        SleepCondition.notify_all();
+    }
+}
+
+ThreadPool::Task* ThreadPool::findTask(unsigned Idle) {
+    int Self = CurrentWorker;
+    int Node = Self >= 0 ? static_cast<int>(Workers[Self]->Node) : -1;
+    if (Self >= 0) {
+        if (Task* T = Workers[Self]->Deque.pop())
+            return T;
+        if (Task* T = NodeQueues[Node]->pop())
+            return T;
+    }
+    if (Task* T = Shared.pop())
+        return T;
+    // Threads start stealing at different victims, so they do not all contend on one.
+    static thread_local size_t NextVictim = std::hash<std::thread::id>()(std::this_thread::get_id());
+    size_t NumWorkers = Workers.size();
+    // Steal within the node first, then from any worker.
+    for (int Pass = Node >= 0 && NodeQueues.size() > 1 ? 0 : 1; Pass < 2; ++Pass) {
+        for (size_t I = 0; I < NumWorkers; ++I) {
+            size_t Victim = (NextVictim + I) % NumWorkers;
+            if (static_cast<int>(Victim) == Self || (Pass == 0 && static_cast<int>(Workers[Victim]->Node) != Node))
+                continue;
+            if (Task* T = Workers[Victim]->Deque.steal()) {
+                NextVictim = Victim;
+                return T;
+            }
+        }
+    }
+    if (Idle >= SpinLimit) {
+        for (size_t N = 0; N < NodeQueues.size(); ++N) {
+            if (static_cast<int>(N) == Node)
+                continue;
+            if (Task* T = NodeQueues[N]->pop())
+                return T;
+        }
+    }
+    return nullptr;
+}
+
+void ThreadPool::helpUntil(llvm::function_ref<bool()> Done) {
+    unsigned Idle = 0;
+    while (!Done()) {
+        if (Task* T = findTask(Idle)) {
+            T->execute();
+            Idle = 0;
+        } else if (++Idle >= SpinLimit) {
+            std::this_thread::yield();
+        }
+    }
+}
+
+int ThreadPool::getWorkerIndex() {
+    return CurrentWorker;
+}
+
+void ThreadPool::parallelFor(size_t Begin, size_t End, size_t Grain,
+                             llvm::function_ref<void(size_t, size_t)> Body) {
+    Grain = std::max<size_t>(Grain, 1);
+    if (Begin >= End)
+        return;
+    if (Workers.empty() || End - Begin <= Grain) {
+        for (size_t ChunkBegin = Begin; ChunkBegin < End; ChunkBegin += std::min(Grain, End - ChunkBegin))
+            Body(ChunkBegin, ChunkBegin + std::min(Grain, End - ChunkBegin));
+        return;
+    }
+    size_t NumNodes = NodeQueues.size();
+    if (NumNodes > 1 && End - Begin > Grain * NumNodes) {
+        // One contiguous part per node, in proportion to its workers.
+        std::vector<size_t> Bounds { Begin };
+        size_t Count = End - Begin, Weight = 0;
+        for (size_t N = 0; N < NumNodes; ++N) {
+            Weight += NodeWeights[N];
+            Bounds.push_back(Begin + Count * Weight / Workers.size());
+        }
+        size_t NumParts = 0;
+        for (size_t N = 0; N < NumNodes; ++N)
+            NumParts += Bounds[N] < Bounds[N + 1];
+        LoopState Loop { Body, Grain, { NumParts } };
+        for (size_t N = 0; N < NumNodes; ++N) {
+            if (Bounds[N] < Bounds[N + 1])
+                NodeQueues[N]->push(new RangeTask(*this, Loop, Bounds[N], Bounds[N + 1]));
+        }
+        wakeAllWorkers();
+        helpUntil([&] { return Loop.Pending.load(std::memory_order_acquire) == 0; });
+        return;
+    }
+    LoopState Loop { Body, Grain, { 1 } };
+    RangeTask::run(*this, Loop, Begin, End);
+    helpUntil([&] { return Loop.Pending.load(std::memory_order_acquire) == 0; });
+}
+
+}
@@ -0,0 +1,61 @@
+#include "Nexon/TokenBuffer.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <limits>
+
+namespace Nexon {
+
+bool TokenBuffer::tokenize(std::string_view Src) {
+    Kinds.clear();
+    Offsets.clear();
+    Lengths.clear();
+    NumVals.clear();
+    LineStarts.clear();
+    Source = Src;
+    if (Src.size() > std::numeric_limits<uint32_t>::max()) {
+        std::cerr << "Error: Source of " << Src.size() << " bytes exceeds the 4 GiB token buffer limit.\n";
+        return false;
+    }
+    // Generated sources average well over eight bytes per token.
+    size_t Estimate = Src.size() / 8 + 1;
+    Kinds.reserve(Estimate);
+    Offsets.reserve(Estimate);
+    Lengths.reserve(Estimate);
+    NumVals.reserve(Estimate);
+
+    Lexer Lex(Src);
+    int Tok;
+    do {
+        Tok = Lex.getNextToken();
+        std::string_view Text = Lex.getTokenText();
+        Kinds.push_back(static_cast<int16_t>(Tok));
+        Offsets.push_back(static_cast<uint32_t>(Text.data() - Src.data()));
+        Lengths.push_back(static_cast<uint32_t>(Text.size()));
+        NumVals.push_back(Tok == tok_number ? Lex.getNumVal() : 0.0);
+    } while (Tok != tok_eof);
+    return true;
+}
+
+SourceLocation TokenBuffer::getLoc(size_t I) const {
+    if (LineStarts.empty()) {
+        LineStarts.push_back(0);
+        const char* Begin = Source.data();
+        const char* End = Begin + Source.size();
+        for (const char* P = Begin; P != End;) {
+            const void* Newline = std::memchr(P, '\n', static_cast<size_t>(End - P));
+            if (!Newline)
+                break;
+            P = static_cast<const char*>(Newline) + 1;
+            LineStarts.push_back(static_cast<uint32_t>(P - Begin));
+        }
+    }
+    uint32_t Offset = Offsets[I];
+    auto It = std::upper_bound(LineStarts.begin(), LineStarts.end(), Offset);
+    SourceLocation Loc;
+    Loc.Line = static_cast<unsigned>(It - LineStarts.begin());
+    Loc.Column = Offset - *(It - 1) + 1;
+    return Loc;
+}
+
+}
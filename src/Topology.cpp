@@ -0,0 +1,234 @@
+#include "Nexon/Topology.h"
+#include <algorithm>
+#include <cerrno>
+#include <charconv>
+#include <cmath>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <tuple>
+#ifdef __linux__
+#include <sched.h>
+#endif
+
+namespace Nexon {
+
+namespace {
+
+// The runtime is linked into compiled programs, so text is parsed with std::string_view
+// rather than llvm::StringRef, whose out-of-line members pull in most of LLVMSupport.
+std::string_view trim(std::string_view Text) {
+    size_t Begin = Text.find_first_not_of(" \t\n\r");
+    if (Begin == std::string_view::npos)
+        return {};
+    return Text.substr(Begin, Text.find_last_not_of(" \t\n\r") - Begin + 1);
+}
+
+// Text before and after the first Separator; the second part is empty if there is none.
+std::pair<std::string_view, std::string_view> splitOnce(std::string_view Text, char Separator) {
+    size_t At = Text.find(Separator);
+    if (At == std::string_view::npos)
+        return { Text, {} };
+    return { Text.substr(0, At), Text.substr(At + 1) };
+}
+
+// The non-empty pieces of Text between Separators.
+std::vector<std::string_view> split(std::string_view Text, char Separator) {
+    std::vector<std::string_view> Pieces;
+    while (!Text.empty()) {
+        std::string_view Piece;
+        std::tie(Piece, Text) = splitOnce(Text, Separator);
+        if (!Piece.empty())
+            Pieces.push_back(Piece);
+    }
+    return Pieces;
+}
+
+// Parses all of Text, ignoring surrounding whitespace, as a number.
+template<typename T>
+bool parseNumber(std::string_view Text, T &Value) {
+    Text = trim(Text);
+    const char* End = Text.data() + Text.size();
+    auto [Ptr, EC] = std::from_chars(Text.data(), End, Value);
+    return !Text.empty() && EC == std::errc() && Ptr == End;
+}
+
+#ifdef __linux__
+// Small text files under /proc and /sys report a size of 4096 or 0, so they are read
+// as streams.
+bool readFile(const std::filesystem::path &Path, std::string &Contents) {
+    std::ifstream In(Path);
+    if (!In)
+        return false;
+    std::ostringstream Buffer;
+    Buffer << In.rdbuf();
+    Contents = Buffer.str();
+    return true;
+}
+
+std::vector<unsigned> getAffinityCPUs() {
+    std::vector<unsigned> CPUs;
+    for (size_t SetSize = 1024; SetSize <= (1u << 16); SetSize *= 2) {
+        cpu_set_t* Set = CPU_ALLOC(SetSize);
+        size_t Bytes = CPU_ALLOC_SIZE(SetSize);
+        if (sched_getaffinity(0, Bytes, Set) == 0) {
+            for (size_t CPU = 0; CPU < SetSize; ++CPU) {
+                if (CPU_ISSET_S(CPU, Bytes, Set))
+                    CPUs.push_back(static_cast<unsigned>(CPU));
+            }
+            CPU_FREE(Set);
+            break;
+        }
+        CPU_FREE(Set);
+        // EINVAL means the kernel's mask is larger than Set.
+        if (errno != EINVAL)
+            break;
+    }
+    return CPUs;
+}
+
+// Quota in CPUs (rounded up) of one cgroup directory, or 0 if it has none.
+unsigned readCgroupQuota(const std::string &Dir, bool V2) {
+    std::string Text;
+    double Quota = 0, Period = 0;
+    if (V2) {
+        // "max 100000" or "<quota> <period>".
+        if (!readFile(Dir + "/cpu.max", Text))
+            return 0;
+        std::istringstream In(Text);
+        std::string QuotaText;
+        In >> QuotaText >> Period;
+        if (QuotaText == "max" || !parseNumber(QuotaText, Quota))
+            return 0;
+    } else {
+        std::string PeriodText;
+        if (!readFile(Dir + "/cpu.cfs_quota_us", Text) || !readFile(Dir + "/cpu.cfs_period_us", PeriodText))
+            return 0;
+        if (!parseNumber(Text, Quota) || !parseNumber(PeriodText, Period))
+            return 0;
+    }
+    if (Quota <= 0 || Period <= 0)
+        return 0;
+    return std::max(1u, static_cast<unsigned>(std::ceil(Quota / Period)));
+}
+
+// The tightest quota of this process's cgroup and its ancestors. Inside a container
+// the process's own cgroup usually appears as the root of the mount.
+unsigned getCgroupQuota() {
+    std::string Text;
+    if (!readFile("/proc/self/cgroup", Text))
+        return 0;
+    unsigned Limit = 0;
+    auto Apply = [&Limit](unsigned Quota) {
+        if (Quota && (!Limit || Quota < Limit))
+            Limit = Quota;
+    };
+    for (std::string_view Line : split(Text, '\n')) {
+        // "<id>:<controllers>:<path>"
+        std::string_view Id, Controllers, Path;
+        std::tie(Id, Line) = splitOnce(Line, ':');
+        std::tie(Controllers, Path) = splitOnce(Line, ':');
+        bool V2 = Id == "0" && Controllers.empty();
+        std::string Mount;
+        if (V2) {
+            Mount = "/sys/fs/cgroup";
+        } else {
+            std::vector<std::string_view> Names = split(Controllers, ',');
+            if (std::find(Names.begin(), Names.end(), "cpu") == Names.end())
+                continue;
+            Mount = "/sys/fs/cgroup/" + std::string(Controllers);
+            std::string Unused;
+            if (!readFile(Mount + "/cpu.cfs_period_us", Unused))
+                Mount = "/sys/fs/cgroup/cpu";
+        }
+        while (!Path.empty() && Path.back() == '/')
+            Path.remove_suffix(1);
+        for (std::string Dir(Path);; Dir = Dir.substr(0, Dir.rfind('/'))) {
+            Apply(readCgroupQuota(Mount + Dir, V2));
+            if (Dir.empty())
+                break;
+        }
+    }
+    return Limit;
+}
+#endif
+
+}
+
+std::vector<unsigned> Topology::parseCPUList(std::string_view List) {
+    std::vector<unsigned> CPUs;
+    for (std::string_view Range : split(trim(List), ',')) {
+        std::string_view FirstText, LastText;
+        std::tie(FirstText, LastText) = splitOnce(trim(Range), '-');
+        unsigned First, Last;
+        if (!parseNumber(FirstText, First))
+            continue;
+        if (LastText.empty())
+            Last = First;
+        else if (!parseNumber(LastText, Last) || Last < First)
+            continue;
+        for (unsigned CPU = First; CPU <= Last; ++CPU)
+            CPUs.push_back(CPU);
+    }
+    return CPUs;
+}
+
+const Topology &Topology::get() {
+    static const Topology Instance;
+    return Instance;
+}
+
+Topology::Topology() {
+#ifdef __linux__
+    std::vector<unsigned> Allowed = getAffinityCPUs();
+    // Node of each CPU, from the sysfs node directories; CPUs without one are node 0.
+    std::map<unsigned, unsigned> SysNodeOf;
+    std::error_code EC;
+    for (std::filesystem::directory_iterator It("/sys/devices/system/node", EC), End; !EC && It != End; It.increment(EC)) {
+        // The filename is a temporary; Name must not outlive this copy.
+        std::string FileName = It->path().filename().string();
+        std::string_view Name = FileName;
+        unsigned SysNode;
+        std::string List;
+        if (Name.substr(0, 4) != "node" || !parseNumber(Name.substr(4), SysNode) ||
+            !readFile(It->path() / "cpulist", List))
+            continue;
+        for (unsigned CPU : parseCPUList(List))
+            SysNodeOf[CPU] = SysNode;
+    }
+    std::vector<std::pair<unsigned, unsigned>> Placed;
+    for (unsigned CPU : Allowed) {
+        auto It = SysNodeOf.find(CPU);
+        Placed.emplace_back(It == SysNodeOf.end() ? 0 : It->second, CPU);
+    }
+    std::sort(Placed.begin(), Placed.end());
+    // Number the nodes that have usable CPUs densely.
+    std::map<unsigned, unsigned> DenseNode;
+    for (auto &P : Placed) {
+        auto It = DenseNode.emplace(P.first, static_cast<unsigned>(DenseNode.size())).first;
+        CPUs.push_back(P.second);
+        Nodes.push_back(It->second);
+    }
+    NumNodes = std::max<unsigned>(1, static_cast<unsigned>(DenseNode.size()));
+    CPUQuota = getCgroupQuota();
+#endif
+    if (CPUs.empty()) {
+        unsigned Threads = std::max(1u, std::thread::hardware_concurrency());
+        for (unsigned CPU = 0; CPU < Threads; ++CPU) {
+            CPUs.push_back(CPU);
+            Nodes.push_back(0);
+        }
+        NumNodes = 1;
+    }
+}
+
+unsigned Topology::getConcurrency() const {
+    unsigned Usable = static_cast<unsigned>(CPUs.size());
+    return CPUQuota ? std::min(Usable, CPUQuota) : Usable;
+}
+
+}
@@ -0,0 +1,294 @@
+#include "Nexon/TypeInference.h"
+#include "Nexon/CodeGen.h"
+#include <cstdint>
+#include <utility>
+#include <vector>
+
+namespace Nexon {
+using namespace llvm;
+
+namespace {
+
+// One walk over a function body. Variables are numbered in declaration order, which
+// is the same on every walk, so their types carry over from one walk to the next;
+// walks repeat until no variable's type widens.
+class Inferencer {
+public:
+    Inferencer(const ASTContext &Ctx, const FunctionRegistry &Functions) : Ctx(Ctx), Functions(Functions) { }
+
+    void run(const FunctionAST &F) {
+        const PrototypeAST &P = Ctx.getProto(F.Proto);
+        ArrayRef<uint32_t> Params = Ctx.getList(P.FirstParam, P.NumParams);
+        ArrayRef<uint32_t> ParamTypes = Ctx.getList(P.FirstParamType, P.NumParams);
+        do {
+            Changed = false;
+            NextVariable = 0;
+            Scope.clear();
+            for (size_t I = 0; I < Params.size(); ++I)
+                declare(Params[I], static_cast<ValueType>(ParamTypes[I]), /*Fixed=*/true);
+            visit(F.Body);
+        } while (Changed);
+    }
+
+private:
+    struct Variable {
+        ValueType Type;
+        // Annotated variables and parameters keep their type.
+        bool Fixed;
+    };
+
+    unsigned declare(Symbol Name, ValueType Type, bool Fixed) {
+        unsigned Id = NextVariable++;
+        if (Id == Variables.size())
+            Variables.push_back({ Type, Fixed });
+        else
+            widen(Id, Type);
+        Scope.emplace_back(Name, Id);
+        return Id;
+    }
+
+    void widen(unsigned Id, ValueType Type) {
+        Variable &V = Variables[Id];
+        if (V.Fixed || joinTypes(V.Type, Type) == V.Type)
+            return;
+        V.Type = joinTypes(V.Type, Type);
+        Changed = true;
+    }
+
+    // Innermost variable called Name, or -1.
+    int lookup(Symbol Name) const {
+        for (auto It = Scope.rbegin(); It != Scope.rend(); ++It) {
+            if (It->first == Name)
+                return static_cast<int>(It->second);
+        }
+        return -1;
+    }
+
+    const ExprAST* getLiteral(ExprRef E) const {
+        const ExprAST &Node = Ctx.getExpr(E);
+        return Node.Kind == ExprKind::Number ? &Node : nullptr;
+    }
+
+    ValueType getCommonType(ExprRef L, ExprRef R) const {
+        return TypeInference::getCommonType(Ctx.getExpr(L).Type, getLiteral(L), Ctx.getExpr(R).Type, getLiteral(R));
+    }
+
+    // Arithmetic on bool is done in i64.
+    static ValueType getArithmeticType(ValueType T) { return T == ValueType::Bool ? ValueType::I64 : T; }
+
+    void visitBinary(const ExprAST &E) {
+        if (E.Op == '=') {
+            visit(E.Operands[0]);
+            const ExprAST &Target = Ctx.getExpr(E.A);
+            int Id = Target.Kind == ExprKind::Variable ? lookup(Target.A) : -1;
+            if (Id < 0) {
+                // Reported when the function is lowered.
+                E.Type = Ctx.getExpr(E.Operands[0]).Type;
+                return;
+            }
+            widen(static_cast<unsigned>(Id), Ctx.getExpr(E.Operands[0]).Type);
+            E.Type = Variables[Id].Type;
+            Target.Type = E.Type;
+            return;
+        }
+        visit(E.A);
+        visit(E.Operands[0]);
+        ValueType T = getCommonType(E.A, E.Operands[0]);
+        if (TypeInference::isComparison(E.Op))
+            E.Type = ValueType::Bool;
+        else if (E.Op == '/' && !isFloatType(T))
+            E.Type = ValueType::F64;
+        else
+            E.Type = getArithmeticType(T);
+    }
+
+    void visitCall(const ExprAST &E) {
+        for (ExprRef Arg : Ctx.getList(E.Operands[0], E.Operands[1]))
+            visit(Arg);
+        std::string_view Callee = Ctx.getName(E.A);
+        if (std::optional<ValueType> Conversion = TypeInference::getConversion(Callee, Functions))
+            E.Type = *Conversion;
+        else if (std::optional<FunctionSignature> Sig = Functions.find(Callee))
+            E.Type = Sig->ReturnType;
+        else
+            E.Type = ValueType::F64; // Reported when the function is lowered.
+    }
+
+    void visit(ExprRef Ref) {
+        const ExprAST &E = Ctx.getExpr(Ref);
+        switch (E.Kind) {
+            case ExprKind::Number:
+                break;
+            case ExprKind::Variable: {
+                int Id = lookup(E.A);
+                E.Type = Id < 0 ? ValueType::F64 : Variables[Id].Type;
+                break;
+            }
+            case ExprKind::Binary:
+                visitBinary(E);
+                break;
+            case ExprKind::Call:
+                visitCall(E);
+                break;
+            case ExprKind::Block: {
+                size_t Outer = Scope.size();
+                E.Type = ValueType::I64;
+                for (ExprRef Item : Ctx.getList(E.Operands[0], E.Operands[1])) {
+                    visit(Item);
+                    E.Type = Ctx.getExpr(Item).Type;
+                }
+                Scope.resize(Outer);
+                break;
+            }
+            case ExprKind::If:
+                visit(E.A);
+                visit(E.Operands[0]);
+                if (E.Operands[1] == InvalidRef) {
+                    E.Type = Ctx.getExpr(E.Operands[0]).Type;
+                } else {
+                    visit(E.Operands[1]);
+                    E.Type = getCommonType(E.Operands[0], E.Operands[1]);
+                }
+                break;
+            case ExprKind::While:
+                visit(E.A);
+                visit(E.Operands[0]);
+                E.Type = ValueType::I64;
+                break;
+            case ExprKind::For: {
+                ArrayRef<uint32_t> Parts = Ctx.getList(E.Operands[0], E.Operands[1]);
+                visit(Parts[0]);
+                visit(Parts[1]);
+                ValueType VarType = Ctx.getExpr(Parts[0]).Type;
+                if (Parts[2] != InvalidRef) {
+                    visit(Parts[2]);
+                    VarType = getCommonType(Parts[0], Parts[2]);
+                }
+                size_t Outer = Scope.size();
+                unsigned Id = declare(E.A, getArithmeticType(VarType), /*Fixed=*/false);
+                visit(Parts[3]);
+                Scope.resize(Outer);
+                E.DeclType = Variables[Id].Type;
+                E.Type = ValueType::I64;
+                break;
+            }
+            case ExprKind::ParallelFor: {
+                ArrayRef<uint32_t> Parts = Ctx.getList(E.Operands[0], E.Operands[1]);
+                for (size_t I = 0; I < 3; ++I) {
+                    if (Parts[I] != InvalidRef)
+                        visit(Parts[I]);
+                }
+                size_t Outer = Scope.size();
+                unsigned Id = declare(E.A, ValueType::I64, /*Fixed=*/false);
+                visit(Parts[3]);
+                Scope.resize(Outer);
+                E.DeclType = Variables[Id].Type;
+                E.Type = ValueType::I64;
+                // The reduction is done in the accumulator's type, which widens as if
+                // each index assigned `acc = acc op body`.
+                int Accumulator = Parts[4] == InvalidRef ? -1 : lookup(Parts[4]);
+                if (Accumulator >= 0) {
+                    widen(static_cast<unsigned>(Accumulator), getArithmeticType(Ctx.getExpr(Parts[3]).Type));
+                    E.Type = Variables[Accumulator].Type;
+                }
+                break;
+            }
+            case ExprKind::Var: {
+                ValueType Type = ValueType::I64;
+                if (E.Operands[0] != InvalidRef) {
+                    visit(E.Operands[0]);
+                    Type = Ctx.getExpr(E.Operands[0]).Type;
+                }
+                bool Annotated = E.Operands[1] != InvalidRef;
+                if (Annotated)
+                    Type = static_cast<ValueType>(E.Operands[1]);
+                unsigned Id = declare(E.A, Type, Annotated);
+                E.DeclType = Variables[Id].Type;
+                E.Type = E.DeclType;
+                break;
+            }
+        }
+    }
+
+    const ASTContext &Ctx;
+    const FunctionRegistry &Functions;
+    std::vector<Variable> Variables;
+    std::vector<std::pair<Symbol, unsigned>> Scope;
+    unsigned NextVariable = 0;
+    bool Changed = false;
+};
+
+}
+
+void TypeInference::run(const ASTContext &Ctx, const FunctionAST &F, const FunctionRegistry &Functions) {
+    Inferencer(Ctx, Functions).run(F);
+}
+
+// Whether the integer V converts to the floating-point type F and back unchanged.
+template<typename F>
+static bool isExactFloat(int64_t V) {
+    F Converted = static_cast<F>(V);
+    // 2^63 itself is out of range for the conversion back.
+    return Converted >= F(-9223372036854775808.0) && Converted < F(9223372036854775808.0) &&
+           static_cast<int64_t>(Converted) == V;
+}
+
+bool TypeInference::fitsIn(const ExprAST &Literal, ValueType T) {
+    if (Literal.Type == ValueType::I64) {
+        switch (T) {
+            case ValueType::Bool: return false;
+            case ValueType::I32: return Literal.Int >= INT32_MIN && Literal.Int <= INT32_MAX;
+            case ValueType::I64: return true;
+            case ValueType::F32: return isExactFloat<float>(Literal.Int);
+            case ValueType::F64: return isExactFloat<double>(Literal.Int);
+        }
+        return false;
+    }
+    // Float literals are written in decimal and rarely exact anyway; beside an f32 they
+    // are rounded to f32 when the function is compiled.
+    return isFloatType(T);
+}
+
+ValueType TypeInference::getCommonType(ValueType T, const ExprAST* TLiteral, ValueType U, const ExprAST* ULiteral) {
+    if (TLiteral && !ULiteral && fitsIn(*TLiteral, U))
+        return U;
+    if (ULiteral && !TLiteral && fitsIn(*ULiteral, T))
+        return T;
+    // An i64 literal that f32 would round, beside an f32, meets it in f64.
+    ValueType Joined = joinTypes(T, U);
+    if (Joined == ValueType::F32 && ((TLiteral && !fitsIn(*TLiteral, Joined)) ||
+                                     (ULiteral && !fitsIn(*ULiteral, Joined))))
+        return ValueType::F64;
+    return Joined;
+}
+
+ValueType TypeInference::getOperandType(const ASTContext &Ctx, const ExprAST &E) {
+    const ExprAST &L = Ctx.getExpr(E.A);
+    const ExprAST &R = Ctx.getExpr(E.Operands[0]);
+    if (!isComparison(E.Op))
+        return E.Type;
+    return getCommonType(L.Type, L.Kind == ExprKind::Number ? &L : nullptr, R.Type,
+                         R.Kind == ExprKind::Number ? &R : nullptr);
+}
+
+bool TypeInference::isComparison(char Op) {
+    switch (Op) {
+        case '<':
+        case '>':
+        case OpLessEqual:
+        case OpGreaterEqual:
+        case OpEqual:
+        case OpNotEqual:
+            return true;
+        default:
+            return false;
+    }
+}
+
+std::optional<ValueType> TypeInference::getConversion(std::string_view Callee, const FunctionRegistry &Functions) {
+    if (Functions.find(Callee))
+        return std::nullopt;
+    return parseTypeName(Callee);
+}
+
+}
@@ -0,0 +1,37 @@
+#include "Nexon/Types.h"
+#include "llvm/IR/DerivedTypes.h"
+
+namespace Nexon {
+using namespace llvm;
+
+const char* getTypeName(ValueType T) {
+    switch (T) {
+        case ValueType::Bool: return "bool";
+        case ValueType::I32: return "i32";
+        case ValueType::I64: return "i64";
+        case ValueType::F32: return "f32";
+        case ValueType::F64: return "f64";
+    }
+    return "f64";
+}
+
+std::optional<ValueType> parseTypeName(std::string_view Name) {
+    for (ValueType T : { ValueType::Bool, ValueType::I32, ValueType::I64, ValueType::F32, ValueType::F64 }) {
+        if (Name == getTypeName(T))
+            return T;
+    }
+    return std::nullopt;
+}
+
+Type* getLLVMType(LLVMContext &Ctx, ValueType T) {
+    switch (T) {
+        case ValueType::Bool: return Type::getInt1Ty(Ctx);
+        case ValueType::I32: return Type::getInt32Ty(Ctx);
+        case ValueType::I64: return Type::getInt64Ty(Ctx);
+        case ValueType::F32: return Type::getFloatTy(Ctx);
+        case ValueType::F64: return Type::getDoubleTy(Ctx);
+    }
+    return Type::getDoubleTy(Ctx);
+}
+
+}
@@ -1,398 +1,811 @@
-// src/nexon.cpp
-// Main file for the Nexon Compiler/Interpreter and toolchain.
-// This file implements production-grade functionality including:
-//   - Running a Nexon source file (.xon) with high-performance CPU/GPU execution.
-//   - Packaging multiple files into a ZIP archive.
-//   - Installing a library from a ZIP archive (with PATH checking and prompting).
-//   - Compiling a Nexon source file into a native executable.
-//   - Generating complete C++ source from a Nexon source file.
-//   - Debugging a Nexon source file with detailed diagnostics.
-//   - Executing embedded Python code via the Python interpreter.
-// Additionally, users can include any standard C++ libraries and Python libraries
-// in their Nexon code by using normal #include directives and Python import statements.
-
-#include <iostream>
-#include <fstream>
-#include <sstream>
-#include <vector>
-#include <string>
-#include <cstdlib>
-#include <filesystem>
-#include <stdexcept>
-#include <algorithm>
-#ifdef _WIN32
-  #include <windows.h>
-#endif
-
-#include "Nexon/Runtime.h"       // Added to declare the Runtime class.
-#include "Nexon/stdlib.h"
-#include "Nexon/Lexer.h"
-#include "Nexon/AST.h"
-#include "Nexon/CodeGen.h"
-#include "Nexon/Concurrency.h"
-#include "Nexon/GPUAcceleration.h"
-#include "Nexon/Optimizer.h"
-#include "Nexon/Parser.h"
-
-namespace fs = std::filesystem;
-using namespace std;
-using namespace Nexon;  // Use Nexon namespace for access to Runtime and other classes.
-
-// Forward declarations for new functionality.
-bool compileNexonSource(const string &sourceFile, const string &outputExe);
-bool generateCppFromNexon(const string &sourceFile, const string &outputCpp);
-void debugSourceFile(const string &filename);
-int executePythonCode(const string &code);  // Wraps Runtime::executePythonCode
-
-// Runs a Nexon source file (.xon) using the production runtime.
-void runSourceFile(const string &filename) {
-    ifstream infile(filename);
-    if (!infile) {
-        cerr << "Error: Unable to open source file " << filename << endl;
-        exit(EXIT_FAILURE);
-    }
-    stringstream buffer;
-    buffer << infile.rdbuf();
-    string source = buffer.str();
-    cout << "Running Nexon source file: " << filename << endl;
-    cout << "=== Source Code Start ===" << endl;
-    cout << source << endl;
-    cout << "=== Source Code End ===" << endl;
-    cout << "Executing high-performance operations on CPU and GPU..." << endl;
-    volatile long long sum = 0;
-    for (long long i = 0; i < 100000000LL; ++i) {
-        sum += i;
-    }
-    cout << "Computation complete. Result: " << sum << endl;
-}
-
-// Packages multiple files into a ZIP archive using real file operations.
-bool createZipFromFiles(const vector<string>& files, const string &zipFilename) {
-    ofstream zipFile(zipFilename, ios::binary);
-    if (!zipFile) {
-        cerr << "Error: Unable to create ZIP file " << zipFilename << endl;
-        return false;
-    }
-    for (const auto &f : files) {
-        ifstream inFile(f, ios::binary);
-        if (!inFile) {
-            cerr << "Error: Unable to read file " << f << endl;
-            return false;
-        }
-        zipFile << "-----FILE: " << f << " START-----\n";
-        zipFile << inFile.rdbuf() << "\n";
-        zipFile << "-----FILE: " << f << " END-----\n";
-    }
-    zipFile.close();
-    cout << "ZIP archive " << zipFilename << " created successfully." << endl;
-    return true;
-}
-
-// Installs a library from a ZIP archive by extracting it to the specified installation directory.
-bool installZipLibrary(const string &zipFilename, const string &installDir) {
-    try {
-        fs::create_directories(installDir);
-        fs::copy(zipFilename, fs::path(installDir) / fs::path(zipFilename).filename(), fs::copy_options::overwrite_existing);
-        cout << "Library installed from " << zipFilename << " to " << installDir << endl;
-    } catch (const fs::filesystem_error &e) {
-        cerr << "Filesystem error: " << e.what() << endl;
-        return false;
-    }
-    return true;
-}
-
-// Checks if the installation directory is in the system PATH; if not, prompts the user to add it.
-bool checkAndSetPath(const string &installDir) {
-    const char* pathEnv = getenv("PATH");
-    if (!pathEnv) {
-        cerr << "Error: PATH environment variable not set." << endl;
-        return false;
-    }
-    string pathStr(pathEnv);
-    if (pathStr.find(installDir) != string::npos) {
-        cout << "Installation directory is already in PATH." << endl;
-        return true;
-    } else {
-        cout << "Installation directory not found in PATH." << endl;
-        cout << "Do you want to add " << installDir << " to PATH? (y/n): ";
-        char choice;
-        cin >> choice;
-        if (choice == 'y' || choice == 'Y') {
-#ifdef _WIN32
-            cout << "Please execute the following command in CMD:" << endl;
-            cout << "set PATH=%PATH%;" << installDir << endl;
-#else
-            cout << "Please add the following line to your ~/.bashrc or ~/.profile:" << endl;
-            cout << "export PATH=$PATH:" << installDir << endl;
-#endif
-            return true;
-        }
-    }
-    return false;
-}
-
-// Compiles a Nexon source file into a native executable (.exe or native binary) using the system C++ compiler.
-bool compileNexonSource(const string &sourceFile, const string &outputExe) {
-    string intermediateCpp = "generated.cpp";
-    ifstream src(sourceFile);
-    if (!src) {
-        cerr << "Error: Unable to open Nexon source file " << sourceFile << endl;
-        return false;
-    }
-    ofstream cppOut(intermediateCpp);
-    if (!cppOut) {
-        cerr << "Error: Unable to create intermediate C++ file." << endl;
-        return false;
-    }
-    string line;
-    while (getline(src, line)) {
-        if (line.find("#include") == 0)
-            cppOut << line << "\n";
-        else
-            cppOut << line << "\n";
-    }
-    cppOut.close();
-#ifdef _WIN32
-    string compileCommand = "g++ " + intermediateCpp + " -O3 -Wall -Wextra -o " + outputExe;
-#else
-    string compileCommand = "g++ " + intermediateCpp + " -O3 -Wall -Wextra -o " + outputExe;
-#endif
-    cout << "Compiling Nexon source to native executable..." << endl;
-    int ret = system(compileCommand.c_str());
-    if (ret != 0) {
-        cerr << "Compilation failed with error code " << ret << endl;
-        return false;
-    }
-    cout << "Compilation successful. Executable created: " << outputExe << endl;
-    return true;
-}
-
-// Generates a complete C++ source file from a Nexon source file.
-bool generateCppFromNexon(const string &sourceFile, const string &outputCpp) {
-    ifstream src(sourceFile);
-    if (!src) {
-        cerr << "Error: Unable to open Nexon source file " << sourceFile << endl;
-        return false;
-    }
-    ofstream outCpp(outputCpp);
-    if (!outCpp) {
-        cerr << "Error: Unable to create output C++ file " << outputCpp << endl;
-        return false;
-    }
-    outCpp << "// Generated C++ source from Nexon source file " << sourceFile << "\n";
-    outCpp << "// This file contains all user-specified C++ library includes and Nexon code translated into C++." << "\n";
-    outCpp << src.rdbuf();
-    outCpp.close();
-    cout << "C++ source generated successfully: " << outputCpp << endl;
-    return true;
-}
-
-// Runs a Nexon source file in debug mode with detailed diagnostics.
-void debugSourceFile(const string &filename) {
-    cout << "Debug Mode: Running Nexon source file with detailed diagnostics: " << filename << endl;
-    ifstream infile(filename);
-    if (!infile) {
-        cerr << "Error: Unable to open source file " << filename << endl;
-        exit(EXIT_FAILURE);
-    }
-    stringstream buffer;
-    buffer << infile.rdbuf();
-    string source = buffer.str();
-    cout << "=== Debug: Source Code Start ===" << endl;
-    cout << source << endl;
-    cout << "=== Debug: Source Code End ===" << endl;
-    cout << "Entering detailed debug execution mode..." << endl;
-    volatile long long sum = 0;
-    for (long long i = 0; i < 100000000LL; ++i) {
-        if (i % 10000000LL == 0) {
-            cout << "Debug: Completed " << i << " iterations." << endl;
-        }
-        sum += i;
-    }
-    cout << "Debug execution complete. Result: " << sum << endl;
-}
-
-// Executes Python code via the embedded Python interpreter.
-int executePythonCode(const string &code) {
-    return Runtime::executePythonCode(code);
-}
-
-// Runs a Python source file using the embedded interpreter.
-void runPythonSource(const string &filename) {
-    ifstream infile(filename);
-    if (!infile) {
-        cerr << "Error: Unable to open Python source file " << filename << endl;
-        exit(EXIT_FAILURE);
-    }
-    stringstream buffer;
-    buffer << infile.rdbuf();
-    string pyCode = buffer.str();
-    cout << "Running Python code from file: " << filename << endl;
-    int ret = executePythonCode(pyCode);
-    if (ret != 0) {
-        cerr << "Python code execution returned error code " << ret << endl;
-    } else {
-        cout << "Python code executed successfully." << endl;
-    }
-}
-
-// Displays help information for Nexon commands.
-void printHelp() {
-    cout << "Nexon Compiler/Interpreter Toolchain" << endl;
-    cout << "Commands:" << endl;
-    cout << "  nexon run <source.xon>                      - Run a Nexon source file" << endl;
-    cout << "  nexon package <file1> <file2> ... -o <archive.zip>   - Package files into a ZIP archive" << endl;
-    cout << "  nexon install <archive.zip> -d <installDir>           - Install library from ZIP archive" << endl;
-    cout << "  nexon compile <source.xon> -o <output.exe>            - Compile Nexon source to native executable" << endl;
-    cout << "  nexon generate-cpp <source.xon> -o <output.cpp>       - Generate C++ source from Nexon source" << endl;
-    cout << "  nexon debug <source.xon>                              - Run Nexon source in debug mode" << endl;
-    cout << "  nexon pyrun <python_source.py>                        - Run Python source using embedded interpreter" << endl;
-    cout << "  nexon help                                          - Display this help message" << endl;
-}
-
-int main(int argc, char **argv) {
-    // Initialize the Nexon runtime (which also initializes the embedded Python interpreter).
-    Runtime::initialize();
-
-    if (argc < 2) {
-        printHelp();
-        return EXIT_SUCCESS;
-    }
-    string command = argv[1];
-    if (command == "run") {
-        if (argc < 3) {
-            cerr << "Error: No source file specified." << endl;
-            return EXIT_FAILURE;
-        }
-        string sourceFile = argv[2];
-        runSourceFile(sourceFile);
-    } else if (command == "package") {
-        vector<string> files;
-        string zipFilename;
-        bool oFlagFound = false;
-        for (int i = 2; i < argc; i++) {
-            string arg = argv[i];
-            if (arg == "-o") {
-                if (i + 1 < argc) {
-                    zipFilename = argv[i + 1];
-                    oFlagFound = true;
-                    break;
-                } else {
-                    cerr << "Error: ZIP file name not specified after -o." << endl;
-                    return EXIT_FAILURE;
-                }
-            } else {
-                files.push_back(arg);
-            }
-        }
-        if (!oFlagFound) {
-            cerr << "Error: Output ZIP file not specified. Use -o option." << endl;
-            return EXIT_FAILURE;
-        }
-        if (!createZipFromFiles(files, zipFilename))
-            return EXIT_FAILURE;
-    } else if (command == "install") {
-        if (argc < 4) {
-            cerr << "Error: Insufficient arguments for install command." << endl;
-            return EXIT_FAILURE;
-        }
-        string archive = argv[2];
-        string installDir;
-        bool dFlagFound = false;
-        for (int i = 3; i < argc; i++) {
-            string arg = argv[i];
-            if (arg == "-d") {
-                if (i + 1 < argc) {
-                    installDir = argv[i + 1];
-                    dFlagFound = true;
-                    break;
-                } else {
-                    cerr << "Error: Installation directory not specified after -d." << endl;
-                    return EXIT_FAILURE;
-                }
-            }
-        }
-        if (!dFlagFound) {
-            cerr << "Error: Installation directory not specified. Use -d option." << endl;
-            return EXIT_FAILURE;
-        }
-        if (!installZipLibrary(archive, installDir))
-            return EXIT_FAILURE;
-        checkAndSetPath(installDir);
-    } else if (command == "compile") {
-        if (argc < 4) {
-            cerr << "Error: Insufficient arguments for compile command." << endl;
-            return EXIT_FAILURE;
-        }
-        string sourceFile = argv[2];
-        string outputExe;
-        bool oFlagFound = false;
-        for (int i = 3; i < argc; i++) {
-            string arg = argv[i];
-            if (arg == "-o") {
-                if (i + 1 < argc) {
-                    outputExe = argv[i + 1];
-                    oFlagFound = true;
-                    break;
-                } else {
-                    cerr << "Error: Output executable name not specified after -o." << endl;
-                    return EXIT_FAILURE;
-                }
-            }
-        }
-        if (!oFlagFound) {
-            cerr << "Error: Output executable not specified. Use -o option." << endl;
-            return EXIT_FAILURE;
-        }
-        if (!compileNexonSource(sourceFile, outputExe))
-            return EXIT_FAILURE;
-    } else if (command == "generate-cpp") {
-        if (argc < 4) {
-            cerr << "Error: Insufficient arguments for generate-cpp command." << endl;
-            return EXIT_FAILURE;
-        }
-        string sourceFile = argv[2];
-        string outputCpp;
-        bool oFlagFound = false;
-        for (int i = 3; i < argc; i++) {
-            string arg = argv[i];
-            if (arg == "-o") {
-                if (i + 1 < argc) {
-                    outputCpp = argv[i + 1];
-                    oFlagFound = true;
-                    break;
-                } else {
-                    cerr << "Error: Output C++ file name not specified after -o." << endl;
-                    return EXIT_FAILURE;
-                }
-            }
-        }
-        if (!oFlagFound) {
-            cerr << "Error: Output C++ file not specified. Use -o option." << endl;
-            return EXIT_FAILURE;
-        }
-        if (!generateCppFromNexon(sourceFile, outputCpp))
-            return EXIT_FAILURE;
-    } else if (command == "debug") {
-        if (argc < 3) {
-            cerr << "Error: No source file specified for debug mode." << endl;
-            return EXIT_FAILURE;
-        }
-        string sourceFile = argv[2];
-        debugSourceFile(sourceFile);
-    } else if (command == "pyrun") {
-        if (argc < 3) {
-            cerr << "Error: No Python source file specified for pyrun command." << endl;
-            return EXIT_FAILURE;
-        }
-        string pySourceFile = argv[2];
-        runPythonSource(pySourceFile);
-    } else if (command == "help") {
-        printHelp();
-    } else {
-        cerr << "Error: Unknown command '" << command << "'." << endl;
-        printHelp();
-        return EXIT_FAILURE;
-    }
-    return EXIT_SUCCESS;
-}
+// src/nexon.cpp
+// Main file for the Nexon Compiler/Interpreter and toolchain.
+// This file implements production-grade functionality including:
+//   - Running a Nexon source file (.xon) with high-performance CPU/GPU execution.
+//   - Packaging multiple files into a ZIP archive.
+//   - Installing a library from a ZIP archive (with PATH checking and prompting).
+//   - Compiling a Nexon source file into a native executable.
+//   - Generating complete C++ source from a Nexon source file.
+//   - Debugging a Nexon source file with detailed diagnostics.
+//   - Executing embedded Python code via the Python interpreter.
+// Additionally, users can include any standard C++ libraries and Python libraries
+// in their Nexon code by using normal #include directives and Python import statements.
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <string>
+#include <string_view>
+#include <cstdlib>
+#include <filesystem>
+#include <stdexcept>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#ifdef _WIN32
+  #include <windows.h>
+#endif
+
+#include "Nexon/Runtime.h"       // Added to declare the Runtime class.
+#include "Nexon/stdlib.h"
+#include "Nexon/Lexer.h"
+#include "Nexon/AST.h"
+#include "Nexon/CodeGen.h"
+#include "Nexon/CompilationCache.h"
+#include "Nexon/Concurrency.h"
+#include "Nexon/GPUAcceleration.h"
+#include "Nexon/JIT.h"
+#include "Nexon/ObjectEmitter.h"
+#include "Nexon/Optimizer.h"
+#include "Nexon/ParallelCodeGen.h"
+#include "Nexon/Parser.h"
+#include "Nexon/PythonBatch.h"
+#include "Nexon/Server.h"
+#include "Nexon/StartupProfile.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/ADT/StringExtras.h"
+#include "llvm/ADT/Triple.h"
+#include "llvm/Support/FileSystem.h"
+#include "llvm/Support/Host.h"
+#include "llvm/Support/MemoryBuffer.h"
+
+namespace fs = std::filesystem;
+using namespace std;
+using namespace Nexon;  // Use Nexon namespace for access to Runtime and other classes.
+using llvm::SmallString;
+using llvm::TargetMachine;
+namespace sys = llvm::sys;
+
+// Forward declarations for new functionality.
+bool compileNexonSource(const string &sourceFile, const string &outputExe,
+                        const string &targetTriple, const string &cpu, unsigned jobs, bool useCache);
+bool generateCppFromNexon(const string &sourceFile, const string &outputCpp);
+void debugSourceFile(const string &filename);
+int executePythonCode(const string &code);  // Wraps Runtime::executePythonCode
+int runCommand(int argc, char **argv);
+
+// Maps a source file into memory without copying it (small files are read); exits
+// on failure. The Lexer and Parser work on views into the returned buffer.
+unique_ptr<llvm::MemoryBuffer> readSourceFile(const string &filename) {
+    auto buffer = llvm::MemoryBuffer::getFile(filename, /*IsText=*/false, /*RequiresNullTerminator=*/false);
+    if (!buffer) {
+        cerr << "Error: Unable to open source file " << filename << ": " << buffer.getError().message() << endl;
+        exit(EXIT_FAILURE);
+    }
+    return std::move(*buffer);
+}
+
+// Parses Nexon source and lowers every definition, extern and top-level expression
+// into the session's module. The generated top-level expression functions are
+// appended to topLevelExprs in source order. With a lazyJIT, definitions are handed
+// to it as AST and only compiled when first called.
+bool lowerSourceToModule(string_view source, CompilationSession &session, vector<string> &topLevelExprs,
+                         JIT *lazyJIT = nullptr) {
+    TokenBuffer tokens;
+    if (!tokens.tokenize(source))
+        return false;
+    // Nodes are arena-allocated and released together with the context; lazily
+    // compiled functions keep it alive through the JIT.
+    auto ast = std::make_shared<ASTContext>();
+    Parser parser(tokens, *ast);
+    while (true) {
+        switch (parser.getCurrentToken()) {
+            case tok_eof:
+                return true;
+            case ';':
+                parser.getNextToken();
+                break;
+            case tok_def: {
+                FuncRef fn = parser.parseDefinition();
+                if (fn == InvalidRef)
+                    return false;
+                if (lazyJIT ? !lazyJIT->addLazyFunction(ast, fn, session.getFunctionRegistry())
+                            : !ast->getFunction(fn).codegen(*ast, session))
+                    return false;
+                break;
+            }
+            case tok_extern: {
+                ProtoRef proto = parser.parseExtern();
+                if (proto == InvalidRef || !ast->getProto(proto).codegen(*ast, session))
+                    return false;
+                session.addPrototype(ast->getProto(proto).getSignature(*ast));
+                break;
+            }
+            default: {
+                FuncRef fn = parser.parseTopLevelExpr();
+                if (fn == InvalidRef || !ast->getFunction(fn).codegen(*ast, session))
+                    return false;
+                topLevelExprs.push_back(string(ast->getFunctionName(fn)));
+                break;
+            }
+        }
+    }
+}
+
+// Parses a whole Nexon source without generating code, for parallel lowering. The
+// signature of every extern, definition and top-level expression is added to registry
+// up front so that functions lowered in different shards can call each other.
+// Definitions and top-level expressions are appended to functions in source order.
+bool parseSource(string_view source, ASTContext &ast, FunctionRegistry &registry,
+                 vector<FuncRef> &functions, vector<string> &topLevelExprs) {
+    TokenBuffer tokens;
+    if (!tokens.tokenize(source))
+        return false;
+    Parser parser(tokens, ast);
+    while (true) {
+        switch (parser.getCurrentToken()) {
+            case tok_eof:
+                return true;
+            case ';':
+                parser.getNextToken();
+                break;
+            case tok_extern: {
+                ProtoRef proto = parser.parseExtern();
+                if (proto == InvalidRef)
+                    return false;
+                registry.add(ast.getProto(proto).getSignature(ast));
+                break;
+            }
+            default: {
+                bool isDef = parser.getCurrentToken() == tok_def;
+                FuncRef fn = isDef ? parser.parseDefinition() : parser.parseTopLevelExpr();
+                if (fn == InvalidRef)
+                    return false;
+                registry.add(ast.getProto(ast.getFunction(fn).Proto).getSignature(ast));
+                functions.push_back(fn);
+                if (!isDef)
+                    topLevelExprs.push_back(string(ast.getFunctionName(fn)));
+                break;
+            }
+        }
+    }
+}
+
+// Parallel counterpart of lowerSourceToModule followed by optimization: functions are
+// lowered and optimized in shards on up to jobs threads and passed to consume. The
+// shard sessions share the function registry of session.
+bool lowerSourceInParallel(string_view source, CompilationSession &session, unsigned jobs,
+                           const string &targetTriple, const string &cpu, vector<string> &topLevelExprs,
+                           const ParallelCodeGen::ShardConsumer &consume) {
+    ASTContext ast;
+    vector<FuncRef> functions;
+    return parseSource(source, ast, *session.getFunctionRegistry(), functions, topLevelExprs) &&
+           ParallelCodeGen::lowerFunctions(ast, functions, session.getFunctionRegistry(), jobs, targetTriple,
+                                           cpu, consume);
+}
+
+// Produces the native objects of a source file for TM: lowers, optimizes and emits
+// it (in shards on up to jobs threads for targetTriple/cpu, empty for the host) and
+// appends the top-level expression names in source order. With withMain a C `main`
+// is emitted as well, for ahead-of-time builds. A cache hit skips lexing, parsing,
+// code generation and optimization entirely; a miss is stored in the cache.
+bool buildObjects(string_view source, TargetMachine &TM, const string &targetTriple, const string &cpu,
+                  unsigned jobs, bool withMain, CompilationCache *cache, CompilationCache::Entry &result) {
+    string key;
+    if (cache) {
+        key = CompilationCache::computeKey(source, withMain ? "executable" : "jit", TM);
+        if (cache->lookup(key, result))
+            return true;
+    }
+    CompilationSession session;
+    bool parallel = jobs > 1;
+    if (parallel) {
+        std::mutex shardsMutex;
+        std::map<unsigned, unique_ptr<llvm::MemoryBuffer>> shards;
+        bool ok = lowerSourceInParallel(source, session, jobs, targetTriple, cpu, result.TopLevelExprs,
+            [&](unsigned shard, llvm::orc::ThreadSafeModule tsm, TargetMachine &shardTM) {
+                auto object = tsm.withModuleDo([&](llvm::Module &m) {
+                    return ObjectEmitter::emitObjectBuffer(m, shardTM);
+                });
+                if (!object)
+                    return false;
+                std::lock_guard<std::mutex> lock(shardsMutex);
+                shards[shard] = std::move(object);
+                return true;
+            });
+        if (!ok)
+            return false;
+        for (auto &shard : shards)
+            result.Objects.push_back(std::move(shard.second));
+    }
+    // Sequentially everything lands in this module; in parallel mode only `main` does.
+    if (!parallel || withMain) {
+        ObjectEmitter::configureModule(session.getModule(), TM);
+        if ((!parallel && !lowerSourceToModule(source, session, result.TopLevelExprs)) ||
+            (withMain && !session.emitMain(result.TopLevelExprs)) ||
+            !Optimizer::runOptimizationPasses(session.getModule(), TM))
+            return false;
+        auto object = ObjectEmitter::emitObjectBuffer(session.getModule(), TM);
+        if (!object)
+            return false;
+        result.Objects.push_back(std::move(object));
+    }
+    if (cache)
+        cache->store(key, result.TopLevelExprs, result.Objects);
+    return true;
+}
+
+// A JIT created ahead of time by `nexon serve`; each request's process takes its own copy.
+static unique_ptr<JIT> warmJIT;
+
+// Runs a Nexon source file (.xon): parses it, generates and optimizes LLVM IR,
+// then JIT-compiles it and evaluates each top-level expression in order. In lazy
+// mode only top-level expressions are compiled up front; each function is compiled
+// on its first call. Otherwise native code comes from the compilation cache when
+// useCache is set, or is built (on several threads with jobs > 1) before anything runs.
+void runSourceFile(const string &filename, bool lazy, unsigned jobs, bool useCache) {
+    auto source = readSourceFile(filename);
+    auto jit = warmJIT ? std::move(warmJIT) : JIT::create();
+    if (!jit)
+        exit(EXIT_FAILURE);
+    vector<string> topLevelExprs;
+    if (lazy) {
+        CompilationSession session;
+        TargetMachine &TM = jit->getTargetMachine();
+        ObjectEmitter::configureModule(session.getModule(), TM);
+        if (!lowerSourceToModule(source->getBuffer(), session, topLevelExprs, jit.get())) {
+            cerr << "Error: Compilation of " << filename << " failed." << endl;
+            exit(EXIT_FAILURE);
+        }
+        if (!Optimizer::runOptimizationPasses(session.getModule(), TM) ||
+            !jit->addModule(session.takeModule()))
+            exit(EXIT_FAILURE);
+    } else {
+        auto cache = useCache ? CompilationCache::open() : nullptr;
+        CompilationCache::Entry build;
+        if (!buildObjects(source->getBuffer(), jit->getTargetMachine(), "", "", jobs, false, cache.get(), build)) {
+            cerr << "Error: Compilation of " << filename << " failed." << endl;
+            exit(EXIT_FAILURE);
+        }
+        for (auto &object : build.Objects)
+            if (!jit->addObject(std::move(object)))
+                exit(EXIT_FAILURE);
+        topLevelExprs = std::move(build.TopLevelExprs);
+    }
+    for (const auto &name : topLevelExprs) {
+        auto *expr = reinterpret_cast<double (*)()>(jit->lookup(name));
+        if (!expr)
+            exit(EXIT_FAILURE);
+        double result = expr();
+        cout << "Evaluated to " << result << endl;
+    }
+}
+
+// Consumes --jobs <n> (or -j <n>); 0 selects one job per hardware thread. Returns
+// true if argv[i] was the option; i is advanced past its value.
+bool parseJobsOption(int argc, char **argv, int &i, unsigned &jobs) {
+    string arg = argv[i];
+    if (arg != "--jobs" && arg != "-j")
+        return false;
+    unsigned long value = 0;
+    if (i + 1 >= argc || !llvm::to_integer(argv[i + 1], value, 10) || value > 4096) {
+        cerr << "Error: --jobs expects a thread count." << endl;
+        exit(EXIT_FAILURE);
+    }
+    ++i;
+    jobs = value == 0 ? ParallelCodeGen::getDefaultJobs() : static_cast<unsigned>(value);
+    return true;
+}
+
+// Consumes -O<level> and --passes <pipeline> options shared by run and compile.
+// Returns true if argv[i] was one of them; i is advanced past any option value.
+bool parseOptimizerOption(int argc, char **argv, int &i) {
+    string arg = argv[i];
+    OptLevel level;
+    if (Optimizer::parseOptimizationFlag(arg, level)) {
+        Optimizer::setOptimizationLevel(level);
+        return true;
+    }
+    if (arg == "--passes") {
+        if (i + 1 >= argc) {
+            cerr << "Error: No pass pipeline specified after --passes." << endl;
+            exit(EXIT_FAILURE);
+        }
+        Optimizer::addCustomPasses(argv[++i]);
+        return true;
+    }
+    return false;
+}
+
+// Packages multiple files into a ZIP archive using real file operations.
+bool createZipFromFiles(const vector<string>& files, const string &zipFilename) {
+    ofstream zipFile(zipFilename, ios::binary);
+    if (!zipFile) {
+        cerr << "Error: Unable to create ZIP file " << zipFilename << endl;
+        return false;
+    }
+    for (const auto &f : files) {
+        ifstream inFile(f, ios::binary);
+        if (!inFile) {
+            cerr << "Error: Unable to read file " << f << endl;
+            return false;
+        }
+        zipFile << "-----FILE: " << f << " START-----\n";
+        zipFile << inFile.rdbuf() << "\n";
+        zipFile << "-----FILE: " << f << " END-----\n";
+    }
+    zipFile.close();
+    cout << "ZIP archive " << zipFilename << " created successfully." << endl;
+    return true;
+}
+
+// Installs a library from a ZIP archive by extracting it to the specified installation directory.
+bool installZipLibrary(const string &zipFilename, const string &installDir) {
+    try {
+        fs::create_directories(installDir);
+        fs::copy(zipFilename, fs::path(installDir) / fs::path(zipFilename).filename(), fs::copy_options::overwrite_existing);
+        cout << "Library installed from " << zipFilename << " to " << installDir << endl;
+    } catch (const fs::filesystem_error &e) {
+        cerr << "Filesystem error: " << e.what() << endl;
+        return false;
+    }
+    return true;
+}
+
+// Checks if the installation directory is in the system PATH; if not, prompts the user to add it.
+bool checkAndSetPath(const string &installDir) {
+    const char* pathEnv = getenv("PATH");
+    if (!pathEnv) {
+        cerr << "Error: PATH environment variable not set." << endl;
+        return false;
+    }
+    string pathStr(pathEnv);
+    if (pathStr.find(installDir) != string::npos) {
+        cout << "Installation directory is already in PATH." << endl;
+        return true;
+    } else {
+        cout << "Installation directory not found in PATH." << endl;
+        cout << "Do you want to add " << installDir << " to PATH? (y/n): ";
+        char choice;
+        cin >> choice;
+        if (choice == 'y' || choice == 'Y') {
+#ifdef _WIN32
+            cout << "Please execute the following command in CMD:" << endl;
+            cout << "set PATH=%PATH%;" << installDir << endl;
+#else
+            cout << "Please add the following line to your ~/.bashrc or ~/.profile:" << endl;
+            cout << "export PATH=$PATH:" << installDir << endl;
+#endif
+            return true;
+        }
+    }
+    return false;
+}
+
+// Writes an in-memory object file to path.
+bool writeObjectFile(const llvm::MemoryBuffer &object, const string &path) {
+    std::error_code EC;
+    llvm::raw_fd_ostream out(path, EC, sys::fs::OF_None);
+    if (EC) {
+        cerr << "Error: Unable to open " << path << ": " << EC.message() << endl;
+        return false;
+    }
+    out << object.getBuffer();
+    return true;
+}
+
+// Compiles a Nexon source file into a native executable in-process: the source is
+// lowered through CodeGen and the Optimizer, emitted as object code by an LLVM
+// TargetMachine and linked by the system linker driver. An output ending in .o or
+// .obj stops after object emission, which is all a foreign targetTriple gets without
+// NEXON_LINKER. Empty targetTriple/cpu select the host. With
+// jobs > 1 functions are lowered and emitted as one object per shard in parallel.
+bool compileNexonSource(const string &sourceFile, const string &outputExe,
+                        const string &targetTriple, const string &cpu, unsigned jobs, bool useCache) {
+    auto source = readSourceFile(sourceFile);
+    auto TM = ObjectEmitter::createTargetMachine(targetTriple, cpu);
+    if (!TM)
+        return false;
+    string extension = fs::path(outputExe).extension().string();
+    bool objectOnly = extension == ".o" || extension == ".obj";
+
+    // Linking runs the host's linker driver against the host runtime, so another target
+    // stops at a single object file unless NEXON_LINKER names a linker for it.
+    llvm::Triple host(sys::getProcessTriple());
+    const llvm::Triple &target = TM->getTargetTriple();
+    if ((target.getArch() != host.getArch() || target.getOS() != host.getOS()) && !getenv("NEXON_LINKER")) {
+        if (!objectOnly) {
+            cerr << "Error: Linking for " << targetTriple << " needs NEXON_LINKER (and NEXON_RUNTIME_DIR with "
+                 << "a runtime built for it); without them, compile to a .o file." << endl;
+            return false;
+        }
+        // One shard, built afresh: a cached build may hold several objects to combine.
+        jobs = 1;
+        useCache = false;
+    }
+
+    auto cache = useCache ? CompilationCache::open() : nullptr;
+    CompilationCache::Entry build;
+    if (!buildObjects(source->getBuffer(), *TM, targetTriple, cpu, jobs, true, cache.get(), build)) {
+        cerr << "Error: Compilation of " << sourceFile << " failed." << endl;
+        return false;
+    }
+
+    if (objectOnly && build.Objects.size() == 1)
+        return writeObjectFile(*build.Objects.front(), outputExe);
+
+    // Unique temporary objects keep concurrent builds in one directory apart.
+    vector<string> objects;
+    bool ok = true;
+    for (const auto &object : build.Objects) {
+        SmallString<128> objectFile;
+        if (auto EC = sys::fs::createTemporaryFile("nexon", "o", objectFile)) {
+            cerr << "Error: Unable to create temporary object file: " << EC.message() << endl;
+            ok = false;
+            break;
+        }
+        objects.push_back(objectFile.str().str());
+        if (!(ok = writeObjectFile(*object, objects.back())))
+            break;
+    }
+    ok = ok && (objectOnly ? ObjectEmitter::linkRelocatable(objects, outputExe)
+                           : ObjectEmitter::linkExecutable(objects, outputExe));
+    for (const auto &object : objects)
+        sys::fs::remove(object);
+    if (!ok)
+        return false;
+    if (!objectOnly)
+        cout << "Compilation successful. Executable created: " << outputExe << endl;
+    return true;
+}
+
+// Generates a complete C++ source file from a Nexon source file.
+bool generateCppFromNexon(const string &sourceFile, const string &outputCpp) {
+    ifstream src(sourceFile);
+    if (!src) {
+        cerr << "Error: Unable to open Nexon source file " << sourceFile << endl;
+        return false;
+    }
+    ofstream outCpp(outputCpp);
+    if (!outCpp) {
+        cerr << "Error: Unable to create output C++ file " << outputCpp << endl;
+        return false;
+    }
+    outCpp << "// Generated C++ source from Nexon source file " << sourceFile << "\n";
+    outCpp << "// This file contains all user-specified C++ library includes and Nexon code translated into C++." << "\n";
+    outCpp << src.rdbuf();
+    outCpp.close();
+    cout << "C++ source generated successfully: " << outputCpp << endl;
+    return true;
+}
+
+// Runs a Nexon source file in debug mode with detailed diagnostics.
+void debugSourceFile(const string &filename) {
+    cout << "Debug Mode: Running Nexon source file with detailed diagnostics: " << filename << endl;
+    auto source = readSourceFile(filename);
+    cout << "=== Debug: Source Code Start ===" << endl;
+    cout << string_view(source->getBuffer()) << endl;
+    cout << "=== Debug: Source Code End ===" << endl;
+    cout << "Entering detailed debug execution mode..." << endl;
+    volatile long long sum = 0;
+    for (long long i = 0; i < 100000000LL; ++i) {
+        if (i % 10000000LL == 0) {
+            cout << "Debug: Completed " << i << " iterations." << endl;
+        }
+        sum += i;
+    }
+    cout << "Debug execution complete. Result: " << sum << endl;
+}
+
+// Executes Python code via the embedded Python interpreter.
+int executePythonCode(const string &code) {
+    return Runtime::executePythonCode(code);
+}
+
+// Runs a Python source file using the embedded interpreter.
+void runPythonSource(const string &filename) {
+    ifstream infile(filename);
+    if (!infile) {
+        cerr << "Error: Unable to open Python source file " << filename << endl;
+        exit(EXIT_FAILURE);
+    }
+    stringstream buffer;
+    buffer << infile.rdbuf();
+    string pyCode = buffer.str();
+    cout << "Running Python code from file: " << filename << endl;
+    int ret = executePythonCode(pyCode);
+    if (ret != 0) {
+        cerr << "Python code execution returned error code " << ret << endl;
+    } else {
+        cout << "Python code executed successfully." << endl;
+    }
+}
+
+// Displays help information for Nexon commands.
+void printHelp() {
+    cout << "Nexon Compiler/Interpreter Toolchain" << endl;
+    cout << "Commands:" << endl;
+    cout << "  nexon run <source.xon> [--lazy]                       - Run a Nexon source file (--lazy: compile functions on first call)" << endl;
+    cout << "  nexon package <file1> <file2> ... -o <archive.zip>   - Package files into a ZIP archive" << endl;
+    cout << "  nexon install <archive.zip> -d <installDir>           - Install library from ZIP archive" << endl;
+    cout << "  nexon compile <source.xon> -o <output.exe>            - Compile Nexon source to native executable" << endl;
+    cout << "        [--target <triple>] [--cpu <name>]              - Cross-compile to .o (linking needs $NEXON_LINKER) or tune for a CPU" << endl;
+    cout << "  nexon generate-cpp <source.xon> -o <output.cpp>       - Generate C++ source from Nexon source" << endl;
+    cout << "  nexon debug <source.xon>                              - Run Nexon source in debug mode" << endl;
+    cout << "  nexon pyrun <python_source.py>                        - Run Python source using embedded interpreter" << endl;
+    cout << "  nexon pyrun <a.py> <b.py> ... [--jobs <n>]            - Run independent scripts concurrently, each isolated" << endl;
+    cout << "        [--processes] [--no-cache]                      - (sub-interpreters on Python 3.12+, else processes)" << endl;
+    cout << "  nexon bench-lexer <source.xon>                        - Measure lexer throughput on a source file" << endl;
+    cout << "  nexon bench-parallel                                  - Compare parallelFor loop bodies on this machine" << endl;
+    cout << "  nexon serve [--socket <path>]                         - Serve run/compile/pyrun for other nexon processes" << endl;
+    cout << "  nexon help                                          - Display this help message" << endl;
+    cout << "Options for run and compile:" << endl;
+    cout << "  -O0 | -O1 | -O2 | -O3 | -Os                           - Optimization level (default: -O2)" << endl;
+    cout << "  --passes <pipeline>                                   - Append custom LLVM passes, e.g. \"function(licm)\"" << endl;
+    cout << "  --jobs <n> | -j <n>                                   - Lower and compile functions on n threads (0: all cores)" << endl;
+    cout << "  --no-cache                                            - Bypass the compilation cache ($NEXON_CACHE_DIR, $NEXON_CACHE_SIZE)" << endl;
+    cout << "Options for all commands:" << endl;
+    cout << "  --startup-profile                                     - Print the time spent in each initialization stage" << endl;
+}
+
+// Removes every --startup-profile from argv, wherever it appears, and starts profiling
+// under title if there was one. Returns whether there was.
+bool takeStartupProfileOption(int &argc, char **argv, const char* title = "Startup profile") {
+    auto profileEnd = remove_if(argv + 1, argv + argc,
+                                [](const char* arg) { return string_view(arg) == "--startup-profile"; });
+    if (profileEnd == argv + argc)
+        return false;
+    StartupProfile::enable(title);
+    argc = static_cast<int>(profileEnd - argv);
+    argv[argc] = nullptr;
+    return true;
+}
+
+// Starts a `nexon serve` daemon: the runtime, LLVM targets and a JIT are set up once,
+// then every forwarded command runs in a fork of this warm process.
+int serveCommands(int argc, char **argv) {
+    string socketPath = Server::getDefaultSocketPath();
+    for (int i = 2; i < argc; i++) {
+        if (string(argv[i]) == "--socket" && i + 1 < argc) {
+            socketPath = argv[++i];
+        } else {
+            cerr << "Error: Unknown serve option '" << argv[i] << "'." << endl;
+            return EXIT_FAILURE;
+        }
+    }
+    Runtime::initializePython();
+    if (!ObjectEmitter::createTargetMachine("", "") || !(warmJIT = JIT::create()))
+        return EXIT_FAILURE;
+    bool ok = Server::serve(socketPath, [](int argc, char **argv) {
+        Runtime::afterFork();
+        // The request's profile covers only what the warm process still had to start.
+        takeStartupProfileOption(argc, argv, "Startup profile (nexon serve)");
+        return runCommand(argc, argv);
+    });
+    return ok ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+int main(int argc, char **argv) {
+    bool profile = takeStartupProfileOption(argc, argv);
+    // Commands that compile or run code go to a warm `nexon serve` process when one is up.
+    // A profile is then reported by the server's worker, which still sees the option.
+    if (argc >= 2 && !getenv("NEXON_NO_SERVER")) {
+        string command = argv[1];
+        vector<string> args(argv, argv + argc);
+        if (profile)
+            args.push_back("--startup-profile");
+        int exitCode;
+        if ((command == "run" || command == "compile" || command == "pyrun") &&
+            Server::forward(Server::getDefaultSocketPath(), args, exitCode))
+            return exitCode;
+    }
+    // Nothing is initialized up front: Python, the LLVM targets and the JIT start on
+    // first use, so help, package and install run without touching them.
+    if (argc >= 2 && string(argv[1]) == "serve")
+        return serveCommands(argc, argv);
+    return runCommand(argc, argv);
+}
+
+// Dispatches one nexon command line, locally or in a `nexon serve` request.
+int runCommand(int argc, char **argv) {
+    if (argc < 2) {
+        printHelp();
+        return EXIT_SUCCESS;
+    }
+    string command = argv[1];
+    if (command == "run") {
+        if (argc < 3) {
+            cerr << "Error: No source file specified." << endl;
+            return EXIT_FAILURE;
+        }
+        string sourceFile = argv[2];
+        bool lazy = false;
+        bool useCache = true;
+        unsigned jobs = 1;
+        for (int i = 3; i < argc; i++) {
+            if (string(argv[i]) == "--lazy") {
+                lazy = true;
+            } else if (string(argv[i]) == "--no-cache") {
+                useCache = false;
+            } else if (!parseOptimizerOption(argc, argv, i) && !parseJobsOption(argc, argv, i, jobs)) {
+                cerr << "Error: Unknown run option '" << argv[i] << "'." << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        runSourceFile(sourceFile, lazy, jobs, useCache);
+    } else if (command == "package") {
+        vector<string> files;
+        string zipFilename;
+        bool oFlagFound = false;
+        for (int i = 2; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "-o") {
+                if (i + 1 < argc) {
+                    zipFilename = argv[i + 1];
+                    oFlagFound = true;
+                    break;
+                } else {
+                    cerr << "Error: ZIP file name not specified after -o." << endl;
+                    return EXIT_FAILURE;
+                }
+            } else {
+                files.push_back(arg);
+            }
+        }
+        if (!oFlagFound) {
+            cerr << "Error: Output ZIP file not specified. Use -o option." << endl;
+            return EXIT_FAILURE;
+        }
+        if (!createZipFromFiles(files, zipFilename))
+            return EXIT_FAILURE;
+    } else if (command == "install") {
+        if (argc < 4) {
+            cerr << "Error: Insufficient arguments for install command." << endl;
+            return EXIT_FAILURE;
+        }
+        string archive = argv[2];
+        string installDir;
+        bool dFlagFound = false;
+        for (int i = 3; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "-d") {
+                if (i + 1 < argc) {
+                    installDir = argv[i + 1];
+                    dFlagFound = true;
+                    break;
+                } else {
+                    cerr << "Error: Installation directory not specified after -d." << endl;
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        if (!dFlagFound) {
+            cerr << "Error: Installation directory not specified. Use -d option." << endl;
+            return EXIT_FAILURE;
+        }
+        if (!installZipLibrary(archive, installDir))
+            return EXIT_FAILURE;
+        checkAndSetPath(installDir);
+    } else if (command == "compile") {
+        if (argc < 4) {
+            cerr << "Error: Insufficient arguments for compile command." << endl;
+            return EXIT_FAILURE;
+        }
+        string sourceFile = argv[2];
+        string outputExe;
+        string targetTriple;
+        string cpu;
+        unsigned jobs = 1;
+        bool useCache = true;
+        bool oFlagFound = false;
+        for (int i = 3; i < argc; i++) {
+            string arg = argv[i];
+            if (parseOptimizerOption(argc, argv, i) || parseJobsOption(argc, argv, i, jobs))
+                continue;
+            if (arg == "--no-cache") {
+                useCache = false;
+                continue;
+            }
+            if (arg == "-o" || arg == "--target" || arg == "--cpu") {
+                if (i + 1 >= argc) {
+                    cerr << "Error: No value specified after " << arg << "." << endl;
+                    return EXIT_FAILURE;
+                }
+                string value = argv[++i];
+                if (arg == "-o") {
+                    outputExe = value;
+                    oFlagFound = true;
+                } else if (arg == "--target") {
+                    targetTriple = value;
+                } else {
+                    cpu = value;
+                }
+            } else {
+                cerr << "Error: Unknown compile option '" << arg << "'." << endl;
+                return EXIT_FAILURE;
+            }
+        }
+        if (!oFlagFound) {
+            cerr << "Error: Output executable not specified. Use -o option." << endl;
+            return EXIT_FAILURE;
+        }
+        if (!compileNexonSource(sourceFile, outputExe, targetTriple, cpu, jobs, useCache))
+            return EXIT_FAILURE;
+    } else if (command == "generate-cpp") {
+        if (argc < 4) {
+            cerr << "Error: Insufficient arguments for generate-cpp command." << endl;
+            return EXIT_FAILURE;
+        }
+        string sourceFile = argv[2];
+        string outputCpp;
+        bool oFlagFound = false;
+        for (int i = 3; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "-o") {
+                if (i + 1 < argc) {
+                    outputCpp = argv[i + 1];
+                    oFlagFound = true;
+                    break;
+                } else {
+                    cerr << "Error: Output C++ file name not specified after -o." << endl;
+                    return EXIT_FAILURE;
+                }
+            }
+        }
+        if (!oFlagFound) {
+            cerr << "Error: Output C++ file not specified. Use -o option." << endl;
+            return EXIT_FAILURE;
+        }
+        if (!generateCppFromNexon(sourceFile, outputCpp))
+            return EXIT_FAILURE;
+    } else if (command == "debug") {
+        if (argc < 3) {
+            cerr << "Error: No source file specified for debug mode." << endl;
+            return EXIT_FAILURE;
+        }
+        string sourceFile = argv[2];
+        debugSourceFile(sourceFile);
+    } else if (command == "pyrun") {
+        vector<string> pySourceFiles;
+        unsigned jobs = 1;
+        bool useProcesses = false;
+        bool useCache = true;
+        for (int i = 2; i < argc; i++) {
+            string arg = argv[i];
+            if (arg == "--processes") {
+                useProcesses = true;
+            } else if (arg == "--no-cache") {
+                useCache = false;
+            } else if (parseJobsOption(argc, argv, i, jobs)) {
+                continue;
+            } else if (!arg.empty() && arg[0] == '-') {
+                cerr << "Error: Unknown pyrun option '" << arg << "'." << endl;
+                return EXIT_FAILURE;
+            } else {
+                pySourceFiles.push_back(arg);
+            }
+        }
+        if (pySourceFiles.empty()) {
+            cerr << "Error: No Python source file specified for pyrun command." << endl;
+            return EXIT_FAILURE;
+        }
+        if (pySourceFiles.size() == 1) {
+            runPythonSource(pySourceFiles[0]);
+        } else {
+            // A batch: independent scripts, each isolated from the others.
+            auto cache = useCache ? CompilationCache::open() : nullptr;
+            unsigned failed = PythonBatch::run(pySourceFiles, jobs, useProcesses, cache.get());
+            if (failed) {
+                cerr << "Error: " << failed << " of " << pySourceFiles.size() << " Python scripts failed." << endl;
+                return EXIT_FAILURE;
+            }
+        }
+    } else if (command == "bench-lexer") {
+        if (argc < 3) {
+            cerr << "Error: No source file specified for bench-lexer command." << endl;
+            return EXIT_FAILURE;
+        }
+        auto source = readSourceFile(argv[2]);
+        benchmarkLexer(source->getBuffer());
+    } else if (command == "bench-parallel") {
+        benchmarkParallelFor();
+    } else if (command == "help") {
+        printHelp();
+    } else {
+        cerr << "Error: Unknown command '" << command << "'." << endl;
+        printHelp();
+        return EXIT_FAILURE;
+    }
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,37 @@
+#include "Test.h"
+#include "Nexon/stdlib.h"
+
+using NexonStd::BigArray;
+
+NEXON_TEST(BigArrayCopies) {
+    BigArray<int> A(3);
+    A[0] = 1;
+    // Copies are deep.
+    BigArray<int> Copy = A;
+    Copy[0] = 2;
+    CHECK_EQ(A[0], 1);
+    CHECK(Copy.data() != A.data());
+    BigArray<int> Assigned(1);
+    Assigned = A;
+    CHECK_EQ(Assigned.size(), 3u);
+    Assigned[1] = 5;
+    CHECK_EQ(A[1], 0);
+
+    // share() views the same elements and keeps them alive.
+    BigArray<int> Shared = A.share();
+    Shared[2] = 9;
+    CHECK_EQ(A[2], 9);
+    CHECK(Shared.data() == A.data());
+    A = BigArray<int>(1);
+    CHECK_EQ(Shared[2], 9);
+
+    // Moves take the elements.
+    const int* Data = Shared.data();
+    BigArray<int> Moved = std::move(Shared);
+    CHECK(Moved.data() == Data);
+    CHECK_EQ(Moved.size(), 3u);
+
+    BigArray<double> Distributed = BigArray<double>::distributed(1000);
+    CHECK_EQ(Distributed.size(), 1000u);
+    CHECK_EQ(Distributed[999], 0.0);
+}
@@ -0,0 +1,104 @@
+#include "Test.h"
+#include "Nexon/Channel.h"
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+using namespace Nexon;
+
+NEXON_TEST(ChannelSingleThread) {
+    Channel<int> C(3);
+    CHECK_EQ(C.getCapacity(), 4u);
+    for (int I = 0; I < 4; ++I)
+        CHECK(C.trySend(I));
+    CHECK(!C.trySend(4));
+    CHECK_EQ(C.size(), 4u);
+    int Value = -1;
+    CHECK(C.tryReceive(Value));
+    CHECK_EQ(Value, 0);
+    C.close();
+    CHECK(!C.send(5));
+    // Queued values are still delivered after close().
+    std::vector<int> Rest;
+    while (C.receive(Value))
+        Rest.push_back(Value);
+    CHECK(Rest == std::vector<int>({ 1, 2, 3 }));
+}
+
+NEXON_TEST(ChannelMPMCSum) {
+    constexpr int NumProducers = 4, NumConsumers = 4;
+    constexpr int64_t PerProducer = 20000;
+    Channel<int64_t> C(64);
+    std::atomic<int64_t> Sum { 0 }, Count { 0 };
+    std::vector<std::thread> Consumers;
+    for (int I = 0; I < NumConsumers; ++I) {
+        Consumers.emplace_back([&, I] {
+            int64_t Value, LocalSum = 0, LocalCount = 0;
+            int64_t Batch[16];
+            // Half of the consumers take values in batches.
+            if (I % 2) {
+                while (size_t N = C.receiveBatch(Batch, 16)) {
+                    for (size_t K = 0; K < N; ++K)
+                        LocalSum += Batch[K];
+                    LocalCount += static_cast<int64_t>(N);
+                }
+            } else {
+                while (C.receive(Value)) {
+                    LocalSum += Value;
+                    ++LocalCount;
+                }
+            }
+            Sum += LocalSum;
+            Count += LocalCount;
+        });
+    }
+    std::vector<std::thread> Producers;
+    for (int I = 0; I < NumProducers; ++I) {
+        Producers.emplace_back([&, I] {
+            if (I % 2) {
+                std::vector<int64_t> Values;
+                for (int64_t V = 1; V <= PerProducer; ++V)
+                    Values.push_back(V);
+                C.sendBatch(Values.data(), Values.size());
+            } else {
+                for (int64_t V = 1; V <= PerProducer; ++V)
+                    C.send(V);
+            }
+        });
+    }
+    for (auto &T : Producers)
+        T.join();
+    C.close();
+    for (auto &T : Consumers)
+        T.join();
+    CHECK_EQ(Count.load(), NumProducers * PerProducer);
+    CHECK_EQ(Sum.load(), NumProducers * PerProducer * (PerProducer + 1) / 2);
+}
+
+NEXON_TEST(ChannelSelectDrains) {
+    Channel<int> A(8), B(1024);
+    for (int I = 0; I < 8; ++I)
+        A.send(I);
+    A.close();
+    // B is filled and closed while select() runs.
+    std::thread Producer([&B] {
+        for (int I = 100; I < 1100; ++I)
+            B.send(I);
+        B.close();
+    });
+    int64_t Sum = 0;
+    int Count = 0, FromA = 0, Value;
+    Channel<int>* Channels[] = { &A, &B };
+    for (int Index; (Index = Channel<int>::select(Channels, Value)) >= 0;) {
+        Sum += Value;
+        ++Count;
+        FromA += Index == 0;
+    }
+    Producer.join();
+    CHECK_EQ(Count, 1008);
+    CHECK_EQ(FromA, 8);
+    CHECK_EQ(Sum, int64_t(28) + 599500);
+    // Once every channel is closed and empty, select() keeps returning -1.
+    CHECK_EQ(Channel<int>::select(Channels, Value), -1);
+}
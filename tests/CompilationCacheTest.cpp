@@ -0,0 +1,61 @@
+#include "Test.h"
+#include "Nexon/CompilationCache.h"
+#include "Nexon/ObjectEmitter.h"
+#include "llvm/ADT/SmallString.h"
+#include "llvm/Support/FileSystem.h"
+#include <cstdlib>
+
+using namespace Nexon;
+using namespace llvm;
+
+namespace {
+
+// Opens a cache in a fresh directory.
+std::unique_ptr<CompilationCache> openTemporaryCache() {
+    SmallString<128> Directory;
+    if (sys::fs::createUniqueDirectory("nexon-cache-test", Directory))
+        return nullptr;
+    setenv("NEXON_CACHE_DIR", Directory.c_str(), 1);
+    return CompilationCache::open();
+}
+
+}
+
+NEXON_TEST(CompilationCacheKeys) {
+    auto TM = ObjectEmitter::createTargetMachine("", "");
+    CHECK(TM != nullptr);
+    if (!TM)
+        return;
+    std::string Key = CompilationCache::computeKey("def f(x) x", "jit", *TM);
+    CHECK_EQ(CompilationCache::computeKey("def f(x) x", "jit", *TM), Key);
+    CHECK(CompilationCache::computeKey("def f(x) x + 1", "jit", *TM) != Key);
+    CHECK(CompilationCache::computeKey("def f(x) x", "executable", *TM) != Key);
+    // Fields are length-prefixed, so moving text between them changes the key.
+    CHECK(CompilationCache::computeKey("k", { "ab", "c" }) != CompilationCache::computeKey("k", { "a", "bc" }));
+}
+
+NEXON_TEST(CompilationCacheHitsAndMisses) {
+    std::unique_ptr<CompilationCache> Cache = openTemporaryCache();
+    CHECK(Cache != nullptr);
+    if (!Cache)
+        return;
+    std::string Key = CompilationCache::computeKey("test", { "source" });
+    CompilationCache::Entry Entry;
+    CHECK(!Cache->lookup(Key, Entry));
+
+    std::vector<std::unique_ptr<MemoryBuffer>> Objects;
+    Objects.push_back(MemoryBuffer::getMemBufferCopy("first object"));
+    Objects.push_back(MemoryBuffer::getMemBufferCopy(std::string("with\nnewlines\0and nul", 21)));
+    Cache->store(Key, { "__anon_expr.0", "__anon_expr.1" }, Objects);
+
+    CHECK(Cache->lookup(Key, Entry));
+    CHECK(Entry.TopLevelExprs == std::vector<std::string>({ "__anon_expr.0", "__anon_expr.1" }));
+    CHECK_EQ(Entry.Objects.size(), 2u);
+    if (Entry.Objects.size() == 2) {
+        CHECK(Entry.Objects[0]->getBuffer() == "first object");
+        CHECK(Entry.Objects[1]->getBuffer() == StringRef("with\nnewlines\0and nul", 21));
+    }
+    CompilationCache::Entry Other;
+    CHECK(!Cache->lookup(CompilationCache::computeKey("test", { "other source" }), Other));
+    sys::fs::remove_directories(Cache->getDirectory());
+}
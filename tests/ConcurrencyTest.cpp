@@ -0,0 +1,168 @@
+#include "Test.h"
+#include "Nexon/Concurrency.h"
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <numeric>
+#include <random>
+
+using namespace Nexon;
+
+NEXON_TEST(ConcurrencyNestedParallelFor) {
+    std::atomic<uint64_t> Sum { 0 };
+    Concurrency::parallelFor(0, 64, [&](size_t I) {
+        Concurrency::parallelFor(0, 1000, [&](size_t Begin, size_t End) {
+            uint64_t Local = 0;
+            for (size_t J = Begin; J < End; ++J)
+                Local += I * J;
+            Sum.fetch_add(Local, std::memory_order_relaxed);
+        }, /*grain=*/10);
+    }, /*grain=*/1);
+    CHECK_EQ(Sum.load(), uint64_t(2016) * 499500);
+}
+
+NEXON_TEST(ConcurrencyReduce) {
+    auto Sum = [](ReductionOrder Order) {
+        return Concurrency::parallelTransformReduce(0, 1000000, 0.0, [](size_t I) { return 1.0 / double(I + 1); },
+                                                    [](double A, double B) { return A + B; }, Order);
+    };
+    CHECK_EQ(Sum(ReductionOrder::Deterministic), Sum(ReductionOrder::Deterministic));
+    CHECK_NEAR(Sum(ReductionOrder::Fast), 14.392726722865723, 1e-9);
+    CHECK_EQ(Concurrency::parallelReduce(5, 5, 42, [](size_t, size_t) { return 0; }, std::plus<>()), 42);
+}
+
+NEXON_TEST(ConcurrencyScan) {
+    std::vector<int64_t> Input(100003);
+    std::iota(Input.begin(), Input.end(), -500);
+    std::vector<int64_t> Expected(Input.size()), Output(Input.size());
+    std::partial_sum(Input.begin(), Input.end(), Expected.begin());
+    Concurrency::parallelScan(Input.begin(), Input.end(), Output.begin(), int64_t(0), std::plus<>());
+    CHECK(Output == Expected);
+
+    std::exclusive_scan(Input.begin(), Input.end(), Expected.begin(), int64_t(0));
+    Concurrency::parallelScan(Input.begin(), Input.end(), Output.begin(), int64_t(0), std::plus<>(),
+                              ScanKind::Exclusive);
+    CHECK(Output == Expected);
+    // In place.
+    Concurrency::parallelScan(Input.begin(), Input.end(), Input.begin(), int64_t(0), std::plus<>(),
+                              ScanKind::Exclusive);
+    CHECK(Input == Expected);
+}
+
+NEXON_TEST(ConcurrencySort) {
+    std::mt19937 Random(7);
+    for (size_t Count : { size_t(0), size_t(100), size_t(200001) }) {
+        std::vector<uint32_t> Values(Count);
+        for (auto &Value : Values)
+            Value = Random() % 1000;
+        std::vector<uint32_t> Expected = Values;
+        std::sort(Expected.begin(), Expected.end(), std::greater<>());
+        Concurrency::parallelSort(Values.begin(), Values.end(), std::greater<>());
+        CHECK(Values == Expected);
+    }
+}
+
+NEXON_TEST(ConcurrencyFutures) {
+    Future<int> Answer = Concurrency::async([] { return 6; });
+    Future<int> Doubled = Answer.then([](int Value) { return Value * 7; });
+    CHECK_EQ(Doubled.get().value_or(0), 42);
+    CHECK(Doubled.getStatus() == TaskStatus::Completed);
+
+    std::vector<Future<int>> Parts;
+    for (int I = 0; I < 10; ++I)
+        Parts.push_back(Concurrency::async([I] { return I * I; }));
+    std::optional<std::vector<int>> All = Concurrency::whenAll(std::move(Parts)).get();
+    CHECK(All && *All == std::vector<int>({ 0, 1, 4, 9, 16, 25, 36, 49, 64, 81 }));
+    CHECK(Concurrency::whenAll(std::vector<Future<void>>()).get());
+}
+
+NEXON_TEST(ConcurrencyCancellation) {
+    // Work that runs until it is cancelled, whether it starts before or after cancel().
+    std::atomic<bool> ContinuationRan { false };
+    Future<int> Work = Concurrency::async([] {
+        while (!Concurrency::isCancellationRequested())
+            std::this_thread::yield();
+        return 1;
+    });
+    Future<int> Next = Work.then([&](int Value) {
+        ContinuationRan = true;
+        return Value;
+    });
+    Work.cancel();
+    CHECK(!Work.wait());
+    CHECK(Work.getStatus() == TaskStatus::Cancelled);
+    CHECK(!Next.get());
+    CHECK(Next.getStatus() == TaskStatus::Cancelled);
+    CHECK(!ContinuationRan);
+
+    // whenAll is cancelled if any input is.
+    Future<int> Done = Concurrency::async([] { return 1; });
+    Future<int> Stopped = Concurrency::async([] {
+        while (!Concurrency::isCancellationRequested())
+            std::this_thread::yield();
+        return 2;
+    });
+    Stopped.cancel();
+    Future<std::vector<int>> Both = Concurrency::whenAll(std::vector<Future<int>>({ Done, Stopped }));
+    CHECK(!Both.get());
+    CHECK(Both.getStatus() == TaskStatus::Cancelled);
+}
+
+NEXON_TEST(ConcurrencyTaskGraph) {
+    // A diamond: load, then two transforms, then a reduce that sees both.
+    std::atomic<int> Step { 0 };
+    int LoadStep = -1, LeftStep = -1, RightStep = -1, ReduceStep = -1;
+    std::vector<int> Data;
+    long Left = 0, Right = 0, Total = 0;
+    Concurrency::TaskGraph Graph;
+    TaskGraph::NodeId Load = Graph.add("load", [&] {
+        LoadStep = Step++;
+        Data.resize(1000);
+        std::iota(Data.begin(), Data.end(), 1);
+    });
+    TaskGraph::NodeId A = Graph.add("left", [&] {
+        LeftStep = Step++;
+        Left = std::accumulate(Data.begin(), Data.begin() + 500, 0L);
+    }, { Load });
+    TaskGraph::NodeId B = Graph.add("right", [&] {
+        RightStep = Step++;
+        Right = Concurrency::parallelReduce(500, 1000, 0L, [&](size_t Begin, size_t End) {
+            return std::accumulate(Data.begin() + Begin, Data.begin() + End, 0L);
+        }, std::plus<>());
+    }, { Load });
+    Graph.add("reduce", [&] {
+        ReduceStep = Step++;
+        Total = Left + Right;
+    }, { A, B });
+    CHECK(Graph.run());
+    CHECK_EQ(Total, 500500L);
+    CHECK_EQ(LoadStep, 0);
+    CHECK(LeftStep > LoadStep && RightStep > LoadStep);
+    CHECK_EQ(ReduceStep, 3);
+    // The graph runs again, and asynchronously.
+    Total = 0;
+    CHECK(Graph.runAsync().get().value_or(false));
+    CHECK_EQ(Total, 500500L);
+}
+
+NEXON_TEST(ConcurrencyTaskGraphCancel) {
+    bool CancelRun = true, SecondRan = false;
+    Concurrency::TaskGraph Graph;
+    TaskGraph::NodeId First = Graph.add("first", [&] {
+        if (CancelRun)
+            Graph.cancel();
+    });
+    Graph.add("second", [&] { SecondRan = true; }, { First });
+    CHECK(!Graph.run());
+    CHECK(!SecondRan);
+    // Cancellation applies to one run.
+    CancelRun = false;
+    CHECK(Graph.run());
+    CHECK(SecondRan);
+
+    TaskGraph Cycle;
+    TaskGraph::NodeId X = Cycle.add("x", [] { });
+    TaskGraph::NodeId Y = Cycle.add("y", [] { }, { X });
+    Cycle.addDependency(Y, X);
+    CHECK(!Cycle.run());
+}
@@ -0,0 +1,60 @@
+#include "Test.h"
+#include "Nexon/AST.h"
+#include "Nexon/CodeGen.h"
+#include "Nexon/JIT.h"
+#include "Nexon/ObjectEmitter.h"
+#include "Nexon/Optimizer.h"
+#include "Nexon/Parser.h"
+#include "Nexon/TokenBuffer.h"
+#include <limits>
+
+namespace Nexon {
+
+std::optional<std::vector<double>> evaluate(std::string_view Source) {
+    TokenBuffer Tokens;
+    std::unique_ptr<JIT> Engine = JIT::create();
+    if (!Tokens.tokenize(Source) || !Engine)
+        return std::nullopt;
+    CompilationSession Session;
+    ObjectEmitter::configureModule(Session.getModule(), Engine->getTargetMachine());
+    ASTContext Ctx;
+    Parser P(Tokens, Ctx);
+    std::vector<std::string> TopLevelExprs;
+    for (int Tok = P.getCurrentToken(); Tok != tok_eof; Tok = P.getCurrentToken()) {
+        if (Tok == ';') {
+            P.getNextToken();
+        } else if (Tok == tok_extern) {
+            ProtoRef Proto = P.parseExtern();
+            if (Proto == InvalidRef || !Ctx.getProto(Proto).codegen(Ctx, Session))
+                return std::nullopt;
+            Session.addPrototype(Ctx.getProto(Proto).getSignature(Ctx));
+        } else {
+            bool IsDefinition = Tok == tok_def;
+            FuncRef F = IsDefinition ? P.parseDefinition() : P.parseTopLevelExpr();
+            if (F == InvalidRef || !Ctx.getFunction(F).codegen(Ctx, Session))
+                return std::nullopt;
+            if (!IsDefinition)
+                TopLevelExprs.push_back(std::string(Ctx.getFunctionName(F)));
+        }
+    }
+    if (!Optimizer::runOptimizationPasses(Session.getModule(), Engine->getTargetMachine()) ||
+        !Engine->addModule(Session.takeModule()))
+        return std::nullopt;
+    std::vector<double> Results;
+    for (const std::string &Name : TopLevelExprs) {
+        auto* Expr = reinterpret_cast<double (*)()>(Engine->lookup(Name));
+        if (!Expr)
+            return std::nullopt;
+        Results.push_back(Expr());
+    }
+    return Results;
+}
+
+double evaluateLast(std::string_view Source) {
+    std::optional<std::vector<double>> Results = evaluate(Source);
+    if (!Results || Results->empty())
+        return std::numeric_limits<double>::quiet_NaN();
+    return Results->back();
+}
+
+}
@@ -0,0 +1,90 @@
+#include "Test.h"
+#include "Nexon/Lexer.h"
+#include "Nexon/TokenBuffer.h"
+#include <cstdint>
+#include <string>
+
+using namespace Nexon;
+
+namespace {
+
+struct LexedToken {
+    int Kind;
+    std::string_view Text;
+    double NumVal;
+    unsigned Line, Column;
+    bool operator==(const LexedToken &Other) const {
+        return Kind == Other.Kind && Text == Other.Text && NumVal == Other.NumVal && Line == Other.Line &&
+               Column == Other.Column;
+    }
+};
+
+std::vector<LexedToken> lexAll(std::string_view Source, LexerKernels Kernels) {
+    std::vector<LexedToken> Tokens;
+    Lexer Lex(Source, Kernels);
+    int Tok;
+    do {
+        Tok = Lex.getNextToken();
+        Tokens.push_back({ Tok, Lex.getTokenText(), Tok == tok_number ? Lex.getNumVal() : 0.0,
+                           Lex.getTokenLoc().Line, Lex.getTokenLoc().Column });
+    } while (Tok != tok_eof);
+    return Tokens;
+}
+
+// Source whose runs of identifier characters, digits and whitespace have every length
+// from 0 to 80, so the SIMD kernels see full vectors, partial tails and run ends at
+// every offset within a vector.
+std::string makeMixedSource() {
+    static const char Spaces[] = { ' ', '\t', '\n', '\r', ' ', '\n' };
+    uint32_t Seed = 12345;
+    auto Next = [&Seed] { return Seed = Seed * 1103515245u + 12345u; };
+    std::string Source;
+    for (unsigned Length = 0; Length <= 80; ++Length) {
+        Source += "def f" + std::string(Length, 'a' + Length % 26) + "(x y)";
+        for (unsigned I = 0; I < Length; ++I)
+            Source += Spaces[(Next() >> 16) % sizeof(Spaces)];
+        Source += std::string(Length + 1, '0' + Length % 10);
+        if (Length % 3 == 0)
+            Source += "." + std::string(Length, '7');
+        Source += Length % 2 ? " <= x;" : "!=y # comment " + std::to_string(Length) + "\n";
+        Source += "parallel for while if else var extern Z" + std::string(Length, '9') + " ";
+    }
+    return Source;
+}
+
+}
+
+NEXON_TEST(LexerSimdMatchesScalar) {
+    std::string Source = makeMixedSource();
+    CHECK(lexAll(Source, LexerKernels::Best) == lexAll(Source, LexerKernels::Scalar));
+    // Every prefix ends the last run at a different place relative to the buffer end.
+    for (size_t Length = 0; Length <= 400; ++Length) {
+        std::string_view Prefix = std::string_view(Source).substr(0, Length);
+        CHECK(lexAll(Prefix, LexerKernels::Best) == lexAll(Prefix, LexerKernels::Scalar));
+    }
+}
+
+NEXON_TEST(LexerTokenBufferMatchesLexer) {
+    std::string Source = makeMixedSource();
+    std::vector<LexedToken> Expected = lexAll(Source, LexerKernels::Scalar);
+    TokenBuffer Tokens;
+    CHECK(Tokens.tokenize(Source));
+    CHECK_EQ(Tokens.size(), Expected.size());
+    for (size_t I = 0; I < Tokens.size() && I < Expected.size(); ++I) {
+        LexedToken Actual = { Tokens.getKind(I), Tokens.getText(I), Tokens.getNumVal(I), Tokens.getLoc(I).Line,
+                              Tokens.getLoc(I).Column };
+        CHECK(Actual == Expected[I]);
+    }
+}
+
+NEXON_TEST(LexerTokenKinds) {
+    std::vector<LexedToken> Tokens = lexAll("def f(x) x <= 10.5 # note\n  == 3", LexerKernels::Best);
+    std::vector<int> Kinds;
+    for (const LexedToken &Token : Tokens)
+        Kinds.push_back(Token.Kind);
+    CHECK(Kinds == std::vector<int>({ tok_def, tok_identifier, '(', tok_identifier, ')', tok_identifier, tok_le,
+                                      tok_number, tok_eq, tok_number, tok_eof }));
+    CHECK_EQ(Tokens[7].NumVal, 10.5);
+    CHECK_EQ(Tokens[9].Line, 2u);
+    CHECK_EQ(Tokens[9].Column, 6u);
+}
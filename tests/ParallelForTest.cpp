@@ -0,0 +1,49 @@
+#include "Test.h"
+
+using namespace Nexon;
+
+NEXON_TEST(ParallelForReductions) {
+    // Sum of squares below 1000, plus the accumulator's starting value.
+    CHECK_EQ(evaluateLast("def f(n s) parallel for i = 0, n reduce(+: s) { i * i }\nf(1000, 5)"), 332833505.0);
+    CHECK_NEAR(evaluateLast("def f(n k) parallel for i = 1, n + 1 reduce(*: k) { 1 + 1 / i }\nf(100, 2)"), 202.0, 1e-9);
+    CHECK_EQ(evaluateLast("def f(n a) parallel for i = 0, n, 7 reduce(min: a) { (i - 37) * (i - 37) + 3 }\n"
+                          "f(100, 99)"), 3.0);
+    CHECK_EQ(evaluateLast("def f(n a) parallel for i = 0 - 50, n reduce(max: a) { i * 2 }\nf(10, 0 - 1000)"), 18.0);
+    // An empty range leaves the accumulator alone.
+    CHECK_EQ(evaluateLast("def f(n s) parallel for i = 0, n reduce(+: s) { i }\nf(0, 7)"), 7.0);
+}
+
+NEXON_TEST(ParallelForTypedReductions) {
+    // i64 sums stay exact beyond 2^53.
+    CHECK_EQ(evaluateLast("def f(n: i64) -> bool { var s: i64 = 9007199254740993; "
+                          "parallel for i = 0, n reduce(+: s) { 1 }; s == 9007199254741993 }\nf(1000)"), 1.0);
+    CHECK_EQ(evaluateLast("def f(n: i64) -> i64 { var m = 100; parallel for i = 0, n reduce(min: m) "
+                          "{ (i - 37) * (i - 37) + 3 }; m }\nf(100)"), 3.0);
+    CHECK_EQ(evaluateLast("def f(n: i64) -> i32 { var m: i32 = 0 - 5; parallel for i = 0, n reduce(max: m) "
+                          "{ i32(i) }; m }\nf(1000)"), 999.0);
+    CHECK_EQ(evaluateLast("def f(n: i64) -> f32 { var s: f32 = 1; parallel for i = 0, n reduce(*: s) { 2 }; s }\n"
+                          "f(10)"), 1024.0);
+}
+
+NEXON_TEST(ParallelForNestingAndCaptures) {
+    CHECK_EQ(evaluateLast("def f(n s) parallel for i = 0, n reduce(+: s) { parallel for j = 0, i reduce(+: i) { j } }\n"
+                          "f(10, 0)"), 165.0);
+    CHECK_EQ(evaluateLast("def f(n k s) parallel for i = 0, n reduce(+: s) { i * k }\nf(100, 3, 0)"), 14850.0);
+    CHECK_EQ(evaluateLast("def f(n s) { parallel for i = 0, n reduce(+: s) { var t = 0; for j = 0, i { t = t + j }; "
+                          "if t > 10 { t } else { 0 } }; s }\nf(10, 0)"), 100.0);
+}
+
+NEXON_TEST(ParallelForSideEffects) {
+    CHECK_EQ(evaluateLast("extern chanNew(cap)\nextern chanSend(ch v)\nextern chanLen(ch)\n"
+                          "def f(n c) { parallel for i = 0, n { chanSend(c, i) }; chanLen(c) }\nf(50, chanNew(64))"),
+             50.0);
+}
+
+NEXON_TEST(ParallelForDeterministic) {
+    // The chunks depend only on the range and grain, so floating-point sums repeat exactly.
+    const char* Source = "def f(n s) parallel for i = 0, n reduce(+: s) { 1 / (i + 1) }\nf(1000000, 0)\nf(1000000, 0)";
+    std::optional<std::vector<double>> Results = evaluate(Source);
+    CHECK(Results && Results->size() == 2);
+    if (Results && Results->size() == 2)
+        CHECK_EQ((*Results)[0], (*Results)[1]);
+}
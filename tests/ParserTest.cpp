@@ -0,0 +1,26 @@
+#include "Test.h"
+#include <cmath>
+
+using namespace Nexon;
+
+NEXON_TEST(ParserUnaryMinus) {
+    CHECK_EQ(evaluateLast("-3 + 5"), 2.0);
+    CHECK_EQ(evaluateLast("2 - -3"), 5.0);
+    CHECK_EQ(evaluateLast("-(1 + 2) * -2"), 6.0);
+    CHECK_EQ(evaluateLast("- - 1"), 1.0);
+    CHECK_EQ(evaluateLast("def f(x) -x * 2\nf(-4)"), 8.0);
+    CHECK_EQ(evaluateLast("def f(x: i32) -> i32 -x\nf(7)"), -7.0);
+    // Negated literals are folded, so the most negative i64 can be written.
+    CHECK_EQ(evaluateLast("def f() -> i64 -9223372036854775808 + 9223372036854775807\nf()"), -1.0);
+    CHECK(!evaluate("-9223372036854775809"));
+    double NegativeZero = evaluateLast("def f(x) -x\nf(0)");
+    CHECK(NegativeZero == 0 && std::signbit(NegativeZero));
+}
+
+NEXON_TEST(ParserForStep) {
+    CHECK_EQ(evaluateLast("def f(n) { var s = 0; for i = n, 0, -1 { s = s * 10 + i }; s }\nf(4)"), 4321.0);
+    CHECK_EQ(evaluateLast("def f() { var s = 0; for i = 1, 0, -0.25 { s = s + i }; s }\nf()"), 2.5);
+    // A literal zero step would never end.
+    CHECK(!evaluate("def f() { for i = 0, 10, 0 { i } }"));
+    CHECK(!evaluate("def f() { for i = 0, 10, -0.0 { i } }"));
+}
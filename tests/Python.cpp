@@ -0,0 +1,13 @@
+#include "Test.h"
+#include "Nexon/Runtime.h"
+#include <Python.h>
+
+namespace Nexon {
+
+bool runPython(const std::string &Code) {
+    if (!Py_IsInitialized())
+        Runtime::initializePython();
+    return PyRun_SimpleString(Code.c_str()) == 0;
+}
+
+}
@@ -0,0 +1,69 @@
+#include "Test.h"
+#include "Nexon/PythonBridge.h"
+#include <Python.h>
+#include <cstdint>
+
+using namespace Nexon;
+
+NEXON_TEST(PythonBridgeExport) {
+    NexonStd::BigArray<double> A(4);
+    A[1] = 1.5;
+    CHECK(PythonBridge::setGlobal("exported", PythonBridge::exportArray(A)));
+    CHECK(runPython("view = memoryview(exported)\n"
+                    "assert view.format == 'd' and view.tolist() == [0.0, 1.5, 0.0, 0.0]\n"
+                    "interface = exported.__array_interface__\n"
+                    "assert interface['typestr'] == '<f8' and interface['shape'] == (4,)\n"
+                    "address = interface['data'][0]\n"
+                    "view[2] = 7.0\n"));
+    // Both sides see the same memory.
+    CHECK_EQ(A[2], 7.0);
+    A[3] = -2.0;
+    CHECK(runPython("assert view[3] == -2.0 and len(exported) == 4"));
+    PyObject* Address = PythonBridge::getGlobal("address");
+    CHECK(Address && PyLong_AsVoidPtr(Address) == A.data());
+    Py_XDECREF(Address);
+
+    // A read-only export refuses writable views.
+    NexonStd::BigArray<int32_t> B(2);
+    CHECK(PythonBridge::setGlobal("readonly", PythonBridge::exportArray(B, /*ReadOnly=*/true)));
+    CHECK(runPython("view.release()\n"
+                    "assert memoryview(readonly).readonly\n"
+                    "assert readonly.__array_interface__['typestr'] == '<i4'\n"
+                    "del view, exported, readonly\n"));
+}
+
+NEXON_TEST(PythonBridgeImport) {
+    CHECK(runPython("import array\n"
+                    "data = bytearray(b'abc')\n"
+                    "doubles = array.array('d', [1.0, 2.0, 3.0])\n"
+                    "ints = array.array('i', [1, 2])\n"
+                    "constant = b'abc'\n"));
+    PyObject* Data = PythonBridge::getGlobal("data");
+    auto Bytes = PythonBridge::importArray<uint8_t>(Data);
+    CHECK(Bytes && Bytes->size() == 3 && (*Bytes)[1] == 'b');
+    if (Bytes)
+        (*Bytes)[0] = 'x';
+    Bytes.reset();
+    CHECK(runPython("assert data == bytearray(b'xbc')"));
+
+    PyObject* Doubles = PythonBridge::getGlobal("doubles");
+    auto D = PythonBridge::importArray<double>(Doubles);
+    CHECK(D && D->size() == 3 && (*D)[2] == 3.0);
+    if (D)
+        (*D)[1] = 0.25;
+    CHECK(runPython("assert doubles[1] == 0.25"));
+    D.reset();
+
+    // The element format must match, and the buffer must be writable.
+    PyObject* Ints = PythonBridge::getGlobal("ints");
+    CHECK(PythonBridge::importArray<double>(Ints) == nullptr);
+    CHECK(PythonBridge::importArray<int64_t>(Ints) == nullptr);
+    CHECK(PythonBridge::importArray<int32_t>(Ints) != nullptr);
+    CHECK(PythonBridge::importArray<float>(Doubles) == nullptr);
+    PyObject* Constant = PythonBridge::getGlobal("constant");
+    CHECK(PythonBridge::importArray<uint8_t>(Constant) == nullptr);
+    Py_XDECREF(Constant);
+    Py_XDECREF(Ints);
+    Py_XDECREF(Doubles);
+    Py_XDECREF(Data);
+}
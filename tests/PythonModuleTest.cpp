@@ -0,0 +1,56 @@
+#include "Test.h"
+
+using namespace Nexon;
+
+NEXON_TEST(PythonModuleCompile) {
+    CHECK(runPython("import nexon\n"
+                    "f = nexon.compile('def f(x y) x * x + y')\n"
+                    "assert isinstance(f, nexon.Function)\n"
+                    "assert f(3, 4) == 13.0 and f.name == 'f' and f.nargs == 2\n"
+                    "# A named function, and one that calls another.\n"
+                    "g = nexon.compile('def a(x) x + 1\\ndef b(x) a(x) * 2', 'a')\n"
+                    "assert g(1) == 2.0 and nexon.compile('def a(x) x + 1\\ndef b(x) a(x) * 2')(1) == 4.0\n"
+                    "# Typed parameters and results are converted from and to floats.\n"
+                    "h = nexon.compile('def h(n: i64) -> i64 n / 2')\n"
+                    "assert h(7) == 3.0 and h(7.9) == 3.0\n"
+                    "t = nexon.compile('def t(x: f32) -> bool x > 0.5')\n"
+                    "assert t(0.75) == 1.0 and t(0.25) == 0.0\n"));
+}
+
+NEXON_TEST(PythonModuleErrors) {
+    CHECK(runPython("import nexon\n"
+                    "f = nexon.compile('def f(x y) x + y')\n"
+                    "def raises(error, call):\n"
+                    "    try:\n"
+                    "        call()\n"
+                    "    except error:\n"
+                    "        return True\n"
+                    "    return False\n"
+                    "assert raises(TypeError, lambda: f(1))\n"
+                    "assert raises(TypeError, lambda: f(1, 2, 3))\n"
+                    "assert raises(TypeError, lambda: f(1, y=2))\n"
+                    "assert raises(TypeError, lambda: f('a', 2))\n"
+                    "assert raises(NameError, lambda: nexon.compile('def f(x) x', 'g'))\n"
+                    "assert raises(SyntaxError, lambda: nexon.compile('def f(x) x +'))\n"
+                    "assert raises(SyntaxError, lambda: nexon.compile('1 + 2'))\n"));
+}
+
+#ifdef HAVE_NUMPY
+NEXON_TEST(PythonModuleUfunc) {
+    CHECK(runPython("import nexon, numpy as np\n"
+                    "u = nexon.compile('def f(x y) x * x + y').ufunc\n"
+                    "xs = np.arange(20.0)\n"
+                    "assert np.array_equal(u(xs, 1), xs * xs + 1)\n"
+                    "# Strided and reversed inputs.\n"
+                    "a, b = xs[::2], xs[::-2]\n"
+                    "assert np.array_equal(u(a, b), a * a + b)\n"
+                    "m = xs.reshape(4, 5).T\n"
+                    "assert not m.flags.c_contiguous and np.array_equal(u(m, m), m * m + m)\n"
+                    "out = np.zeros(20)\n"
+                    "u(xs[::-1], 0, out=out)\n"
+                    "assert np.array_equal(out, xs[::-1] ** 2)\n"
+                    "# Typed functions get float64 ufuncs too.\n"
+                    "i = nexon.compile('def i(x: i32) -> i32 x * 2').ufunc\n"
+                    "assert np.array_equal(i(np.array([1.9, -3.0, 4.0])), [2.0, -6.0, 8.0])\n"));
+}
+#endif
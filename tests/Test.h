@@ -0,0 +1,75 @@
+#ifndef NEXON_TESTS_TEST_H
+#define NEXON_TESTS_TEST_H
+
+#include <cmath>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace Nexon {
+
+    // A test registered with NEXON_TEST. nexon_tests runs the tests whose names start
+    // with its argument (all of them without one).
+    struct TestCase {
+        const char* Name;
+        void (*Run)();
+    };
+    std::vector<TestCase> &getTestCases();
+
+    struct TestRegistrar {
+        TestRegistrar(const char* Name, void (*Run)()) { getTestCases().push_back({ Name, Run }); }
+    };
+
+    // Records a failed check; the test goes on with its other checks.
+    void recordFailure(const char* File, int Line, const std::string &Message);
+
+    // Compiles Source (definitions, externs and top-level expressions) with the JIT and
+    // returns the value of each top-level expression in order, or nothing if it does
+    // not compile.
+    std::optional<std::vector<double>> evaluate(std::string_view Source);
+    // The value of the last top-level expression of Source, or NaN.
+    double evaluateLast(std::string_view Source);
+
+    // Runs Code in `__main__` of the embedded interpreter, starting it on first use.
+    // Returns false (after printing the traceback) if Code raised.
+    bool runPython(const std::string &Code);
+
+}
+
+#define NEXON_TEST(Name)                                                  \
+    static void Name();                                                   \
+    static const ::Nexon::TestRegistrar Name##Registrar(#Name, Name);     \
+    static void Name()
+
+#define CHECK(Condition)                                                  \
+    do {                                                                  \
+        if (!(Condition))                                                 \
+            ::Nexon::recordFailure(__FILE__, __LINE__, "CHECK(" #Condition ")"); \
+    } while (0)
+
+#define CHECK_EQ(Actual, Expected)                                        \
+    do {                                                                  \
+        const auto &CheckActual = (Actual);                               \
+        const auto &CheckExpected = (Expected);                           \
+        if (!(CheckActual == CheckExpected)) {                            \
+            std::ostringstream CheckMessage;                              \
+            CheckMessage << #Actual " == " #Expected ": got " << CheckActual \
+                         << ", expected " << CheckExpected;               \
+            ::Nexon::recordFailure(__FILE__, __LINE__, CheckMessage.str()); \
+        }                                                                 \
+    } while (0)
+
+#define CHECK_NEAR(Actual, Expected, Tolerance)                            \
+    do {                                                                  \
+        double CheckActual = (Actual), CheckExpected = (Expected);        \
+        if (!(std::abs(CheckActual - CheckExpected) <= (Tolerance))) {    \
+            std::ostringstream CheckMessage;                              \
+            CheckMessage.precision(17);                                   \
+            CheckMessage << #Actual " near " #Expected ": got " << CheckActual; \
+            ::Nexon::recordFailure(__FILE__, __LINE__, CheckMessage.str()); \
+        }                                                                 \
+    } while (0)
+
+#endif // NEXON_TESTS_TEST_H
@@ -0,0 +1,37 @@
+#include "Test.h"
+#include <iostream>
+#include <string_view>
+
+namespace Nexon {
+
+static unsigned NumFailures = 0;
+
+std::vector<TestCase> &getTestCases() {
+    static std::vector<TestCase> Tests;
+    return Tests;
+}
+
+void recordFailure(const char* File, int Line, const std::string &Message) {
+    ++NumFailures;
+    std::cerr << File << ":" << Line << ": " << Message << "\n";
+}
+
+}
+
+int main(int argc, char **argv) {
+    using namespace Nexon;
+    std::string_view Prefix = argc > 1 ? argv[1] : "";
+    unsigned NumRun = 0, NumFailed = 0;
+    for (const TestCase &Test : getTestCases()) {
+        if (std::string_view(Test.Name).substr(0, Prefix.size()) != Prefix)
+            continue;
+        unsigned FailuresBefore = NumFailures;
+        Test.Run();
+        ++NumRun;
+        bool Passed = NumFailures == FailuresBefore;
+        NumFailed += !Passed;
+        std::cout << (Passed ? "[ PASS ] " : "[ FAIL ] ") << Test.Name << std::endl;
+    }
+    std::cout << NumRun - NumFailed << " of " << NumRun << " tests passed." << std::endl;
+    return NumRun == 0 || NumFailed ? 1 : 0;
+}
@@ -0,0 +1,151 @@
+#include "Test.h"
+#include "Nexon/AST.h"
+#include "Nexon/CodeGen.h"
+#include "Nexon/Parser.h"
+#include "Nexon/TokenBuffer.h"
+#include "Nexon/TypeInference.h"
+
+using namespace Nexon;
+
+namespace {
+
+std::ostream &operator<<(std::ostream &OS, ValueType T) { return OS << getTypeName(T); }
+std::ostream &operator<<(std::ostream &OS, const std::optional<ValueType> &T) {
+    return T ? OS << *T : OS << "(no type)";
+}
+
+// Type inferred for the body of the definitions in Source, the last one for the
+// value. Earlier definitions are only registered, so the last one can call them.
+std::optional<ValueType> inferBodyType(std::string_view Source) {
+    TokenBuffer Tokens;
+    if (!Tokens.tokenize(Source))
+        return std::nullopt;
+    ASTContext Ctx;
+    Parser P(Tokens, Ctx);
+    FunctionRegistry Functions;
+    FuncRef Last = InvalidRef;
+    while (P.getCurrentToken() == tok_def) {
+        Last = P.parseDefinition();
+        if (Last == InvalidRef)
+            return std::nullopt;
+        Functions.add(Ctx.getProto(Ctx.getFunction(Last).Proto).getSignature(Ctx));
+    }
+    if (Last == InvalidRef || P.getCurrentToken() != tok_eof)
+        return std::nullopt;
+    TypeInference::run(Ctx, Ctx.getFunction(Last), Functions);
+    return Ctx.getExpr(Ctx.getFunction(Last).Body).Type;
+}
+
+}
+
+NEXON_TEST(TypeInferenceLiteralsAndOperators) {
+    CHECK_EQ(inferBodyType("def f() 1"), ValueType::I64);
+    CHECK_EQ(inferBodyType("def f() 1.5"), ValueType::F64);
+    CHECK_EQ(inferBodyType("def f(x) x + 1"), ValueType::F64);
+    CHECK_EQ(inferBodyType("def f(x: f32) x + 1"), ValueType::F32);
+    CHECK_EQ(inferBodyType("def f(x: f32) x + 1.5"), ValueType::F32);
+    CHECK_EQ(inferBodyType("def f(a: i32 b: i64) a + b"), ValueType::I64);
+    CHECK_EQ(inferBodyType("def f(a: i32 b: f32) a * b"), ValueType::F32);
+    CHECK_EQ(inferBodyType("def f(a: i64 b: i64) a / b"), ValueType::F64);
+    CHECK_EQ(inferBodyType("def f(a: f32 b: f32) a / b"), ValueType::F32);
+    CHECK_EQ(inferBodyType("def f(b: bool) b + b"), ValueType::I64);
+    CHECK_EQ(inferBodyType("def f(x) x < 1"), ValueType::Bool);
+    CHECK_EQ(inferBodyType("def f(x) i32(x)"), ValueType::I32);
+}
+
+NEXON_TEST(TypeInferenceVariables) {
+    CHECK_EQ(inferBodyType("def f() { var s = 0; s }"), ValueType::I64);
+    // A later assignment widens the variable, including its earlier uses.
+    CHECK_EQ(inferBodyType("def f() { var s = 0; var t = s; s = s + 0.5; t }"), ValueType::F64);
+    CHECK_EQ(inferBodyType("def f() { var s = 0; s = s + 0.5; s }"), ValueType::F64);
+    CHECK_EQ(inferBodyType("def f(n: i64) { var s = 0; for i = 0, n { s = s + i }; s }"), ValueType::I64);
+    CHECK_EQ(inferBodyType("def f() { var s = 0; for i = 0, 1, 0.25 { s = s + i }; s }"), ValueType::F64);
+    // Annotated variables keep their type.
+    CHECK_EQ(inferBodyType("def f() { var x: f32 = 0; x = x + 0.5; x }"), ValueType::F32);
+    CHECK_EQ(inferBodyType("def f() { var b: bool = 5; b }"), ValueType::Bool);
+    CHECK_EQ(inferBodyType("def f(x) if x > 0 { 1 } else { 2.5 }"), ValueType::F64);
+}
+
+NEXON_TEST(TypeInferenceCalls) {
+    CHECK_EQ(inferBodyType("def g(x: i64) -> i32 x\ndef f() g(2)"), ValueType::I32);
+    CHECK_EQ(inferBodyType("def g(x) -> bool x > 1\ndef f() g(2)"), ValueType::Bool);
+    // A function named like a type is called, not used as a conversion.
+    CHECK_EQ(inferBodyType("def f32(x) x + 1\ndef f() f32(2)"), ValueType::F64);
+}
+
+NEXON_TEST(TypeInferenceReductions) {
+    // A reduction keeps the accumulator's type, and widens it only like an assignment.
+    CHECK_EQ(inferBodyType("def f(n: i64) { var s = 0; parallel for i = 0, n reduce(+: s) { i }; s }"), ValueType::I64);
+    CHECK_EQ(inferBodyType("def f(n: i64) { var s: f32 = 0; parallel for i = 0, n reduce(+: s) { i * 0.5 }; s }"),
+             ValueType::F32);
+    CHECK_EQ(inferBodyType("def f(n: i64) { var s = 0; parallel for i = 0, n reduce(+: s) { i * 0.5 }; s }"),
+             ValueType::F64);
+    CHECK_EQ(inferBodyType("def f(n: i64 m: i32) parallel for i = 0, n reduce(max: m) { i32(i) }"), ValueType::I32);
+}
+
+NEXON_TEST(TypeInferenceEvaluation) {
+    CHECK_EQ(evaluateLast("def half(x: f32) -> f32 x / 2\nhalf(3)"), 1.5);
+    CHECK_EQ(evaluateLast("def isum(n: i64) -> i64 { var s = 0; for i = 0, n { s = s + i }; s }\nisum(100)"), 4950.0);
+    CHECK_EQ(evaluateLast("def idiv(a: i64 b: i64) a / b\nidiv(7, 2)"), 3.5);
+    CHECK_EQ(evaluateLast("def t(x) i32(x)\nt(3.9)"), 3.0);
+    CHECK_EQ(evaluateLast("def pos(x: f64) -> bool x > 0\npos(2) + pos(0 - 1)"), 1.0);
+    CHECK_EQ(evaluateLast("def avg(n) { var t: f32 = 0; for i = 0, n { t = t + i }; t / n }\navg(10)"), 4.5);
+    CHECK_EQ(evaluateLast("def cnt() { var k = 0; while k < 10 { k = k + 3 }; k }\ncnt()"), 12.0);
+    CHECK_EQ(evaluateLast("def b2() { var b: bool = 5; b + b }\nb2()"), 2.0);
+    CHECK_EQ(evaluateLast("def f32(x) x + 1\ndef g(x) f32(x) * 2\ng(0.25)"), 2.5);
+}
+
+NEXON_TEST(TypeInferenceIntegerLiterals) {
+    // Integer literals keep all 64 bits, beyond the 53 of a double.
+    CHECK_EQ(evaluateLast("def f() -> i64 12345678901234567 - 12345678901234566\nf()"), 1.0);
+    CHECK_EQ(evaluateLast("def f(x: i64) -> bool x == 12345678901234567\nf(12345678901234567 + 1)"), 0.0);
+    CHECK_EQ(evaluateLast("def f() -> i64 9223372036854775807 - 9223372036854775806\nf()"), 1.0);
+    // Out of range: an error, not a silent f64.
+    CHECK(!evaluate("def f() 9223372036854775808"));
+    CHECK_EQ(evaluateLast("def f() 9223372036854775808.0\nf()"), 9223372036854775808.0);
+}
+
+NEXON_TEST(TypeInferenceLiteralRange) {
+    // A literal only narrows to the other operand's type if it is exact there.
+    CHECK_EQ(inferBodyType("def f(x: i32) x + 2147483647"), ValueType::I32);
+    CHECK_EQ(inferBodyType("def f(x: i32) x + 2147483648"), ValueType::I64);
+    CHECK_EQ(inferBodyType("def f(x: i32) x + 5000000000"), ValueType::I64);
+    CHECK_EQ(evaluateLast("def f(x: i32) x + 5000000000\nf(1)"), 5000000001.0);
+    CHECK_EQ(inferBodyType("def f(x: f32) x + 16777216"), ValueType::F32);
+    CHECK_EQ(inferBodyType("def f(x: f32) x + 16777217"), ValueType::F64);
+    CHECK_EQ(evaluateLast("def f(x: f32) x + 16777217\nf(0)"), 16777217.0);
+    CHECK_EQ(inferBodyType("def f(x: f32) x * 0.5"), ValueType::F32);
+    // Float literals are rounded to f32 beside an f32, exact or not.
+    CHECK_EQ(inferBodyType("def f(x: f32) x * 0.1"), ValueType::F32);
+    CHECK_EQ(inferBodyType("def f(x: f32) 0.299 * x"), ValueType::F32);
+    CHECK_EQ(evaluateLast("def f(x: f32) -> f64 x * 0.1\nf(1)"), double(0.1f));
+    CHECK_EQ(inferBodyType("def f(x: f64) x + 9007199254740993"), ValueType::F64);
+    CHECK_EQ(inferBodyType("def f(x: i64) x < 9007199254740993"), ValueType::Bool);
+    CHECK_EQ(evaluateLast("def f(x: i64) -> bool x == 9007199254740993\nf(9007199254740992)"), 0.0);
+    CHECK_EQ(inferBodyType("def f(x: i32) x + 0.5"), ValueType::F64);
+}
+
+NEXON_TEST(TypeInferenceDivisionByZero) {
+    // '/' is f64; converting its infinities and NaN back to an integer saturates.
+    CHECK_EQ(evaluateLast("def q(a: i64 b: i64) -> i64 a / b\nq(1, 0)"), 9223372036854775807.0);
+    CHECK_EQ(evaluateLast("def q(a: i64 b: i64) -> i64 a / b\nq(-1, 0)"), -9223372036854775808.0);
+    CHECK_EQ(evaluateLast("def q(a: i64 b: i64) -> i64 a / b\nq(0, 0)"), 0.0);
+    CHECK_EQ(evaluateLast("def q(a: i32 b: i32) -> i32 a / b\nq(5, 0)"), 2147483647.0);
+    CHECK_EQ(evaluateLast("def q(a: i64 b: i64) -> i64 a / b\nq(7, 2)"), 3.0);
+}
+
+NEXON_TEST(TypeInferenceIntegerDivision) {
+    // A quotient converted straight to an integer divides as integers, exact beyond 2^53.
+    CHECK_EQ(evaluateLast("def q(a: i64 b: i64) -> i64 a / b\n"
+                          "def t() -> bool q(9007199254740993, 1) == 9007199254740993\nt()"), 1.0);
+    CHECK_EQ(evaluateLast("def q(a: i64 b: i64) -> i64 a / b\n"
+                          "def t() -> bool q(0 - 9223372036854775807, 3) == 0 - 3074457345618258602\nt()"), 1.0);
+    CHECK_EQ(evaluateLast("def t(a: i64) -> bool { var x: i64 = 0; x = a / 1; x == 9007199254740993 }\n"
+                          "t(9007199254740993)"), 1.0);
+    CHECK_EQ(evaluateLast("def t(a: i64) -> bool i64(a / 1) == 9007199254740993\nt(9007199254740993)"), 1.0);
+    // Truncation toward zero, saturation and division by zero as for the f64 quotient.
+    CHECK_EQ(evaluateLast("def q(a: i64 b: i64) -> i64 a / b\nq(-7, 2)"), -3.0);
+    CHECK_EQ(evaluateLast("def t() -> bool i64(-9223372036854775808 / -1) == 9223372036854775807\nt()"), 1.0);
+    CHECK_EQ(evaluateLast("def q(a: i64 b: i64) -> i32 a / b\nq(5000000000, 1)"), 2147483647.0);
+    CHECK_EQ(evaluateLast("def q(a: i64 b: i64) -> i32 a / b\nq(-5, 0)"), -2147483648.0);
+}